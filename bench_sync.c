@@ -0,0 +1,99 @@
+// bench_sync.c
+// Microbenchmark del costo de sincronización por paso de la región persistente de traffic_omp.c.
+// Compara el esquema anterior (dos barreras, dos single y un omp for con barrera y reducción)
+// con el actual (omp for nowait + una sola barrera, con parciales por hilo y por paridad que
+// cada hilo suma). El trabajo por paso es mínimo a propósito: lo que se mide es la espera.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+
+#define BENCH_WORK 64 // elementos por tramo (trabajo casi nulo)
+
+typedef struct {
+    _Alignas(64) double value;
+} PaddedDouble;
+
+static double work_slice(const double* data, int k) {
+    double acc = 0.0;
+    for (int i = 0; i < BENCH_WORK; ++i) acc += data[k * BENCH_WORK + i];
+    return acc;
+}
+
+// Esquema anterior: ~5 sincronizaciones por paso.
+static double bench_five_syncs(int nt, int steps, int num_slices, const double* data, double* check) {
+    double step_sum = 0.0, total = 0.0;
+    double t0 = omp_get_wtime();
+    #pragma omp parallel num_threads(nt) default(shared)
+    {
+        for (int s = 0; s < steps; ++s) {
+            #pragma omp barrier
+            #pragma omp barrier
+            #pragma omp single
+            step_sum = 0.0;
+            #pragma omp for schedule(static) reduction(+:step_sum)
+            for (int k = 0; k < num_slices; ++k) step_sum += work_slice(data, k);
+            #pragma omp single
+            total += step_sum;
+        }
+    }
+    double t1 = omp_get_wtime();
+    *check = total;
+    return (t1 - t0) / steps;
+}
+
+// Esquema actual: una barrera por paso; la suma la hace cada hilo leyendo los parciales.
+static double bench_one_barrier(int nt, int steps, int num_slices, const double* data, double* check) {
+    PaddedDouble* partial = (PaddedDouble*)aligned_alloc(64, (size_t)2 * nt * sizeof(PaddedDouble));
+    double total = 0.0;
+    double t0 = omp_get_wtime();
+    #pragma omp parallel num_threads(nt) default(shared)
+    {
+        const int t = omp_get_thread_num();
+        double my_total = 0.0;
+        for (int s = 0; s < steps; ++s) {
+            const int p = s & 1;
+            double acc = 0.0;
+            #pragma omp for schedule(static) nowait
+            for (int k = 0; k < num_slices; ++k) acc += work_slice(data, k);
+            partial[p * nt + t].value = acc;
+            #pragma omp barrier
+            for (int k = 0; k < nt; ++k) my_total += partial[p * nt + k].value;
+        }
+        #pragma omp master
+        total = my_total;
+    }
+    double t1 = omp_get_wtime();
+    free(partial);
+    *check = total;
+    return (t1 - t0) / steps;
+}
+
+int main(int argc, char** argv) {
+    int steps      = (argc > 1) ? atoi(argv[1]) : 20000; // pasos por medición
+    int num_slices = (argc > 2) ? atoi(argv[2]) : 16;    // tramos por paso
+    if (steps < 1 || num_slices < 1) {
+        fprintf(stderr, "Uso: %s [pasos] [tramos]\n", argv[0]);
+        return 1;
+    }
+
+    double* data = (double*)malloc((size_t)num_slices * BENCH_WORK * sizeof(double));
+    for (int i = 0; i < num_slices * BENCH_WORK; ++i) data[i] = 1.0;
+
+    omp_set_dynamic(0);
+    const int max_threads = omp_get_max_threads();
+    printf("Costo de sincronización por paso (%d pasos, %d tramos de %d elementos)\n",
+           steps, num_slices, BENCH_WORK);
+    printf("%6s %18s %18s %10s\n", "hilos", "5 sincr. (us)", "1 barrera (us)", "mejora");
+    for (int nt = 1;; nt = (nt * 2 < max_threads) ? nt * 2 : max_threads) { // 1, 2, 4, ..., máx.
+        double check_a, check_b;
+        double a = bench_five_syncs(nt, steps, num_slices, data, &check_a);
+        double b = bench_one_barrier(nt, steps, num_slices, data, &check_b);
+        if (check_a != check_b) fprintf(stderr, "Aviso: sumas distintas con %d hilos\n", nt);
+        printf("%6d %18.3f %18.3f %9.2fx\n", nt, a * 1e6, b * 1e6, a / b);
+        if (nt == max_threads) break;
+    }
+
+    free(data);
+    return 0;
+}
@@ -0,0 +1,175 @@
+// metrics_reader.c
+// Lector de la página de métricas en vivo (--metrics, ver traffic_metrics.h). Mapea
+// /dev/shm/NOMBRE solo para lectura y la escribe en formato de texto de Prometheus; no toca la
+// simulación (no hay candados: el seqlock de la página se reintenta del lado del lector).
+//
+//   metrics_reader nombre                 métricas una vez por stdout
+//   metrics_reader nombre --serve puerto  HTTP en ese puerto: cada GET recibe las métricas
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+
+#include "traffic_metrics.h"
+
+// Copia consistente de la parte bajo el seqlock.
+typedef struct {
+    uint64_t running, step, ff_steps, crossed, active, waiting;
+    double   sim_time, wall;
+    double   phase[PH_COUNT];
+} MetricsSample;
+
+static const MetricsPage* metrics_map(const char* name) {
+    char path[256];
+    snprintf(path, sizeof(path), "/%s", name);
+    int fd = shm_open(path, O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf(stderr, "No hay página de métricas %s (¿corre la simulación con --metrics %s?)\n", path, name);
+        return NULL;
+    }
+    void* p = mmap(NULL, sizeof(MetricsPage), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { fprintf(stderr, "%s: mmap falló\n", path); return NULL; }
+    const MetricsPage* P = (const MetricsPage*)p;
+    if (memcmp(P->magic, METRICS_MAGIC, sizeof(P->magic)) != 0 || P->version != METRICS_VERSION) {
+        fprintf(stderr, "%s: no es una página de métricas versión %d\n", path, METRICS_VERSION);
+        munmap(p, sizeof(MetricsPage));
+        return NULL;
+    }
+    return P;
+}
+
+static void metrics_sample(const MetricsPage* P, MetricsSample* s) {
+    for (;;) {
+        uint64_t seq = __atomic_load_n(&P->seq, __ATOMIC_ACQUIRE);
+        if (seq & 1) continue; // escribiendo
+        s->running  = metrics_load(&P->running);
+        s->step     = metrics_load(&P->step);
+        s->ff_steps = metrics_load(&P->ff_steps);
+        s->crossed  = metrics_load(&P->crossed);
+        s->active   = metrics_load(&P->active);
+        s->waiting  = metrics_load(&P->waiting);
+        s->sim_time = metrics_double(metrics_load(&P->sim_time));
+        s->wall     = metrics_double(metrics_load(&P->wall));
+        for (int ph = 0; ph < PH_COUNT; ++ph) s->phase[ph] = metrics_double(metrics_load(&P->phase[ph]));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (metrics_load(&P->seq) == seq) return;
+    }
+}
+
+// Métricas en formato de texto de Prometheus (versión 0.0.4).
+static void write_prometheus(FILE* out, const MetricsPage* P) {
+    MetricsSample s;
+    metrics_sample(P, &s);
+    char labels[96];
+    snprintf(labels, sizeof(labels), "engine=\"%s\",pid=\"%d\"", P->engine, P->pid);
+
+    fprintf(out, "# HELP traffic_running 1 mientras corre el bucle de pasos.\n# TYPE traffic_running gauge\n");
+    fprintf(out, "traffic_running{%s} %llu\n", labels, (unsigned long long)s.running);
+    fprintf(out, "# HELP traffic_steps_total Pasos simulados.\n# TYPE traffic_steps_total counter\n");
+    fprintf(out, "traffic_steps_total{%s} %llu\n", labels, (unsigned long long)s.step);
+    fprintf(out, "# HELP traffic_fast_forward_steps_total Pasos aplicados en bloque.\n"
+                 "# TYPE traffic_fast_forward_steps_total counter\n");
+    fprintf(out, "traffic_fast_forward_steps_total{%s} %llu\n", labels, (unsigned long long)s.ff_steps);
+    fprintf(out, "# HELP traffic_steps_per_second Pasos por segundo de reloj desde el inicio.\n"
+                 "# TYPE traffic_steps_per_second gauge\n");
+    fprintf(out, "traffic_steps_per_second{%s} %.6g\n", labels, s.wall > 0.0 ? (double)s.step / s.wall : 0.0);
+    fprintf(out, "# HELP traffic_sim_time_seconds Tiempo simulado.\n# TYPE traffic_sim_time_seconds gauge\n");
+    fprintf(out, "traffic_sim_time_seconds{%s} %.17g\n", labels, s.sim_time);
+    fprintf(out, "# HELP traffic_wall_seconds Tiempo de reloj de la corrida.\n# TYPE traffic_wall_seconds gauge\n");
+    fprintf(out, "traffic_wall_seconds{%s} %.6f\n", labels, s.wall);
+    fprintf(out, "# HELP traffic_vehicles Vehículos de la corrida.\n# TYPE traffic_vehicles gauge\n");
+    fprintf(out, "traffic_vehicles{%s} %d\n", labels, P->num_vehicles);
+    fprintf(out, "# HELP traffic_vehicles_active Vehículos que todavía no cruzaron.\n"
+                 "# TYPE traffic_vehicles_active gauge\n");
+    fprintf(out, "traffic_vehicles_active{%s} %llu\n", labels, (unsigned long long)s.active);
+    fprintf(out, "# HELP traffic_vehicles_waiting Vehículos detenidos en rojo.\n"
+                 "# TYPE traffic_vehicles_waiting gauge\n");
+    fprintf(out, "traffic_vehicles_waiting{%s} %llu\n", labels, (unsigned long long)s.waiting);
+    fprintf(out, "# HELP traffic_crossings_total Vehículos que cruzaron.\n# TYPE traffic_crossings_total counter\n");
+    fprintf(out, "traffic_crossings_total{%s} %llu\n", labels, (unsigned long long)s.crossed);
+
+    fprintf(out, "# HELP traffic_phase_seconds_total Tiempo por fase del paso (hilo 0).\n"
+                 "# TYPE traffic_phase_seconds_total counter\n");
+    for (int ph = 0; ph < PH_COUNT; ++ph) {
+        fprintf(out, "traffic_phase_seconds_total{%s,phase=\"%s\"} %.9f\n", labels, PHASE_NAMES[ph], s.phase[ph]);
+    }
+
+    // Por hilo (cada línea la escribe su hilo: basta con una lectura atómica por campo)
+    double max_move = 0.0, sum_move = 0.0;
+    fprintf(out, "# HELP traffic_thread_move_seconds_total Tiempo moviendo vehículos por hilo.\n"
+                 "# TYPE traffic_thread_move_seconds_total counter\n");
+    for (int t = 0; t < P->num_threads; ++t) {
+        double move = metrics_double(metrics_load(&P->thread[t].move));
+        fprintf(out, "traffic_thread_move_seconds_total{%s,thread=\"%d\"} %.9f\n", labels, t, move);
+        sum_move += move;
+        if (move > max_move) max_move = move;
+    }
+    fprintf(out, "# HELP traffic_thread_barrier_seconds_total Espera en la barrera del paso por hilo.\n"
+                 "# TYPE traffic_thread_barrier_seconds_total counter\n");
+    for (int t = 0; t < P->num_threads; ++t) {
+        fprintf(out, "traffic_thread_barrier_seconds_total{%s,thread=\"%d\"} %.9f\n", labels, t,
+                metrics_double(metrics_load(&P->thread[t].barrier)));
+    }
+    fprintf(out, "# HELP traffic_move_imbalance Desbalance del movimiento: máximo sobre promedio por hilo.\n"
+                 "# TYPE traffic_move_imbalance gauge\n");
+    fprintf(out, "traffic_move_imbalance{%s} %.6f\n", labels,
+            sum_move > 0.0 ? max_move * P->num_threads / sum_move : 1.0);
+}
+
+// Servidor mínimo: un cliente a la vez, cualquier pedido recibe las métricas.
+static int serve(const MetricsPage* P, int port) {
+    int srv = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(srv, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr = {0};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons((uint16_t)port);
+    if (srv < 0 || bind(srv, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(srv, 8) != 0) {
+        fprintf(stderr, "No se pudo escuchar en el puerto %d\n", port);
+        return 1;
+    }
+    fprintf(stderr, "Métricas en http://0.0.0.0:%d/metrics\n", port);
+    char* body = NULL;
+    size_t body_len = 0;
+    for (;;) {
+        int c = accept(srv, NULL, NULL);
+        if (c < 0) continue;
+        char req[1024];
+        if (read(c, req, sizeof(req)) <= 0) { close(c); continue; } // el pedido no importa
+
+        FILE* mem = open_memstream(&body, &body_len);
+        write_prometheus(mem, P);
+        fclose(mem);
+        char head[160];
+        int n = snprintf(head, sizeof(head), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                             "Content-Length: %zu\r\nConnection: close\r\n\r\n", body_len);
+        if (write(c, head, (size_t)n) == n && write(c, body, body_len) < 0) { /* cliente cerrado */ }
+        close(c);
+        free(body);
+        body = NULL;
+    }
+}
+
+int main(int argc, char** argv) {
+    bool serving = argc == 4 && strcmp(argv[2], "--serve") == 0;
+    if (argc != 2 && !serving) {
+        fprintf(stderr, "Uso: %s nombre [--serve puerto]\n", argv[0]);
+        return 1;
+    }
+    const MetricsPage* P = metrics_map(argv[1]);
+    if (!P) return 1;
+    if (serving) return serve(P, atoi(argv[3]));
+    write_prometheus(stdout, P);
+    munmap((void*)P, sizeof(MetricsPage));
+    return 0;
+}
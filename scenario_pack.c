@@ -0,0 +1,109 @@
+// scenario_pack.c
+// Arma tablas de vehículos para los escenarios (tabla ..., ver traffic_scenario.h): el trabajo
+// de leer, convertir y ordenar se hace una vez acá y la simulación solo mapea el resultado.
+// Compilar con la misma precisión del estado que la simulación (-DTRAFFIC_COMPACT o no).
+//
+//   scenario_pack demanda.csv salida.veh          una línea "carril,posición,velocidad" por vehículo
+//                                                 (m, m/s); el id es el orden de las líneas
+//   scenario_pack --random N semilla salida.veh   la flota de `traffic_seq N 0 semilla`
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "traffic_core.h"
+#include "traffic_scenario.h"
+
+// Reserva los arreglos de n vehículos con los rangos de carril de counts (ver alloc_vehicles_soa).
+static void alloc_table(VehicleSoA* S, int n, const int counts[NUM_LANES]) {
+    alloc_vehicles_soa(S, n);
+    S->lane_begin[0] = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_begin[l + 1] = S->lane_begin[l] + counts[l];
+        S->lane_end[l] = S->lane_begin[l + 1];
+        S->lane_live[l] = counts[l];
+    }
+}
+
+// Lee el CSV en claves (se ignoran las líneas vacías, los comentarios y un encabezado).
+static VehicleSortKey* read_csv(const char* path, int* n_out, int counts[NUM_LANES]) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir la demanda: %s\n", path);
+        return NULL;
+    }
+    size_t cap = 1 << 16;
+    int n = 0, line_no = 0;
+    VehicleSortKey* key = (VehicleSortKey*)malloc(cap * sizeof(VehicleSortKey));
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        ++line_no;
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        VehicleSortKey k = { .id = n };
+        if (sscanf(p, "%d , %lf , %lf", &k.lane, &k.pos, &k.speed) != 3) {
+            if (n == 0 && line_no == 1) continue; // encabezado
+            k.lane = -1;
+        }
+        if (k.lane < 0 || k.lane >= NUM_LANES || !(k.pos > 0.0) || !(k.speed > 0.0) || n == 0x7fffffff) {
+            fprintf(stderr, "%s:%d: se espera \"carril,posición,velocidad\" (carril 0..3, posición y velocidad > 0)\n",
+                    path, line_no);
+            fclose(f);
+            free(key);
+            return NULL;
+        }
+        if ((size_t)n == cap) {
+            cap *= 2;
+            key = (VehicleSortKey*)realloc(key, cap * sizeof(VehicleSortKey));
+        }
+        key[n++] = k;
+        counts[k.lane] += 1;
+    }
+    fclose(f);
+    if (n == 0) {
+        fprintf(stderr, "%s: no hay vehículos\n", path);
+        free(key);
+        return NULL;
+    }
+    *n_out = n;
+    return key;
+}
+
+int main(int argc, char** argv) {
+    VehicleSoA S;
+    const char* out;
+    if (argc == 5 && strcmp(argv[1], "--random") == 0) {
+        int n = atoi(argv[2]);
+        if (n < 1) {
+            fprintf(stderr, "Vehículos inválidos: %s\n", argv[2]);
+            return 1;
+        }
+        init_vehicles_soa(&S, n, (unsigned int)atoi(argv[3]));
+        out = argv[4];
+    } else if (argc == 3) {
+        int n = 0, counts[NUM_LANES] = {0};
+        VehicleSortKey* key = read_csv(argv[1], &n, counts);
+        if (!key) return 1;
+        // Por carril y por distancia (cmp_vehicle_key): el orden que espera el kernel
+        qsort(key, (size_t)n, sizeof(VehicleSortKey), cmp_vehicle_key);
+        alloc_table(&S, n, counts);
+        fill_vehicles_soa(&S, key, 0, n);
+        free(key);
+        out = argv[2];
+    } else {
+        fprintf(stderr, "Uso: %s demanda.csv salida.veh\n       %s --random N semilla salida.veh\n", argv[0], argv[0]);
+        return 1;
+    }
+    bool ok = vehicle_table_write(out, &S);
+    if (ok) {
+        printf("Tabla %s: %d vehículos (carriles:", out, S.n);
+        for (int l = 0; l < NUM_LANES; ++l) printf(" %d", S.lane_begin[l + 1] - S.lane_begin[l]);
+        printf(")\n");
+    }
+    free_vehicles_soa(&S);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,206 @@
+// trace_reader.c
+// Lector de trazas binarias (.trc, ver traffic_trace.h). Mapea el archivo con mmap y
+// reconstruye el estado de cualquier paso desde el keyframe anterior, sin leer el resto.
+//
+//   trace_reader archivo.trc           resumen de la traza
+//   trace_reader archivo.trc paso      estado en ese paso, con el formato de texto de traffic_omp
+
+#define _DEFAULT_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "traffic_trace.h"
+
+typedef struct {
+    const unsigned char*    base;
+    size_t                  size;
+    const TraceHeader*      header;
+    const TraceLightConfig* lights;
+    const unsigned char*    lane;
+    TraceIndexEntry*        index;  // del archivo, o armado recorriendo los registros
+    uint32_t                num_records;
+} TraceFile;
+
+static bool trace_in_bounds(const TraceFile* T, uint64_t offset, uint64_t bytes) {
+    return offset <= T->size && bytes <= T->size - offset;
+}
+
+// Tamaño de un registro completo (encabezado + semáforos + bloque con relleno).
+static uint64_t trace_record_bytes(const TraceFile* T, const TraceRecordHeader* R) {
+    return sizeof(TraceRecordHeader) + (uint64_t)T->header->num_lights * sizeof(TraceLightState) +
+           trace_align8(R->stored_bytes);
+}
+
+static bool trace_map(TraceFile* T, const char* path) {
+    *T = (TraceFile){0};
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) { fprintf(stderr, "No se pudo abrir %s\n", path); return false; }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(TraceHeader)) {
+        fprintf(stderr, "%s: archivo demasiado corto\n", path);
+        close(fd);
+        return false;
+    }
+    T->size = (size_t)st.st_size;
+    void* p = mmap(NULL, T->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) { fprintf(stderr, "%s: mmap falló\n", path); return false; }
+    T->base = (const unsigned char*)p;
+    T->header = (const TraceHeader*)T->base;
+
+    const TraceHeader* H = T->header;
+    if (memcmp(H->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0 || H->version != TRACE_VERSION) {
+        fprintf(stderr, "%s: no es una traza versión %d\n", path, TRACE_VERSION);
+        return false;
+    }
+    uint64_t off = sizeof(TraceHeader);
+    T->lights = (const TraceLightConfig*)(T->base + off);
+    off += (uint64_t)H->num_lights * sizeof(TraceLightConfig);
+    T->lane = T->base + off;
+    off += trace_align8(H->num_vehicles) + (uint64_t)H->num_vehicles * sizeof(double);
+    if (!trace_in_bounds(T, 0, off)) { fprintf(stderr, "%s: encabezado truncado\n", path); return false; }
+
+    // Índice del archivo, o (traza sin cerrar) recorriendo los registros completos
+    if (H->index_offset != 0 &&
+        trace_in_bounds(T, H->index_offset, (uint64_t)H->num_records * sizeof(TraceIndexEntry))) {
+        T->num_records = H->num_records;
+        T->index = (TraceIndexEntry*)malloc((size_t)T->num_records * sizeof(TraceIndexEntry) + 1);
+        memcpy(T->index, T->base + H->index_offset, (size_t)T->num_records * sizeof(TraceIndexEntry));
+        return true;
+    }
+    int cap = 256;
+    T->index = (TraceIndexEntry*)malloc((size_t)cap * sizeof(TraceIndexEntry));
+    while (trace_in_bounds(T, off, sizeof(TraceRecordHeader))) {
+        const TraceRecordHeader* R = (const TraceRecordHeader*)(T->base + off);
+        uint64_t bytes = trace_record_bytes(T, R);
+        if (!trace_in_bounds(T, off, bytes)) break;
+        if ((int)T->num_records == cap) {
+            cap *= 2;
+            T->index = (TraceIndexEntry*)realloc(T->index, (size_t)cap * sizeof(TraceIndexEntry));
+        }
+        T->index[T->num_records++] = (TraceIndexEntry){ R->step, R->kind, off };
+        off += bytes;
+    }
+    fprintf(stderr, "%s: traza sin índice (sin cerrar), %u registros completos\n", path, T->num_records);
+    return true;
+}
+
+static void trace_unmap(TraceFile* T) {
+    free(T->index);
+    if (T->base) munmap((void*)T->base, T->size);
+}
+
+// Aplica el registro r sobre snap (un keyframe lo reemplaza todo). block: búfer de trabajo.
+static bool trace_apply_record(const TraceFile* T, uint32_t r, Snapshot* snap, unsigned char* block) {
+    const TraceRecordHeader* R = (const TraceRecordHeader*)(T->base + T->index[r].offset);
+    const TraceLightState* L = (const TraceLightState*)(R + 1);
+    const unsigned char* stored = (const unsigned char*)(L + T->header->num_lights);
+    size_t n = T->header->num_vehicles;
+    if (R->raw_bytes != trace_block_bytes((int)R->kind, R->count) || R->count > n ||
+        !trace_decompress((int)R->codec, block, R->raw_bytes, stored, R->stored_bytes)) {
+        fprintf(stderr, "Registro %u (paso %u): bloque inválido o códec %u no compilado\n", r, R->step, R->codec);
+        return false;
+    }
+    snap->step = (int)R->step;
+    snap->sim_time = R->sim_time;
+    for (int i = 0; i < snap->num_lights; ++i) {
+        snap->lights[i].state = (LightState)L[i].state;
+        snap->lights[i].time_in_state = L[i].time_in_state;
+    }
+    if (R->kind == TRACE_KEYFRAME) {
+        memcpy(snap->pos, block, n * sizeof(double));
+        memcpy(snap->state, block + n * sizeof(double), n);
+        memcpy(snap->waiting, block + n * (sizeof(double) + 1), n);
+        return true;
+    }
+    size_t count = R->count;
+    const double* pos = (const double*)block;
+    const uint32_t* ids = (const uint32_t*)(block + count * sizeof(double));
+    const unsigned char* state = block + count * (sizeof(double) + sizeof(uint32_t));
+    const unsigned char* waiting = state + count;
+    for (size_t k = 0; k < count; ++k) {
+        if (ids[k] >= n) return false;
+        snap->pos[ids[k]] = pos[k];
+        snap->state[ids[k]] = state[k];
+        snap->waiting[ids[k]] = waiting[k];
+    }
+    return true;
+}
+
+static void print_trace_summary(const TraceFile* T) {
+    const TraceHeader* H = T->header;
+    uint32_t keyframes = 0;
+    for (uint32_t r = 0; r < T->num_records; ++r) keyframes += (T->index[r].kind == TRACE_KEYFRAME);
+    printf("Traza versión %u: %u vehículos, %u semáforos, semilla %llu, dt=%.1f s\n",
+           H->version, H->num_vehicles, H->num_lights, (unsigned long long)H->seed, H->dt);
+    printf("Registros: %u (keyframes: %u, cada %u)", T->num_records, keyframes, H->keyframe_every);
+    if (T->num_records > 0) {
+        printf(", pasos %u a %u", T->index[0].step, T->index[T->num_records - 1].step);
+    }
+    printf("\nTamaño: %zu bytes\n", T->size);
+    for (uint32_t i = 0; i < H->num_lights; ++i) {
+        printf("Semáforo %u - Estado inicial: %s, Tiempos: R: %.1fs, V: %.1fs, A: %.1fs\n",
+               i, state_to_str((LightState)T->lights[i].initial_state), T->lights[i].t_red,
+               T->lights[i].t_green, T->lights[i].t_yellow);
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argc > 3) {
+        fprintf(stderr, "Uso: %s archivo.trc [paso]\n", argv[0]);
+        return 1;
+    }
+    TraceFile T;
+    if (!trace_map(&T, argv[1])) { trace_unmap(&T); return 1; }
+    if (argc == 2) {
+        print_trace_summary(&T);
+        trace_unmap(&T);
+        return 0;
+    }
+
+    // Último registro con paso <= pedido y el keyframe desde el que hay que reconstruir
+    long target = atol(argv[2]);
+    int last = -1;
+    for (uint32_t r = 0; r < T.num_records && (long)T.index[r].step <= target; ++r) last = (int)r;
+    if (last < 0) {
+        fprintf(stderr, "La traza no tiene el paso %ld\n", target);
+        trace_unmap(&T);
+        return 1;
+    }
+    int first = last;
+    while (first > 0 && T.index[first].kind != TRACE_KEYFRAME) --first;
+
+    const size_t n = T.header->num_vehicles;
+    Snapshot snap = {0};
+    snap.n = (int)n;
+    snap.text = true;
+    snap.lane = (unsigned char*)T.lane;
+    snap.state = (unsigned char*)malloc(n);
+    snap.waiting = (unsigned char*)malloc(n);
+    snap.pos = (double*)malloc(n * sizeof(double));
+    snap.num_lights = (int)T.header->num_lights;
+    snap.lights = (TrafficLight*)calloc(snap.num_lights, sizeof(TrafficLight));
+    unsigned char* block = (unsigned char*)malloc(trace_block_bytes(TRACE_DELTA, n) + 1);
+
+    bool ok = true;
+    for (int r = first; r <= last && ok; ++r) ok = trace_apply_record(&T, (uint32_t)r, &snap, block);
+    if (ok) {
+        if ((long)snap.step != target) fprintf(stderr, "Paso %ld no registrado; se muestra el %d\n", target, snap.step);
+        write_snapshot_text(stdout, &snap);
+    }
+
+    free(block);
+    free(snap.state);
+    free(snap.waiting);
+    free(snap.pos);
+    free(snap.lights);
+    trace_unmap(&T);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,212 @@
+// traffic_actuated.h
+// Semáforos actuados (--actuated, traffic_seq y traffic_omp): en lugar del ciclo fijo de
+// init_intersection, cada semáforo mira la demanda de su carril al terminar el paso anterior.
+//   VERDE:    t_green es el mínimo; después sigue en verde mientras haya vehículos en la zona del
+//             detector (los últimos ACTUATED_DETECTOR metros), hasta --max-green.
+//   AMARILLO: fijo.
+//   ROJO:     t_red es el máximo; pasada la mitad, se pone en verde antes si la cola del carril
+//             lleva esperando en promedio --max-wait segundos o más.
+//
+// La demanda (vivos en la zona y la suma de sus esperas) sale del mismo recorrido que mueve los
+// vehículos: el kernel de abajo es el de move_vehicles_soa con una reducción más, y cada hilo
+// la deja en su parcial del paso como los cruces. Decidir cuesta O(carriles) por paso. Las
+// esperas se suman contadas en pasos (enteros): la suma no depende de cómo se repartan los
+// tramos, así traffic_seq y traffic_omp toman las mismas decisiones con cualquier número de hilos.
+// La demanda es función del estado al terminar un paso: al empezar (o al reanudar) se calcula
+// con un recorrido.
+
+#ifndef TRAFFIC_ACTUATED_H
+#define TRAFFIC_ACTUATED_H
+
+#include "traffic_core.h"
+
+#define ACTUATED_DETECTOR 30.0 // m antes de la línea de alto
+
+// Demanda por carril al terminar un paso.
+typedef struct {
+    int       queue[NUM_LANES];      // vivos a ACTUATED_DETECTOR m o menos de la línea
+    long long wait_steps[NUM_LANES]; // suma de sus esperas, en pasos de dt
+} LaneDemand;
+
+// Lo que hizo el controlador (para el resumen).
+typedef struct {
+    long long green_extended; // pasos de verde más allá de t_green, sumando semáforos
+    int       red_cut;        // rojos terminados antes de t_red
+} ActuatedStats;
+
+static inline void lane_demand_clear(LaneDemand* D) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        D->queue[l] = 0;
+        D->wait_steps[l] = 0;
+    }
+}
+
+static inline void lane_demand_add(LaneDemand* D, const LaneDemand* src) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        D->queue[l] += src->queue[l];
+        D->wait_steps[l] += src->wait_steps[l];
+    }
+}
+
+// Demanda del estado actual con un recorrido (al empezar y al reanudar).
+static inline void lane_demand_scan(const VehicleSoA* S, double dt, LaneDemand* D) {
+    const real_t inv_dt = (real_t)(1.0 / dt);
+    lane_demand_clear(D);
+    for (int l = 0; l < NUM_LANES; ++l) {
+        for (int i = S->lane_begin[l]; i < S->lane_end[l]; ++i) {
+            if (S->finished[i] == VEH_EN_ROUTE && S->pos[i] <= (real_t)ACTUATED_DETECTOR) {
+                D->queue[l] += 1;
+                D->wait_steps[l] += wait_in_steps(S->total_wait[i], inv_dt);
+            }
+        }
+    }
+}
+
+// ----------------------- Controlador -----------------------
+static inline void update_actuated_light(TrafficLight* L, double dt, const SimConfig* cfg,
+                                         int queue, long long wait_steps, ActuatedStats* st) {
+    L->time_in_state += dt;
+    switch (L->state) {
+        case GREEN:
+            if (L->time_in_state >= L->t_green) {
+                if (queue > 0 && L->time_in_state < cfg->max_green) {
+                    st->green_extended += 1; // alguien llega a la línea: se extiende
+                } else {
+                    L->state = YELLOW;
+                    L->time_in_state = 0.0;
+                }
+            }
+            break;
+        case YELLOW:
+            if (L->time_in_state >= L->t_yellow) {
+                L->state = RED;
+                L->time_in_state = 0.0;
+            }
+            break;
+        case RED:
+        default: {
+            // Espera promedio de la cola >= max_wait, sin dividir
+            bool impatient = queue > 0 && (double)wait_steps * dt >= cfg->max_wait * queue;
+            bool cut = L->time_in_state < L->t_red && L->time_in_state >= 0.5 * L->t_red && impatient;
+            if (L->time_in_state >= L->t_red || cut) {
+                st->red_cut += cut;
+                L->state = GREEN;
+                L->time_in_state = 0.0;
+            }
+            break;
+        }
+    }
+}
+
+// Semáforo i = carril i, con la demanda del paso anterior.
+static inline void update_actuated_lights(Intersection* X, double dt, const SimConfig* cfg,
+                                          const LaneDemand* D, ActuatedStats* st) {
+    for (int i = 0; i < X->num_lights; ++i) {
+        update_actuated_light(&X->lights[i], dt, cfg, D->queue[i], D->wait_steps[i], st);
+    }
+}
+
+// ----------------------- Kernel con demanda -----------------------
+// move_vehicles_soa más la demanda del tramo: suma en *queue los vivos que quedaron en la zona
+// del detector y en *wait_steps sus esperas (en pasos).
+static inline int move_vehicles_actuated_soa(VehicleSoA* S, int go, double stop_distance, double dt,
+                                             int begin, int end, EventBuffer* events, int* halted,
+                                             int* queue, long long* wait_steps) {
+    const real_t*  restrict speed      = S->speed;
+    real_t*        restrict pos        = S->pos;
+    real_t*        restrict total_wait = S->total_wait;
+    unsigned char* restrict waiting    = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    cross_t*       restrict crossings  = S->crossings;
+    const real_t   rdt      = (real_t)dt;
+    const real_t   inv_dt   = (real_t)(1.0 / dt);
+    const real_t   stop     = (real_t)stop_distance;
+    const real_t   detector = (real_t)ACTUATED_DETECTOR;
+
+    int n_crossed = 0;
+    int n_halted = 0;
+    int n_queue = 0;
+    long long n_wait = 0;
+
+    #pragma omp simd reduction(+:n_crossed, n_halted, n_queue, n_wait)
+    for (int i = begin; i < end; ++i) {
+        int done = (finished[i] != VEH_EN_ROUTE);
+
+        int w = waiting[i] & !go;
+        real_t p = w ? pos[i] : pos[i] - speed[i] * rdt;
+
+        int arrive = (p <= (real_t)0);
+        int cross  = (!done) & arrive & go;
+        int halt   = (!done) & arrive & (!go) & (!w);
+        w |= halt;
+
+        real_t p_new  = done ? pos[i] : (cross ? (real_t)0 : (halt ? stop : p));
+        real_t tw_new = total_wait[i] + (((!done) & w) ? rdt : (real_t)0);
+        pos[i]        = p_new;
+        waiting[i]    = (unsigned char)(done ? waiting[i] : w);
+        total_wait[i] = tw_new;
+        finished[i]   = (unsigned char)(done ? VEH_DONE : (cross ? VEH_CROSSED_NOW : VEH_EN_ROUTE));
+        crossings[i]  |= (cross_t)cross;
+        n_crossed    += cross;
+        n_halted     += halt;
+
+        int in_zone = (!done) & (!cross) & (p_new <= detector);
+        n_queue += in_zone;
+        n_wait  += in_zone ? wait_in_steps(tw_new, inv_dt) : 0;
+    }
+
+    if (n_crossed > 0 && events) {
+        event_buffer_reserve(events, events->count + n_crossed);
+        for (int i = begin; i < end; ++i) {
+            if (finished[i] == VEH_CROSSED_NOW) events->ids[events->count++] = S->id[i];
+        }
+    }
+    *halted += n_halted;
+    *queue += n_queue;
+    *wait_steps += n_wait;
+    return n_crossed;
+}
+
+// wait_vehicles_soa más la demanda: en ROJO con la cola completa todos los vivos esperan en la
+// línea (dentro de la zona del detector).
+static inline void wait_vehicles_actuated_soa(VehicleSoA* S, double dt, int begin, int end,
+                                              int* queue, long long* wait_steps) {
+    real_t*        restrict total_wait = S->total_wait;
+    const unsigned char* restrict waiting = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    const real_t   rdt    = (real_t)dt;
+    const real_t   inv_dt = (real_t)(1.0 / dt);
+
+    int n_queue = 0;
+    long long n_wait = 0;
+    #pragma omp simd reduction(+:n_queue, n_wait)
+    for (int i = begin; i < end; ++i) {
+        real_t tw = total_wait[i] + (waiting[i] ? rdt : (real_t)0);
+        total_wait[i] = tw;
+        finished[i]   = (unsigned char)(finished[i] ? VEH_DONE : VEH_EN_ROUTE);
+        n_queue += waiting[i];
+        n_wait  += waiting[i] ? wait_in_steps(tw, inv_dt) : 0;
+    }
+    *queue += n_queue;
+    *wait_steps += n_wait;
+}
+
+// move_lane_slice con la demanda del tramo en D (carril sl->lane).
+static inline void move_lane_slice_actuated(VehicleSoA* S, const LaneSlice* sl, LaneMode mode,
+                                            double stop_distance, double dt, EventBuffer* events,
+                                            int* crossed, int* halted, LaneDemand* D) {
+    const int l = sl->lane;
+    if (mode == LANE_RED_QUEUED) {
+        wait_vehicles_actuated_soa(S, dt, sl->begin, sl->end, &D->queue[l], &D->wait_steps[l]);
+        return;
+    }
+    *crossed += move_vehicles_actuated_soa(S, mode == LANE_GO, stop_distance, dt, sl->begin, sl->end,
+                                           events, halted, &D->queue[l], &D->wait_steps[l]);
+}
+
+static inline void print_actuated_stats(const SimConfig* cfg, const ActuatedStats* st) {
+    printf("Semáforos actuados (verde hasta %.1f s, espera máx. %.1f s): %lld pasos de verde extendido, "
+           "%d rojos cortados\n", cfg->max_green, cfg->max_wait, st->green_extended, st->red_cut);
+}
+
+#endif // TRAFFIC_ACTUATED_H
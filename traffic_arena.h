@@ -0,0 +1,152 @@
+// traffic_arena.h
+// Arena de una corrida: una sola reserva de memoria virtual (mmap anónimo) de la que salen todos
+// los búferes que viven lo que dura la corrida (semáforos, arreglos de vehículos, tramos,
+// parciales por hilo, eventos de cruce). Cada bloque empieza en un múltiplo de ARENA_ALIGN (una
+// línea de caché, y el ancho de un vector AVX-512). No hay free por bloque: arena_reset la deja
+// vacía para la corrida siguiente (lote de escenarios) sin devolver las páginas, y arena_free la
+// libera entera.
+//
+// Con --huge-pages la arena pide páginas de 2 MiB: primero MAP_HUGETLB (páginas reservadas de
+// antemano en vm.nr_hugepages) y, si no hay, páginas transparentes con madvise(MADV_HUGEPAGE)
+// sobre un rango alineado a 2 MiB. Con decenas de millones de vehículos los fallos de TLB del
+// recorrido del kernel bajan mucho. Las páginas se asignan igual al escribirlas por primera vez,
+// así el reparto NUMA por first touch sigue valiendo (de a 2 MiB).
+
+#ifndef TRAFFIC_ARENA_H
+#define TRAFFIC_ARENA_H
+
+#include <sys/mman.h>
+
+#include "traffic_core.h"
+
+#define ARENA_ALIGN     64
+#define ARENA_HUGE_PAGE ((size_t)2 << 20)
+
+typedef enum { ARENA_PAGES_BASE = 0, ARENA_PAGES_THP, ARENA_PAGES_HUGETLB } ArenaPages;
+
+typedef struct {
+    unsigned char* base;     // NULL = sin reservar
+    size_t         capacity; // bytes del rango
+    size_t         used;
+    size_t         peak;     // máximo de used desde arena_init (a través de los reset)
+    size_t         map_size; // lo que hay que pasarle a munmap (incluye la alineación)
+    unsigned char* map_base;
+    ArenaPages     pages;
+} Arena;
+
+static inline size_t arena_round(size_t bytes, size_t align) {
+    return (bytes + align - 1) & ~(align - 1);
+}
+
+// Lo que ocupa en la arena un arreglo de count elementos de size bytes (con su alineación).
+static inline size_t arena_bytes(size_t count, size_t size) {
+    return arena_round(count * size, ARENA_ALIGN);
+}
+
+static inline const char* arena_pages_str(ArenaPages p) {
+    return (p == ARENA_PAGES_HUGETLB) ? "2 MiB (MAP_HUGETLB)" :
+           (p == ARENA_PAGES_THP)     ? "2 MiB transparentes (MADV_HUGEPAGE)" : "base";
+}
+
+// Reserva capacity bytes de direcciones (las páginas se asignan al escribirlas). Con huge, intenta
+// páginas de 2 MiB como se explica arriba; si no se puede, sigue con páginas base.
+static inline void arena_init(Arena* A, size_t capacity, bool huge) {
+    *A = (Arena){0};
+    capacity = arena_round(capacity > 0 ? capacity : 1, huge ? ARENA_HUGE_PAGE : ARENA_ALIGN);
+    void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+    if (huge) {
+        p = mmap(NULL, capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            A->map_base = A->base = (unsigned char*)p;
+            A->map_size = capacity;
+            A->pages = ARENA_PAGES_HUGETLB;
+        }
+    }
+#endif
+    if (p == MAP_FAILED) {
+        // Para las transparentes el rango tiene que cubrir páginas de 2 MiB enteras: se pide una
+        // de más y se usa desde el primer borde de 2 MiB
+        size_t extra = huge ? ARENA_HUGE_PAGE : 0;
+        p = mmap(NULL, capacity + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (p == MAP_FAILED) {
+            fprintf(stderr, "No se pudo reservar la arena (%.1f MiB)\n", (double)capacity / (1 << 20));
+            exit(1);
+        }
+        A->map_base = (unsigned char*)p;
+        A->map_size = capacity + extra;
+        A->base = (unsigned char*)arena_round((size_t)(uintptr_t)p, huge ? ARENA_HUGE_PAGE : 1);
+#ifdef MADV_HUGEPAGE
+        if (huge && madvise(A->base, capacity, MADV_HUGEPAGE) == 0) A->pages = ARENA_PAGES_THP;
+#endif
+    }
+    A->capacity = capacity;
+}
+
+// Bloque de bytes (sin inicializar: la primera escritura decide el nodo NUMA de cada página).
+static inline void* arena_alloc(Arena* A, size_t bytes) {
+    size_t at = arena_round(A->used, ARENA_ALIGN);
+    if (at + bytes > A->capacity) {
+        fprintf(stderr, "Arena agotada: se piden %zu bytes con %zu de %zu en uso\n", bytes, at, A->capacity);
+        exit(1);
+    }
+    A->used = at + bytes;
+    if (A->used > A->peak) A->peak = A->used;
+    return A->base + at;
+}
+
+// Vacía la arena sin devolver las páginas: la corrida siguiente reusa las ya asignadas.
+static inline void arena_reset(Arena* A) {
+    A->used = 0;
+}
+
+static inline void arena_free(Arena* A) {
+    if (A->map_base) munmap(A->map_base, A->map_size);
+    *A = (Arena){0};
+}
+
+// ----------------------- Búferes de la simulación -----------------------
+// Lo que ocupan los arreglos de N vehículos (alloc_vehicles_soa_arena).
+static inline size_t vehicles_arena_bytes(int N) {
+    const size_t n = (size_t)N;
+    return 2 * arena_bytes(n, sizeof(int)) + arena_bytes(n, sizeof(lane_t)) +
+           3 * arena_bytes(n, sizeof(real_t)) + 2 * arena_bytes(n, 1) + arena_bytes(n, sizeof(cross_t));
+}
+
+// Semáforos de una intersección (init_intersection_arena), uno por carril.
+static inline size_t intersection_arena_bytes(void) {
+    return arena_bytes(NUM_LANES, sizeof(TrafficLight));
+}
+
+// Como alloc_vehicles_soa, con los arreglos en la arena (no se liberan con free_vehicles_soa).
+static inline void alloc_vehicles_soa_arena(VehicleSoA* S, int N, Arena* A) {
+    const size_t n = (size_t)N;
+    S->slot       = (int*)arena_alloc(A, n * sizeof(int));
+    S->id         = (int*)arena_alloc(A, n * sizeof(int));
+    S->lane       = (lane_t*)arena_alloc(A, n * sizeof(lane_t));
+    S->pos        = (real_t*)arena_alloc(A, n * sizeof(real_t));
+    S->speed      = (real_t*)arena_alloc(A, n * sizeof(real_t));
+    S->waiting    = (unsigned char*)arena_alloc(A, n);
+    S->finished   = (unsigned char*)arena_alloc(A, n);
+    S->total_wait = (real_t*)arena_alloc(A, n * sizeof(real_t));
+    S->crossings  = (cross_t*)arena_alloc(A, n * sizeof(cross_t));
+    init_lane_ranges(S, N);
+}
+
+static inline void init_intersection_arena(Intersection* X, unsigned int seed, Arena* A) {
+    setup_intersection(X, NUM_LANES, seed, (TrafficLight*)arena_alloc(A, NUM_LANES * sizeof(TrafficLight)));
+}
+
+// Lista de eventos con lugar para cap ids: no crece (event_buffer_reserve no la toca) ni se libera.
+static inline void event_buffer_arena(EventBuffer* E, int cap, Arena* A) {
+    E->ids = (int*)arena_alloc(A, (size_t)cap * sizeof(int));
+    E->count = 0;
+    E->cap = cap;
+}
+
+static inline void print_arena_usage(FILE* out, const Arena* A) {
+    fprintf(out, "Arena: %.1f MiB usados de %.1f MiB reservados, páginas %s\n",
+            (double)A->peak / (1 << 20), (double)A->capacity / (1 << 20), arena_pages_str(A->pages));
+}
+
+#endif // TRAFFIC_ARENA_H
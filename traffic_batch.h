@@ -0,0 +1,92 @@
+// traffic_batch.h
+// Lote de escenarios (--batch archivo, traffic_omp): muchas corridas chicas dentro de un mismo
+// equipo de hilos, sin arrancar un proceso ni imprimir la configuración por cada una. Este
+// archivo tiene la lectura de la lista y la tabla de resultados; el motor está en traffic_omp.c.
+//
+// Lista: un escenario por línea, "semilla vehículos [verde amarillo rojo]" ('#' comenta). Sin
+// tiempos, los semáforos salen de la semilla como en una corrida normal (y el resultado es el
+// mismo que el de `traffic_omp vehículos 0 semilla`); con tiempos, los cuatro semáforos usan esos
+// (s, <= 10 como en la simulación).
+
+#ifndef TRAFFIC_BATCH_H
+#define TRAFFIC_BATCH_H
+
+#include <limits.h>
+
+#include "traffic_core.h"
+
+typedef struct {
+    unsigned int seed;
+    int          vehicles;
+    bool         fixed_lights;  // tiempos de la lista en lugar de los sorteados
+    double       t_green, t_yellow, t_red;
+} Scenario;
+
+typedef struct {
+    int    steps;
+    int    crossed;
+    double avg_wait;
+    double sim_time;
+    double wall;          // s de esta corrida (dentro del lote)
+    bool   split;         // los tramos de cada paso se repartieron entre hilos
+} ScenarioResult;
+
+// Lee la lista; devuelve cuántos escenarios hay (o -1 si hay un error, ya informado).
+static inline int load_scenarios(const char* path, Scenario** out) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir la lista de escenarios: %s\n", path);
+        return -1;
+    }
+    int count = 0, cap = 64, line_no = 0;
+    Scenario* list = (Scenario*)malloc((size_t)cap * sizeof(Scenario));
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        ++line_no;
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        Scenario sc = {0};
+        long long seed;
+        int got = sscanf(p, "%lld %d %lf %lf %lf", &seed, &sc.vehicles, &sc.t_green, &sc.t_yellow, &sc.t_red);
+        bool ok = (got == 2 || got == 5) && seed >= 0 && seed <= UINT_MAX && sc.vehicles > 0;
+        if (got == 5) {
+            ok = ok && sc.t_green > 0.0 && sc.t_yellow > 0.0 && sc.t_red > 0.0 &&
+                 sc.t_green <= 10.0 && sc.t_yellow <= 10.0 && sc.t_red <= 10.0;
+            sc.fixed_lights = true;
+        }
+        if (!ok) {
+            fprintf(stderr, "%s:%d: se espera \"semilla vehículos [verde amarillo rojo]\" (tiempos en (0, 10] s)\n",
+                    path, line_no);
+            fclose(f);
+            free(list);
+            return -1;
+        }
+        sc.seed = (unsigned int)seed;
+        if (count == cap) {
+            cap *= 2;
+            list = (Scenario*)realloc(list, (size_t)cap * sizeof(Scenario));
+        }
+        list[count++] = sc;
+    }
+    fclose(f);
+    *out = list;
+    return count;
+}
+
+// Tabla del lote (CSV, en el orden de la lista).
+static inline void print_batch_table(FILE* out, const Scenario* sc, const ScenarioResult* res, int count) {
+    fprintf(out, "scenario,seed,vehicles,t_green,t_yellow,t_red,split,steps,crossed,avg_wait_s,sim_time_s,wall_s\n");
+    for (int k = 0; k < count; ++k) {
+        if (sc[k].fixed_lights) {
+            fprintf(out, "%d,%u,%d,%.3f,%.3f,%.3f,", k, sc[k].seed, sc[k].vehicles,
+                    sc[k].t_green, sc[k].t_yellow, sc[k].t_red);
+        } else {
+            fprintf(out, "%d,%u,%d,,,,", k, sc[k].seed, sc[k].vehicles); // tiempos sorteados
+        }
+        fprintf(out, "%d,%d,%d,%.6f,%.1f,%.6f\n", res[k].split ? 1 : 0, res[k].steps, res[k].crossed,
+                res[k].avg_wait, res[k].sim_time, res[k].wall);
+    }
+}
+
+#endif // TRAFFIC_BATCH_H
@@ -0,0 +1,161 @@
+// traffic_bench.h
+// Modo benchmark (--bench) de traffic_seq y traffic_omp: corre el motor real sin impresión
+// sobre un barrido de tamaños (y de hilos en OpenMP), con corridas de calentamiento y varias
+// repeticiones por punto, y reporta mediana y p95 del tiempo por paso, vehículos actualizados
+// por segundo y eficiencia de escalado fuerte y débil como CSV o JSON Lines. El tiempo medido
+// es solo el del bucle de pasos: sin inicialización, resumen de configuración ni impresión.
+
+#ifndef TRAFFIC_BENCH_H
+#define TRAFFIC_BENCH_H
+
+#include "traffic_core.h"
+
+#define BENCH_MAX_SIZES 32
+
+// Lo que devuelve una corrida de run_simulation (también fuera del modo benchmark).
+typedef struct {
+    int       steps;
+    double    loop_seconds;     // bucle de pasos, sin inicialización ni resumen
+    long long vehicle_updates;  // slots recorridos por el kernel (rango activo de cada paso)
+    bool      mismatch;         // --verify-against encontró una diferencia
+} SimResult;
+
+typedef void (*BenchRunFn)(const SimConfig* cfg, SimResult* out);
+typedef void (*BenchSetThreadsFn)(int threads);
+
+// Un punto del barrido (mediana y p95 sobre las repeticiones).
+typedef struct {
+    const char* mode;           // "strong" (N fijo) o "weak" (N por hilo fijo)
+    int         vehicles;
+    int         threads;
+    int         steps;
+    double      median_step;    // s por paso
+    double      p95_step;
+    double      updates_per_s;  // con la repetición mediana
+} BenchPoint;
+
+// "1000,10000,..." -> sizes. Devuelve cuántos leyó (0 si la lista es inválida).
+static inline int parse_bench_sizes(const char* list, int* sizes) {
+    int count = 0;
+    const char* p = list;
+    while (*p && count < BENCH_MAX_SIZES) {
+        char* end;
+        long v = strtol(p, &end, 10);
+        if (end == p || v < 1 || v > 1000000000L || (*end != ',' && *end != '\0')) return 0;
+        sizes[count++] = (int)v;
+        p = (*end == ',') ? end + 1 : end;
+    }
+    return count;
+}
+
+// Calentamiento + repeticiones de una configuración.
+static inline BenchPoint bench_point(const SimConfig* base, BenchRunFn run, const char* mode,
+                                     int vehicles, int threads, BenchSetThreadsFn set_threads) {
+    SimConfig cfg = *base;
+    cfg.num_vehicles = vehicles;
+    if (set_threads) set_threads(threads);
+
+    const int trials = base->bench_trials;
+    double* per_step = (double*)malloc((size_t)trials * sizeof(double));
+    double* updates = (double*)malloc((size_t)trials * sizeof(double));
+    SimResult r = {0};
+    for (int w = 0; w < base->bench_warmup; ++w) run(&cfg, &r);
+    for (int k = 0; k < trials; ++k) {
+        run(&cfg, &r);
+        per_step[k] = r.loop_seconds / (r.steps > 0 ? r.steps : 1);
+        updates[k] = r.loop_seconds > 0.0 ? (double)r.vehicle_updates / r.loop_seconds : 0.0;
+    }
+    // La repetición mediana por tiempo da también los vehículos por segundo
+    int* order = (int*)malloc((size_t)trials * sizeof(int));
+    for (int k = 0; k < trials; ++k) order[k] = k;
+    for (int a = 1; a < trials; ++a) { // inserción: pocas repeticiones
+        int v = order[a], b = a;
+        while (b > 0 && per_step[order[b - 1]] > per_step[v]) { order[b] = order[b - 1]; --b; }
+        order[b] = v;
+    }
+    int med = order[(trials - 1) / 2];
+    int p95 = order[(int)ceil(0.95 * trials) - 1]; // rango más cercano
+
+    BenchPoint pt = { mode, vehicles, threads, r.steps, per_step[med], per_step[p95], updates[med] };
+    free(order);
+    free(per_step);
+    free(updates);
+    return pt;
+}
+
+static inline void bench_write_header(FILE* out, bool json) {
+    if (!json) {
+        fprintf(out, "engine,mode,vehicles,threads,steps,trials,median_step_us,p95_step_us,"
+                     "veh_updates_per_s,efficiency\n");
+    }
+}
+
+static inline void bench_write_point(FILE* out, bool json, const char* engine, const BenchPoint* pt,
+                                     int trials, double efficiency) {
+    if (json) {
+        fprintf(out, "{\"engine\":\"%s\",\"mode\":\"%s\",\"vehicles\":%d,\"threads\":%d,\"steps\":%d,"
+                     "\"trials\":%d,\"median_step_us\":%.3f,\"p95_step_us\":%.3f,"
+                     "\"veh_updates_per_s\":%.6e,\"efficiency\":%.4f}\n",
+                engine, pt->mode, pt->vehicles, pt->threads, pt->steps, trials,
+                pt->median_step * 1e6, pt->p95_step * 1e6, pt->updates_per_s, efficiency);
+    } else {
+        fprintf(out, "%s,%s,%d,%d,%d,%d,%.3f,%.3f,%.6e,%.4f\n",
+                engine, pt->mode, pt->vehicles, pt->threads, pt->steps, trials,
+                pt->median_step * 1e6, pt->p95_step * 1e6, pt->updates_per_s, efficiency);
+    }
+}
+
+// Barrido completo. threads[0] debe ser 1 (la base de la eficiencia). Escalado fuerte:
+// T(N, 1) / (p * T(N, p)); débil: T(N, 1) / T(N * p, p), comparando el tiempo total por paso.
+// Con --bench-out los resultados se agregan al archivo (el encabezado CSV solo si está vacío),
+// así las dos versiones quedan en la misma tabla.
+static inline void run_benchmark(const SimConfig* cfg, const char* engine, BenchRunFn run,
+                                 const int* threads, int num_thread_counts, BenchSetThreadsFn set_threads) {
+    int sizes[BENCH_MAX_SIZES];
+    int num_sizes = parse_bench_sizes(cfg->bench_sizes, sizes);
+    if (num_sizes == 0) {
+        fprintf(stderr, "Lista de tamaños inválida: %s (se espera p. ej. 1000,10000)\n", cfg->bench_sizes);
+        exit(1);
+    }
+
+    // El benchmark mide el motor: sin impresión, traza, checkpoints ni flujo continuo
+    SimConfig base = *cfg;
+    base.print_every = 0;
+    base.trace_path = NULL;
+    base.checkpoint_path = NULL;
+    base.resume_path = NULL;
+    base.arrival_rate = 0.0;
+    base.arrivals_path = NULL;
+    base.hash_log_path = NULL;
+    base.verify_path = NULL;
+
+    FILE* out = stdout;
+    if (cfg->bench_out) {
+        out = fopen(cfg->bench_out, "a");
+        if (!out) {
+            fprintf(stderr, "No se pudo abrir %s\n", cfg->bench_out);
+            exit(1);
+        }
+    }
+    if (out != stdout) fseek(out, 0, SEEK_END);
+    if (out == stdout || ftell(out) == 0) bench_write_header(out, cfg->bench_json);
+
+    for (int s = 0; s < num_sizes; ++s) {
+        double t1 = 0.0;
+        for (int k = 0; k < num_thread_counts; ++k) {
+            const int p = threads[k];
+            fprintf(stderr, "[bench] %s: %d vehículos, %d hilo(s)\n", engine, sizes[s], p);
+            BenchPoint strong = bench_point(&base, run, "strong", sizes[s], p, set_threads);
+            if (p == 1) t1 = strong.median_step;
+            bench_write_point(out, cfg->bench_json, engine, &strong, base.bench_trials,
+                              t1 / (p * strong.median_step));
+            if (p == 1) continue;
+            BenchPoint weak = bench_point(&base, run, "weak", sizes[s] * p, p, set_threads);
+            bench_write_point(out, cfg->bench_json, engine, &weak, base.bench_trials, t1 / weak.median_step);
+        }
+        fflush(out);
+    }
+    if (out != stdout) fclose(out);
+}
+
+#endif // TRAFFIC_BENCH_H
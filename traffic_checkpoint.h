@@ -0,0 +1,270 @@
+// traffic_checkpoint.h
+// Checkpoints de una corrida: volcado crudo de los arreglos de vehículos y semáforos más el
+// progreso (paso, tiempo simulado, cruces). Cada arreglo empieza en un múltiplo de
+// CHECKPOINT_ALIGN, así --resume mapea el archivo con mmap (MAP_PRIVATE) y usa los arreglos
+// en el lugar: no hay que reinicializar ni leer todo antes de seguir. Las páginas se copian
+// recién cuando alguien las escribe (y quedan en el nodo NUMA de ese hilo).
+
+#ifndef TRAFFIC_CHECKPOINT_H
+#define TRAFFIC_CHECKPOINT_H
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "traffic_core.h"
+
+#define CHECKPOINT_MAGIC   "TRAFCKP"
+#define CHECKPOINT_VERSION 3 // 2: flags y min_gap del seguimiento de vehículos; 3: semáforos actuados
+#define CHECKPOINT_ALIGN   4096
+
+enum {
+    CKP_LIGHTS = 0, CKP_SLOT, CKP_ID, CKP_LANE, CKP_POS, CKP_SPEED, CKP_WAITING, CKP_FINISHED,
+    CKP_TOTAL_WAIT, CKP_CROSSINGS, CKP_NUM_ARRAYS
+};
+
+// Opciones del modelo que tiene que repetir la corrida reanudada, y el formato de los arreglos.
+enum { CKP_FLAG_CAR_FOLLOWING = 1, CKP_FLAG_COMPACT = 2, CKP_FLAG_ACTUATED = 4 };
+
+#ifdef TRAFFIC_COMPACT
+#define CKP_STATE_FLAGS CKP_FLAG_COMPACT
+#else
+#define CKP_STATE_FLAGS 0
+#endif
+
+typedef struct {
+    char     magic[8];                     // CHECKPOINT_MAGIC (con el '\0')
+    uint32_t version;
+    uint32_t num_arrays;
+    uint64_t seed;
+    double   dt;
+    double   stop_distance;
+    int32_t  num_vehicles;
+    int32_t  num_lights;
+    int32_t  step;
+    int32_t  total_crossed;
+    int32_t  ff_steps;
+    int32_t  flags;                        // CKP_FLAG_*
+    double   sim_time;
+    double   min_gap;                      // con CKP_FLAG_CAR_FOLLOWING
+    double   max_green;                    // con CKP_FLAG_ACTUATED
+    double   max_wait;
+    int32_t  lane_begin[NUM_LANES + 1];
+    int32_t  lane_end[NUM_LANES];
+    int32_t  lane_live[NUM_LANES];
+    int32_t  lane_waiting[NUM_LANES];
+    uint64_t offset[CKP_NUM_ARRAYS];
+    uint64_t bytes[CKP_NUM_ARRAYS];
+} CheckpointHeader;
+
+// Progreso de la corrida fuera de V y X
+typedef struct {
+    int    step;
+    double sim_time;
+    int    total_crossed;
+    int    ff_steps;
+} SimProgress;
+
+// Mapeo de un checkpoint reanudado (los arreglos de V apuntan adentro)
+typedef struct {
+    void*  base;
+    size_t size;
+} CheckpointMapping;
+
+static inline void checkpoint_arrays(const VehicleSoA* S, const Intersection* X,
+                                     const void* ptr[CKP_NUM_ARRAYS], uint64_t bytes[CKP_NUM_ARRAYS]) {
+    const size_t n = (size_t)S->n;
+    ptr[CKP_LIGHTS]     = X->lights;     bytes[CKP_LIGHTS]     = (size_t)X->num_lights * sizeof(TrafficLight);
+    ptr[CKP_SLOT]       = S->slot;       bytes[CKP_SLOT]       = n * sizeof(int);
+    ptr[CKP_ID]         = S->id;         bytes[CKP_ID]         = n * sizeof(int);
+    ptr[CKP_LANE]       = S->lane;       bytes[CKP_LANE]       = n * sizeof(lane_t);
+    ptr[CKP_POS]        = S->pos;        bytes[CKP_POS]        = n * sizeof(real_t);
+    ptr[CKP_SPEED]      = S->speed;      bytes[CKP_SPEED]      = n * sizeof(real_t);
+    ptr[CKP_WAITING]    = S->waiting;    bytes[CKP_WAITING]    = n;
+    ptr[CKP_FINISHED]   = S->finished;   bytes[CKP_FINISHED]   = n;
+    ptr[CKP_TOTAL_WAIT] = S->total_wait; bytes[CKP_TOTAL_WAIT] = n * sizeof(real_t);
+    ptr[CKP_CROSSINGS]  = S->crossings;  bytes[CKP_CROSSINGS]  = n * sizeof(cross_t);
+}
+
+// fsync del directorio de path, para que el rename quede en disco y no solo en la caché.
+static inline bool checkpoint_sync_dir(const char* path) {
+    const char* slash = strrchr(path, '/');
+    size_t len = slash ? (slash == path ? 1 : (size_t)(slash - path)) : 1;
+    char* dir = (char*)malloc(len + 1);
+    if (slash) memcpy(dir, path, len);
+    else dir[0] = '.';
+    dir[len] = '\0';
+    int fd = open(dir, O_RDONLY);
+    free(dir);
+    if (fd < 0) return false;
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+// Escribe el checkpoint en path.tmp, lo baja a disco (fsync) y lo renombra, y después baja el
+// directorio: si el proceso o el nodo caen a mitad de la escritura, el checkpoint anterior sigue
+// intacto. S debe tener los contadores por carril al día.
+static inline bool checkpoint_write(const char* path, const SimConfig* cfg, const VehicleSoA* S,
+                                    const Intersection* X, const SimProgress* P) {
+    CheckpointHeader H = {0};
+    memcpy(H.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+    H.version       = CHECKPOINT_VERSION;
+    H.num_arrays    = CKP_NUM_ARRAYS;
+    H.seed          = cfg->seed;
+    H.dt            = cfg->dt;
+    H.stop_distance = X->stop_distance;
+    H.num_vehicles  = S->n;
+    H.num_lights    = X->num_lights;
+    H.step          = P->step;
+    H.total_crossed = P->total_crossed;
+    H.ff_steps      = P->ff_steps;
+    H.flags         = (cfg->car_following ? CKP_FLAG_CAR_FOLLOWING : 0) |
+                      (cfg->actuated ? CKP_FLAG_ACTUATED : 0) | CKP_STATE_FLAGS;
+    H.min_gap       = cfg->min_gap;
+    H.max_green     = cfg->max_green;
+    H.max_wait      = cfg->max_wait;
+    H.sim_time      = P->sim_time;
+    for (int l = 0; l <= NUM_LANES; ++l) H.lane_begin[l] = S->lane_begin[l];
+    for (int l = 0; l < NUM_LANES; ++l) {
+        H.lane_end[l] = S->lane_end[l];
+        H.lane_live[l] = S->lane_live[l];
+        H.lane_waiting[l] = S->lane_waiting[l];
+    }
+
+    const void* ptr[CKP_NUM_ARRAYS];
+    checkpoint_arrays(S, X, ptr, H.bytes);
+    uint64_t off = CHECKPOINT_ALIGN; // el encabezado ocupa la primera página
+    for (int a = 0; a < CKP_NUM_ARRAYS; ++a) {
+        H.offset[a] = off;
+        off += (H.bytes[a] + CHECKPOINT_ALIGN - 1) / CHECKPOINT_ALIGN * CHECKPOINT_ALIGN;
+    }
+
+    size_t len = strlen(path);
+    char* tmp = (char*)malloc(len + 5);
+    memcpy(tmp, path, len);
+    memcpy(tmp + len, ".tmp", 5);
+    FILE* f = fopen(tmp, "wb");
+    bool ok = (f != NULL);
+    if (ok) {
+        ok = fwrite(&H, sizeof(H), 1, f) == 1;
+        for (int a = 0; a < CKP_NUM_ARRAYS && ok; ++a) {
+            ok = fseek(f, (long)H.offset[a], SEEK_SET) == 0 &&
+                 fwrite(ptr[a], 1, H.bytes[a], f) == H.bytes[a];
+        }
+        // Largo total múltiplo de página (el último arreglo también se mapea completo)
+        ok = ok && fseek(f, (long)off - 1, SEEK_SET) == 0 && fputc(0, f) != EOF;
+        ok = ok && fflush(f) == 0 && fsync(fileno(f)) == 0;
+        ok = (fclose(f) == 0) && ok;
+        ok = ok && rename(tmp, path) == 0 && checkpoint_sync_dir(path);
+    }
+    if (!ok) fprintf(stderr, "No se pudo escribir el checkpoint: %s\n", path);
+    free(tmp);
+    return ok;
+}
+
+// Lee solo el encabezado (para fijar vehículos, semilla y dt antes de correr).
+static inline bool checkpoint_read_header(const char* path, CheckpointHeader* H) {
+    FILE* f = fopen(path, "rb");
+    bool ok = f && fread(H, sizeof(*H), 1, f) == 1 &&
+              memcmp(H->magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) == 0 &&
+              H->version == CHECKPOINT_VERSION && H->num_arrays == CKP_NUM_ARRAYS;
+    if (f) fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Checkpoint inválido o de otra versión: %s\n", path);
+    } else if ((H->flags & CKP_FLAG_COMPACT) != CKP_STATE_FLAGS) {
+        fprintf(stderr, "El checkpoint %s es de la otra precisión del estado (con/sin -DTRAFFIC_COMPACT)\n", path);
+        ok = false;
+    }
+    return ok;
+}
+
+// Toma vehículos, semilla, dt, el modelo de seguimiento y el control de los semáforos del
+// checkpoint (--resume); el resto de las opciones sigue igual.
+static inline void checkpoint_apply_config(const char* path, SimConfig* cfg) {
+    CheckpointHeader H;
+    if (!checkpoint_read_header(path, &H)) exit(1);
+    cfg->num_vehicles = H.num_vehicles;
+    cfg->seed = (unsigned int)H.seed;
+    cfg->dt = H.dt;
+    cfg->car_following = (H.flags & CKP_FLAG_CAR_FOLLOWING) != 0;
+    if (cfg->car_following) cfg->min_gap = H.min_gap;
+    cfg->actuated = (H.flags & CKP_FLAG_ACTUATED) != 0;
+    if (cfg->actuated) {
+        cfg->max_green = H.max_green;
+        cfg->max_wait = H.max_wait;
+    }
+}
+
+// Mapea un checkpoint: los arreglos de S apuntan al mapeo; los semáforos se copian a X (son
+// pocos y la simulación los libera con free). Devuelve false si el archivo no es válido.
+static inline bool checkpoint_map(const char* path, VehicleSoA* S, Intersection* X, SimProgress* P,
+                                  CheckpointMapping* M) {
+    CheckpointHeader H;
+    if (!checkpoint_read_header(path, &H)) return false;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, "No se pudo abrir el checkpoint: %s\n", path);
+        return false;
+    }
+    for (int a = 0; a < CKP_NUM_ARRAYS; ++a) {
+        if (H.offset[a] + H.bytes[a] > (uint64_t)st.st_size) {
+            close(fd);
+            fprintf(stderr, "Checkpoint truncado: %s\n", path);
+            return false;
+        }
+    }
+    M->size = (size_t)st.st_size;
+    M->base = mmap(NULL, M->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (M->base == MAP_FAILED) {
+        fprintf(stderr, "mmap del checkpoint falló: %s\n", path);
+        return false;
+    }
+    unsigned char* base = (unsigned char*)M->base;
+
+    S->n = H.num_vehicles;
+    for (int l = 0; l <= NUM_LANES; ++l) S->lane_begin[l] = H.lane_begin[l];
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_end[l] = H.lane_end[l];
+        S->lane_live[l] = H.lane_live[l];
+        S->lane_waiting[l] = H.lane_waiting[l];
+    }
+    S->slot       = (int*)(base + H.offset[CKP_SLOT]);
+    S->id         = (int*)(base + H.offset[CKP_ID]);
+    S->lane       = (lane_t*)(base + H.offset[CKP_LANE]);
+    S->pos        = (real_t*)(base + H.offset[CKP_POS]);
+    S->speed      = (real_t*)(base + H.offset[CKP_SPEED]);
+    S->waiting    = base + H.offset[CKP_WAITING];
+    S->finished   = base + H.offset[CKP_FINISHED];
+    S->total_wait = (real_t*)(base + H.offset[CKP_TOTAL_WAIT]);
+    S->crossings  = (cross_t*)(base + H.offset[CKP_CROSSINGS]);
+
+    X->num_lanes = NUM_LANES;
+    X->num_lights = H.num_lights;
+    X->stop_distance = H.stop_distance;
+    X->lights = (TrafficLight*)malloc(H.bytes[CKP_LIGHTS]);
+    memcpy(X->lights, base + H.offset[CKP_LIGHTS], H.bytes[CKP_LIGHTS]);
+
+    P->step = H.step;
+    P->sim_time = H.sim_time;
+    P->total_crossed = H.total_crossed;
+    P->ff_steps = H.ff_steps;
+    return true;
+}
+
+static inline void checkpoint_unmap(CheckpointMapping* M) {
+    munmap(M->base, M->size);
+    *M = (CheckpointMapping){0};
+}
+
+// Próximo paso (múltiplo de every) en que toca checkpoint, después de step.
+static inline int next_checkpoint_step(int step, int every) {
+    return (step / every + 1) * every;
+}
+
+#endif // TRAFFIC_CHECKPOINT_H
@@ -0,0 +1,917 @@
+// traffic_core.h
+// Núcleo compartido por traffic_seq.c y traffic_omp.c: estructuras, semáforos,
+// almacenamiento de vehículos en formato SoA (structure-of-arrays) y kernel de movimiento.
+
+#ifndef TRAFFIC_CORE_H
+#define TRAFFIC_CORE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+typedef enum { RED = 0, GREEN = 1, YELLOW = 2 } LightState;
+
+// ----------------------- Estructuras -----------------------
+typedef struct {
+    int        id;
+    LightState state;
+    double     time_in_state; // segundos en el estado actual
+    double     t_green;       // duración de verde (<= 10 s)
+    double     t_yellow;      // duración de amarillo (<= 10 s)
+    double     t_red;         // duración de rojo (<= 10 s)
+} TrafficLight;
+
+typedef struct {
+    int           num_lanes;
+    int           num_lights;
+    double        stop_distance;
+    TrafficLight* lights;
+} Intersection;
+
+// Número de carriles (y semáforos) de la intersección: N, E, S, O.
+#define NUM_LANES 4
+
+// Estado compacto (compilar con -DTRAFFIC_COMPACT): posición, velocidad y espera en float, carril y
+// cruces en un byte. Un vehículo ocupa 24 bytes en lugar de 42 y los campos que recorre el kernel
+// en cada paso 15 en lugar de 30: entran el doble de vehículos en memoria y en cada recorrido.
+// Los resultados se apartan un poco de los del estado en double (ver --verify-tolerance).
+#ifdef TRAFFIC_COMPACT
+typedef float   real_t;
+typedef uint8_t lane_t;
+typedef uint8_t cross_t;
+#else
+typedef double  real_t;
+typedef int     lane_t;
+typedef int     cross_t;
+#endif
+
+// Vehículos en formato SoA: un arreglo contiguo por campo.
+// Campos calientes (los que toca el kernel en cada paso): pos, speed, waiting, finished.
+// Campos fríos (solo al cruzar / imprimir / resumir): id, lane, total_wait, crossings.
+// Los vehículos se agrupan por carril: el carril L ocupa [lane_begin[L], lane_begin[L+1]),
+// ordenado por distancia a la línea de alto. Los que ya cruzaron se compactan al final de su
+// carril: [lane_begin[L], lane_end[L]) contiene a todos los que siguen en ruta, así el costo de
+// cada paso depende de los vivos y no del total.
+typedef struct {
+    int            n;
+    int            lane_begin[NUM_LANES + 1];
+    int            lane_end[NUM_LANES];      // fin del rango activo del carril
+    int            lane_live[NUM_LANES];     // vehículos del carril que todavía no cruzan
+    int            lane_waiting[NUM_LANES];  // de los vivos, cuántos están detenidos
+    int*           slot;        // slot[id] = posición actual del vehículo id en los arreglos (NULL en flujo continuo)
+    int*           id;
+    lane_t*        lane;        // 0..3 (N, E, S, O)
+    real_t*        pos;         // distancia a la línea de alto (m)
+    real_t*        speed;       // m/s
+    unsigned char* waiting;     // 1 si está detenido
+    unsigned char* finished;    // VEH_EN_ROUTE / VEH_DONE / VEH_CROSSED_NOW (distinto de 0 = ya cruzó)
+    real_t*        total_wait;  // s acumulados esperando
+    cross_t*       crossings;   // 0 o 1 (cruzó)
+} VehicleSoA;
+
+// Valores de VehicleSoA.finished. VEH_CROSSED_NOW marca a los que cruzaron en el último paso
+// del kernel; en el paso siguiente pasan a VEH_DONE.
+enum { VEH_EN_ROUTE = 0, VEH_DONE = 1, VEH_CROSSED_NOW = 2 };
+
+// Lista de eventos de cruce (ids de vehículos). Una por hilo en la versión OpenMP; alineada a
+// la línea de caché para que los contadores de hilos vecinos no compartan línea.
+typedef struct {
+    _Alignas(64) int* ids;
+    int count;
+    int cap;
+} EventBuffer;
+
+// Parámetros de una corrida (línea de comandos: v t [semilla] [--opciones])
+typedef struct {
+    int          num_vehicles;  // vehículos
+    int          print_every;   // imprimir cada k pasos (= k segundos); 0 = sin impresión
+    double       dt;            // s
+    unsigned int seed;
+    bool         fast_forward;  // saltar en bloque los pasos sin eventos (ver quiet_steps)
+    bool         numa_report;   // informar en qué nodo NUMA quedó cada arreglo (solo traffic_omp)
+    bool         huge_pages;    // arena de la corrida en páginas de 2 MiB (ver traffic_arena.h)
+    const char*  trace_path;    // traza binaria de trayectorias, NULL = sin traza (solo traffic_omp)
+    const char*  checkpoint_path;  // checkpoint periódico (traffic_seq / traffic_omp), NULL = no
+    int          checkpoint_every; // cada cuántos pasos
+    const char*  resume_path;      // reanudar desde este checkpoint, NULL = corrida nueva
+    double       arrival_rate;  // flujo continuo: llegadas por segundo y carril, 0 = flota fija
+    const char*  arrivals_path; // flujo continuo desde un archivo de llegadas, NULL = no
+    double       duration;      // duración simulada del flujo continuo (s)
+    const char*  hash_log_path; // hash del estado después de cada paso (ver traffic_verify.h)
+    const char*  verify_path;   // comparar paso a paso con este log de hashes, NULL = no
+    double       verify_tolerance; // relativa, contra un log de la otra precisión del estado
+    bool         profile;       // tiempos por fase y por hilo del bucle (ver traffic_profile.h)
+    bool         perf_counters; // además, contadores de hardware alrededor del movimiento
+    bool         bench;         // modo benchmark (ver traffic_bench.h)
+    const char*  batch_path;    // lote de escenarios (solo traffic_omp, ver traffic_batch.h)
+    const char*  bench_sizes;   // vehículos del barrido, "1000,10000,..."
+    int          bench_trials;  // repeticiones medidas por punto
+    int          bench_warmup;  // corridas de calentamiento por punto
+    const char*  bench_out;     // agregar resultados a este archivo, NULL = stdout
+    bool         bench_json;    // JSON Lines en lugar de CSV
+    int          ensemble;      // réplicas del ensamble de Monte Carlo, 0 = corrida única
+    const char*  ensemble_out;  // una fila CSV por réplica, NULL = no
+    bool         car_following; // seguimiento con distancia mínima al de adelante (ver traffic_follow.h)
+    double       min_gap;       // m, distancia mínima al de adelante
+    bool         actuated;      // semáforos actuados por la demanda de cada carril (ver traffic_actuated.h)
+    double       max_green;     // s, tope del verde extendido
+    double       max_wait;      // s, espera promedio de la cola que corta un rojo
+    int          time_block;    // pasos por bloque temporal, 1 = paso a paso (solo traffic_omp, ver traffic_tiling.h)
+    bool         offload;       // mover los vehículos en el dispositivo (solo traffic_omp, ver traffic_offload.h)
+    const char*  stats_path;    // serie de estadísticas por paso (ver traffic_stats.h), NULL = no
+    const char*  metrics_name;  // página de métricas en vivo /dev/shm/NOMBRE (ver traffic_metrics.h), NULL = no
+    const char*  scenario_path; // escenario (ver traffic_scenario.h), NULL = semilla y argumentos
+    const char*  vehicle_table; // tabla de vehículos del escenario, mapeada en lugar de sortear; NULL = no
+    int          grid_rows;     // malla de intersecciones (solo traffic_grid / traffic_mpi)
+    int          grid_cols;
+} SimConfig;
+
+// ----------------------- Utilidades -----------------------
+// Generador por contador (SplitMix64): cada número sale de (semilla, flujo, índice, componente)
+// y no del orden de las llamadas, así la inicialización puede ser un bucle paralelo y la
+// configuración es la misma con cualquier número de hilos o procesos.
+enum { RNG_LIGHTS = 1, RNG_VEHICLES = 2, RNG_GRID_LIGHTS = 3, RNG_GRID_VEHICLES = 4, RNG_ARRIVALS = 5 };
+
+static inline uint64_t splitmix64(uint64_t x) {
+    x += 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    return x ^ (x >> 31);
+}
+
+// Uniforme en [a, b) para el componente `component` (< 8) del elemento `index` del flujo `stream`.
+static inline double rng_uniform(unsigned int seed, int stream, uint64_t index, int component,
+                                 double a, double b) {
+    uint64_t key = splitmix64(((uint64_t)seed << 8) | (uint64_t)stream);
+    uint64_t x = splitmix64(key ^ splitmix64(index * 8 + (uint64_t)component));
+    return a + (b - a) * ((double)(x >> 11) * 0x1.0p-53); // 53 bits de mantisa
+}
+
+static inline const char* state_to_str(LightState s) {
+    return (s == GREEN) ? "V" : (s == YELLOW ? "A" : "R");
+}
+
+static inline int cmp_int(const void* a, const void* b) {
+    int x = *(const int*)a, y = *(const int*)b;
+    return (x > y) - (x < y);
+}
+
+static inline void print_usage(const char* prog) {
+    fprintf(stderr, "Uso: %s [vehículos] [imprimir_cada] [semilla] [--fast-forward] [--grid FxC]\n"
+                    "       [--numa-report] [--huge-pages] [--trace archivo] [--checkpoint archivo]\n"
+                    "       [--checkpoint-every K] [--resume archivo]\n"
+                    "       [--arrival-rate R | --arrivals archivo] [--duration S]\n"
+                    "       [--bench] [--bench-sizes N1,N2,...] [--bench-trials K] [--bench-warmup W]\n"
+                    "       [--bench-out archivo] [--bench-json] [--profile] [--perf-counters]\n"
+                    "       [--hash-log archivo] [--verify-against archivo] [--verify-tolerance R]\n"
+                    "       [--batch archivo]\n"
+                    "       [--ensemble K] [--ensemble-out archivo] [--car-following] [--min-gap M]\n"
+                    "       [--actuated] [--max-green S] [--max-wait S] [--time-block K]\n"
+                    "       [--offload] [--stats archivo] [--metrics nombre] [--scenario archivo]\n", prog);
+}
+
+static inline void parse_sim_args(int argc, char** argv, SimConfig* cfg) {
+    cfg->num_vehicles = 200;
+    cfg->print_every  = 5;
+    cfg->dt           = 1.0;
+    cfg->seed         = (unsigned int)time(NULL);
+    cfg->fast_forward = false;
+    cfg->numa_report  = false;
+    cfg->huge_pages   = false;
+    cfg->trace_path   = NULL;
+    cfg->checkpoint_path  = NULL;
+    cfg->checkpoint_every = 100;
+    cfg->resume_path      = NULL;
+    cfg->arrival_rate  = 0.0;
+    cfg->arrivals_path = NULL;
+    cfg->duration      = 3600.0;
+    cfg->hash_log_path = NULL;
+    cfg->verify_path   = NULL;
+    cfg->verify_tolerance = 0.01;
+    cfg->profile       = false;
+    cfg->perf_counters = false;
+    cfg->bench         = false;
+    cfg->batch_path    = NULL;
+    cfg->bench_sizes   = "1000,10000,100000,1000000";
+    cfg->bench_trials  = 5;
+    cfg->bench_warmup  = 1;
+    cfg->bench_out     = NULL;
+    cfg->bench_json    = false;
+    cfg->ensemble      = 0;
+    cfg->ensemble_out  = NULL;
+    cfg->car_following = false;
+    cfg->min_gap       = 7.5;
+    cfg->actuated      = false;
+    cfg->max_green     = 20.0;
+    cfg->max_wait      = 5.0;
+    cfg->time_block    = 1;
+    cfg->offload       = false;
+    cfg->stats_path    = NULL;
+    cfg->metrics_name  = NULL;
+    cfg->scenario_path = NULL;
+    cfg->vehicle_table = NULL;
+    cfg->grid_rows    = 4;
+    cfg->grid_cols    = 4;
+
+    int positional = 0;
+    for (int a = 1; a < argc; ++a) {
+        if (strcmp(argv[a], "--fast-forward") == 0) {
+            cfg->fast_forward = true;
+        } else if (strcmp(argv[a], "--numa-report") == 0) {
+            cfg->numa_report = true;
+        } else if (strcmp(argv[a], "--huge-pages") == 0) {
+            cfg->huge_pages = true;
+        } else if (strcmp(argv[a], "--trace") == 0 && a + 1 < argc) {
+            cfg->trace_path = argv[++a];
+        } else if (strcmp(argv[a], "--checkpoint") == 0 && a + 1 < argc) {
+            cfg->checkpoint_path = argv[++a];
+        } else if (strcmp(argv[a], "--checkpoint-every") == 0 && a + 1 < argc) {
+            cfg->checkpoint_every = atoi(argv[++a]);
+            if (cfg->checkpoint_every < 1) {
+                fprintf(stderr, "Intervalo de checkpoint inválido: %s\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--resume") == 0 && a + 1 < argc) {
+            cfg->resume_path = argv[++a];
+        } else if (strcmp(argv[a], "--arrival-rate") == 0 && a + 1 < argc) {
+            cfg->arrival_rate = atof(argv[++a]);
+            if (!(cfg->arrival_rate > 0.0)) {
+                fprintf(stderr, "Tasa de llegadas inválida: %s (vehículos/s por carril, > 0)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--arrivals") == 0 && a + 1 < argc) {
+            cfg->arrivals_path = argv[++a];
+        } else if (strcmp(argv[a], "--duration") == 0 && a + 1 < argc) {
+            cfg->duration = atof(argv[++a]);
+            if (!(cfg->duration > 0.0)) {
+                fprintf(stderr, "Duración inválida: %s (segundos, > 0)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--hash-log") == 0 && a + 1 < argc) {
+            cfg->hash_log_path = argv[++a];
+        } else if (strcmp(argv[a], "--verify-against") == 0 && a + 1 < argc) {
+            cfg->verify_path = argv[++a];
+        } else if (strcmp(argv[a], "--verify-tolerance") == 0 && a + 1 < argc) {
+            cfg->verify_tolerance = atof(argv[++a]);
+            if (!(cfg->verify_tolerance >= 0.0)) {
+                fprintf(stderr, "Tolerancia inválida: %s (relativa, >= 0)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--profile") == 0) {
+            cfg->profile = true;
+        } else if (strcmp(argv[a], "--perf-counters") == 0) {
+            cfg->profile = cfg->perf_counters = true;
+        } else if (strcmp(argv[a], "--batch") == 0 && a + 1 < argc) {
+            cfg->batch_path = argv[++a];
+        } else if (strcmp(argv[a], "--bench") == 0) {
+            cfg->bench = true;
+        } else if (strcmp(argv[a], "--bench-sizes") == 0 && a + 1 < argc) {
+            cfg->bench_sizes = argv[++a];
+        } else if (strcmp(argv[a], "--bench-trials") == 0 && a + 1 < argc) {
+            cfg->bench_trials = atoi(argv[++a]);
+            if (cfg->bench_trials < 1) {
+                fprintf(stderr, "Repeticiones inválidas: %s\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--bench-warmup") == 0 && a + 1 < argc) {
+            char* end;
+            long warmup = strtol(argv[++a], &end, 10); // 0 vale: atoi no distingue "abc"
+            cfg->bench_warmup = (int)warmup;
+            if (end == argv[a] || *end != '\0' || warmup < 0 || warmup > 1000000000L) {
+                fprintf(stderr, "Calentamiento inválido: %s\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--bench-out") == 0 && a + 1 < argc) {
+            cfg->bench_out = argv[++a];
+        } else if (strcmp(argv[a], "--bench-json") == 0) {
+            cfg->bench_json = true;
+        } else if (strcmp(argv[a], "--ensemble") == 0 && a + 1 < argc) {
+            cfg->ensemble = atoi(argv[++a]);
+            if (cfg->ensemble < 1) {
+                fprintf(stderr, "Réplicas inválidas: %s\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--ensemble-out") == 0 && a + 1 < argc) {
+            cfg->ensemble_out = argv[++a];
+        } else if (strcmp(argv[a], "--car-following") == 0) {
+            cfg->car_following = true;
+        } else if (strcmp(argv[a], "--min-gap") == 0 && a + 1 < argc) {
+            cfg->min_gap = atof(argv[++a]);
+            if (!(cfg->min_gap > 2.0)) { // más que stop_distance: solo el primero de la cola llega a la línea
+                fprintf(stderr, "Distancia mínima inválida: %s (m, > 2)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--actuated") == 0) {
+            cfg->actuated = true;
+        } else if (strcmp(argv[a], "--max-green") == 0 && a + 1 < argc) {
+            cfg->max_green = atof(argv[++a]);
+            if (!(cfg->max_green > 0.0)) {
+                fprintf(stderr, "Verde máximo inválido: %s (s, > 0)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--max-wait") == 0 && a + 1 < argc) {
+            cfg->max_wait = atof(argv[++a]);
+            if (!(cfg->max_wait > 0.0)) {
+                fprintf(stderr, "Espera máxima inválida: %s (s, > 0)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--time-block") == 0 && a + 1 < argc) {
+            cfg->time_block = atoi(argv[++a]);
+            if (cfg->time_block < 1 || cfg->time_block > 64) { // TIME_BLOCK_MAX
+                fprintf(stderr, "Bloque temporal inválido: %s (pasos, 1 a 64)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strcmp(argv[a], "--offload") == 0) {
+            cfg->offload = true;
+        } else if (strcmp(argv[a], "--stats") == 0 && a + 1 < argc) {
+            cfg->stats_path = argv[++a];
+        } else if (strcmp(argv[a], "--metrics") == 0 && a + 1 < argc) {
+            cfg->metrics_name = argv[++a];
+        } else if (strcmp(argv[a], "--scenario") == 0 && a + 1 < argc) {
+            cfg->scenario_path = argv[++a];
+        } else if (strcmp(argv[a], "--grid") == 0 && a + 1 < argc) {
+            if (sscanf(argv[++a], "%dx%d", &cfg->grid_rows, &cfg->grid_cols) != 2 ||
+                cfg->grid_rows < 1 || cfg->grid_cols < 1) {
+                fprintf(stderr, "Malla inválida: %s (se espera FxC, p. ej. 8x8)\n", argv[a]);
+                exit(1);
+            }
+        } else if (strncmp(argv[a], "--", 2) == 0) {
+            fprintf(stderr, "Opción desconocida: %s\n", argv[a]);
+            print_usage(argv[0]);
+            exit(1);
+        } else {
+            switch (positional++) {
+                case 0: cfg->num_vehicles = atoi(argv[a]); break;
+                case 1: cfg->print_every = atoi(argv[a]); break;
+                case 2: cfg->seed = (unsigned int)atoi(argv[a]); break;
+                default:
+                    print_usage(argv[0]);
+                    exit(1);
+            }
+        }
+    }
+}
+
+// ----------------------- Opciones incompatibles -----------------------
+// Todas las combinaciones rechazadas están en la tabla de sim_check_config. Cada main la revisa
+// después de leer los argumentos y otra vez después de cargar un escenario o un checkpoint, que
+// pueden prender opciones.
+typedef enum {
+    OPT_FAST_FORWARD, OPT_TRACE, OPT_CHECKPOINT, OPT_RESUME, OPT_HASH_LOG, OPT_VERIFY, OPT_PROFILE,
+    OPT_BENCH, OPT_BATCH, OPT_ENSEMBLE, OPT_ARRIVAL_RATE, OPT_ARRIVALS, OPT_STREAM, OPT_CAR_FOLLOWING,
+    OPT_ACTUATED, OPT_TIME_BLOCK, OPT_OFFLOAD, OPT_STATS, OPT_METRICS, OPT_SCENARIO, OPT_COUNT
+} SimOption;
+
+static inline bool sim_option_on(const SimConfig* cfg, SimOption o) {
+    switch (o) {
+        case OPT_FAST_FORWARD:  return cfg->fast_forward;
+        case OPT_TRACE:         return cfg->trace_path != NULL;
+        case OPT_CHECKPOINT:    return cfg->checkpoint_path != NULL;
+        case OPT_RESUME:        return cfg->resume_path != NULL;
+        case OPT_HASH_LOG:      return cfg->hash_log_path != NULL;
+        case OPT_VERIFY:        return cfg->verify_path != NULL;
+        case OPT_PROFILE:       return cfg->profile;
+        case OPT_BENCH:         return cfg->bench;
+        case OPT_BATCH:         return cfg->batch_path != NULL;
+        case OPT_ENSEMBLE:      return cfg->ensemble > 0;
+        case OPT_ARRIVAL_RATE:  return cfg->arrival_rate > 0.0;
+        case OPT_ARRIVALS:      return cfg->arrivals_path != NULL;
+        case OPT_STREAM:        return cfg->arrival_rate > 0.0 || cfg->arrivals_path != NULL;
+        case OPT_CAR_FOLLOWING: return cfg->car_following;
+        case OPT_ACTUATED:      return cfg->actuated;
+        case OPT_TIME_BLOCK:    return cfg->time_block > 1;
+        case OPT_OFFLOAD:       return cfg->offload;
+        case OPT_STATS:         return cfg->stats_path != NULL;
+        case OPT_METRICS:       return cfg->metrics_name != NULL;
+        case OPT_SCENARIO:      return cfg->scenario_path != NULL;
+        default:                return false;
+    }
+}
+
+static inline const char* sim_option_name(SimOption o) {
+    static const char* const name[OPT_COUNT] = {
+        "--fast-forward", "--trace", "--checkpoint", "--resume", "--hash-log", "--verify-against",
+        "--profile", "--bench", "--batch", "--ensemble", "--arrival-rate", "--arrivals",
+        "flujo continuo (--arrival-rate / --arrivals)", "--car-following", "--actuated",
+        "--time-block", "--offload", "--stats", "--metrics", "--scenario"
+    };
+    return name[o];
+}
+
+// Sale con un mensaje si la configuración prende dos opciones que no se combinan.
+static inline void sim_check_config(const SimConfig* cfg) {
+    // { opción, la que no está disponible con ella }, en el orden en que se informan
+    static const SimOption conflict[][2] = {
+        { OPT_SCENARIO, OPT_RESUME }, // el checkpoint ya trae vehículos y semáforos
+        { OPT_SCENARIO, OPT_BENCH }, { OPT_SCENARIO, OPT_BATCH }, { OPT_SCENARIO, OPT_ENSEMBLE },
+        { OPT_SCENARIO, OPT_ARRIVAL_RATE }, { OPT_SCENARIO, OPT_ARRIVALS },
+
+        { OPT_ENSEMBLE, OPT_FAST_FORWARD }, { OPT_ENSEMBLE, OPT_TRACE }, { OPT_ENSEMBLE, OPT_CHECKPOINT },
+        { OPT_ENSEMBLE, OPT_RESUME }, { OPT_ENSEMBLE, OPT_HASH_LOG }, { OPT_ENSEMBLE, OPT_VERIFY },
+        { OPT_ENSEMBLE, OPT_PROFILE }, { OPT_ENSEMBLE, OPT_BENCH }, { OPT_ENSEMBLE, OPT_ARRIVAL_RATE },
+        { OPT_ENSEMBLE, OPT_ARRIVALS }, { OPT_ENSEMBLE, OPT_CAR_FOLLOWING }, { OPT_ENSEMBLE, OPT_ACTUATED },
+        { OPT_ENSEMBLE, OPT_TIME_BLOCK }, { OPT_ENSEMBLE, OPT_OFFLOAD }, { OPT_ENSEMBLE, OPT_STATS },
+        { OPT_ENSEMBLE, OPT_METRICS },
+
+        { OPT_ARRIVAL_RATE, OPT_ARRIVALS },
+        { OPT_STREAM, OPT_FAST_FORWARD }, { OPT_STREAM, OPT_TRACE }, { OPT_STREAM, OPT_CHECKPOINT },
+        { OPT_STREAM, OPT_RESUME }, { OPT_STREAM, OPT_HASH_LOG }, { OPT_STREAM, OPT_VERIFY },
+        { OPT_STREAM, OPT_CAR_FOLLOWING }, { OPT_STREAM, OPT_ACTUATED }, { OPT_STREAM, OPT_TIME_BLOCK },
+        { OPT_STREAM, OPT_OFFLOAD }, { OPT_STREAM, OPT_STATS }, { OPT_STREAM, OPT_METRICS },
+
+        { OPT_CAR_FOLLOWING, OPT_FAST_FORWARD }, { OPT_CAR_FOLLOWING, OPT_BATCH },
+
+        { OPT_ACTUATED, OPT_FAST_FORWARD }, { OPT_ACTUATED, OPT_CAR_FOLLOWING }, { OPT_ACTUATED, OPT_BATCH },
+
+        { OPT_TIME_BLOCK, OPT_FAST_FORWARD }, { OPT_TIME_BLOCK, OPT_CAR_FOLLOWING },
+        { OPT_TIME_BLOCK, OPT_ACTUATED }, { OPT_TIME_BLOCK, OPT_STATS }, { OPT_TIME_BLOCK, OPT_BATCH },
+
+        { OPT_OFFLOAD, OPT_FAST_FORWARD }, { OPT_OFFLOAD, OPT_CAR_FOLLOWING }, { OPT_OFFLOAD, OPT_ACTUATED },
+        { OPT_OFFLOAD, OPT_TIME_BLOCK }, { OPT_OFFLOAD, OPT_PROFILE }, { OPT_OFFLOAD, OPT_STATS },
+        { OPT_OFFLOAD, OPT_METRICS }, { OPT_OFFLOAD, OPT_BATCH },
+
+        { OPT_STATS, OPT_BATCH },
+        { OPT_METRICS, OPT_BATCH },
+    };
+    for (size_t k = 0; k < sizeof(conflict) / sizeof(conflict[0]); ++k) {
+        if (sim_option_on(cfg, conflict[k][0]) && sim_option_on(cfg, conflict[k][1])) {
+            fprintf(stderr, "%s no está disponible con %s\n", sim_option_name(conflict[k][1]),
+                    sim_option_name(conflict[k][0]));
+            exit(1);
+        }
+    }
+}
+
+// ----------------------- Eventos de cruce -----------------------
+static inline void event_buffer_reserve(EventBuffer* E, int cap) {
+    if (cap <= E->cap) return;
+    int new_cap = E->cap ? E->cap : 64;
+    while (new_cap < cap) new_cap *= 2;
+    E->ids = (int*)realloc(E->ids, (size_t)new_cap * sizeof(int));
+    E->cap = new_cap;
+}
+
+static inline void event_buffer_push(EventBuffer* E, int id) {
+    if (E->count == E->cap) event_buffer_reserve(E, E->count + 1);
+    E->ids[E->count++] = id;
+}
+
+static inline void event_buffer_append(EventBuffer* dst, const EventBuffer* src) {
+    event_buffer_reserve(dst, dst->count + src->count);
+    for (int k = 0; k < src->count; ++k) dst->ids[dst->count + k] = src->ids[k];
+    dst->count += src->count;
+}
+
+static inline void event_buffer_free(EventBuffer* E) {
+    free(E->ids);
+    E->ids = NULL;
+    E->count = E->cap = 0;
+}
+
+// ----------------------- Semáforos -----------------------
+static inline void update_traffic_light(TrafficLight* L, double dt) {
+    L->time_in_state += dt;
+    switch (L->state) {
+        case GREEN:
+            if (L->time_in_state >= L->t_green) {
+                L->state = YELLOW;
+                L->time_in_state = 0.0;
+            }
+            break;
+        case YELLOW:
+            if (L->time_in_state >= L->t_yellow) {
+                L->state = RED;
+                L->time_in_state = 0.0;
+            }
+            break;
+        case RED:
+        default:
+            if (L->time_in_state >= L->t_red) {
+                L->state = GREEN;
+                L->time_in_state = 0.0;
+            }
+            break;
+    }
+}
+
+// ----------------------- Vehículos (SoA) -----------------------
+// Qué hace cada carril en este paso. El semáforo es el mismo para todo el carril, así que el
+// modo se decide una vez por carril y no por vehículo.
+typedef enum {
+    LANE_GO         = 0, // VERDE/AMARILLO: se liberan los detenidos y se puede cruzar
+    LANE_RED        = 1, // ROJO: se avanza hasta la línea y ahí se detiene
+    LANE_RED_QUEUED = 2  // ROJO con todos los vivos detenidos: solo suma espera
+} LaneMode;
+
+// Tramo contiguo de un carril: unidad de trabajo del bucle paralelo.
+typedef struct {
+    int lane;
+    int begin;
+    int end;
+} LaneSlice;
+
+static inline void lane_modes(const VehicleSoA* S, const Intersection* X, LaneMode mode[NUM_LANES]) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        LightState st = X->lights[l].state;
+        if (st == GREEN || st == YELLOW)                  mode[l] = LANE_GO;
+        else if (S->lane_waiting[l] == S->lane_live[l])   mode[l] = LANE_RED_QUEUED;
+        else                                              mode[l] = LANE_RED;
+    }
+}
+
+// Parte el rango activo de cada carril en tramos de a lo sumo `block` vehículos.
+// out debe tener espacio para n / block + NUM_LANES tramos. Devuelve cuántos armó.
+static inline int build_lane_slices(const VehicleSoA* S, int block, LaneSlice* out) {
+    int k = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        for (int b = S->lane_begin[l]; b < S->lane_end[l]; b += block) {
+            int e = (b + block < S->lane_end[l]) ? b + block : S->lane_end[l];
+            out[k++] = (LaneSlice){ l, b, e };
+        }
+    }
+    return k;
+}
+
+// Espera de un vehículo contada en pasos de dt: entera, así las sumas no dependen del orden
+// (demanda de los semáforos actuados, estadísticas de --stats).
+static inline long long wait_in_steps(real_t total_wait, real_t inv_dt) {
+    return (long long)(total_wait * inv_dt + (real_t)0.5);
+}
+
+// Mueve los vehículos [begin, end) de un carril un paso dt; go indica si su semáforo permite
+// avanzar. Agrega a events los ids de los que cruzaron (events puede ser NULL) y suma en
+// *halted cuántos se detuvieron en la línea. Devuelve cuántos cruzaron.
+// Sin saltos: cada campo se actualiza con selecciones enmascaradas para que el bucle se
+// vectorice (omp simd; el ancho lo decide el compilador según -march). Los cruces son raros,
+// así que la recolección de eventos es un segundo recorrido solo si hubo alguno en el rango.
+static inline int move_vehicles_soa(VehicleSoA* S, int go, double stop_distance, double dt,
+                                    int begin, int end, EventBuffer* events, int* halted) {
+    const real_t*  restrict speed      = S->speed;
+    real_t*        restrict pos        = S->pos;
+    real_t*        restrict total_wait = S->total_wait;
+    unsigned char* restrict waiting    = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    cross_t*       restrict crossings  = S->crossings;
+    const real_t   rdt  = (real_t)dt;  // en la precisión del estado: el bucle no mezcla anchos
+    const real_t   stop = (real_t)stop_distance;
+
+    int n_crossed = 0;
+    int n_halted = 0;
+
+    #pragma omp simd reduction(+:n_crossed, n_halted)
+    for (int i = begin; i < end; ++i) {
+        int done = (finished[i] != VEH_EN_ROUTE);
+
+        // Sigue esperando solo si la luz no permite salir
+        int w = waiting[i] & !go;
+        real_t p = w ? pos[i] : pos[i] - speed[i] * rdt;
+
+        // Llegó a la línea de alto: cruza con VERDE/AMARILLO, se detiene con ROJO
+        int arrive = (p <= (real_t)0);
+        int cross  = (!done) & arrive & go;
+        int halt   = (!done) & arrive & (!go) & (!w);
+        w |= halt;
+
+        pos[i]        = done ? pos[i] : (cross ? (real_t)0 : (halt ? stop : p));
+        waiting[i]    = (unsigned char)(done ? waiting[i] : w);
+        total_wait[i] += ((!done) & w) ? rdt : (real_t)0;
+        finished[i]   = (unsigned char)(done ? VEH_DONE : (cross ? VEH_CROSSED_NOW : VEH_EN_ROUTE));
+        crossings[i]  |= (cross_t)cross;
+        n_crossed    += cross;
+        n_halted     += halt;
+    }
+
+    if (n_crossed > 0 && events) {
+        event_buffer_reserve(events, events->count + n_crossed);
+        for (int i = begin; i < end; ++i) {
+            if (finished[i] == VEH_CROSSED_NOW) events->ids[events->count++] = S->id[i];
+        }
+    }
+    *halted += n_halted;
+    return n_crossed;
+}
+
+// Carril en ROJO con todos sus vivos detenidos: nadie se mueve ni cruza, solo se acumula espera.
+// Los que ya cruzaron tienen waiting = 0; de paso se normaliza VEH_CROSSED_NOW a VEH_DONE.
+static inline void wait_vehicles_soa(VehicleSoA* S, double dt, int begin, int end) {
+    real_t*        restrict total_wait = S->total_wait;
+    const unsigned char* restrict waiting = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    const real_t   rdt = (real_t)dt;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i) {
+        total_wait[i] += waiting[i] ? rdt : (real_t)0;
+        finished[i]    = (unsigned char)(finished[i] ? VEH_DONE : VEH_EN_ROUTE);
+    }
+}
+
+// Avanza un tramo según el modo de su carril. Suma cruces y detenciones en crossed/halted.
+static inline void move_lane_slice(VehicleSoA* S, const LaneSlice* sl, LaneMode mode,
+                                   double stop_distance, double dt, EventBuffer* events,
+                                   int* crossed, int* halted) {
+    if (mode == LANE_RED_QUEUED) {
+        wait_vehicles_soa(S, dt, sl->begin, sl->end);
+        return;
+    }
+    *crossed += move_vehicles_soa(S, mode == LANE_GO, stop_distance, dt,
+                                  sl->begin, sl->end, events, halted);
+}
+
+// Cierra el paso: actualiza vivos y detenidos por carril con lo que reportó el kernel.
+// Con VERDE/AMARILLO todos los detenidos salen, así que el carril queda sin detenidos.
+static inline void end_lane_step(VehicleSoA* S, const LaneMode mode[NUM_LANES],
+                                 const int crossed[NUM_LANES], const int halted[NUM_LANES]) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_live[l] -= crossed[l];
+        S->lane_waiting[l] = (mode[l] == LANE_GO) ? 0 : S->lane_waiting[l] + halted[l];
+    }
+}
+
+// ----------------------- Avance rápido -----------------------
+// Un paso es "quieto" si ningún semáforo cambia de estado y ningún vehículo llega a la línea:
+// entonces los carriles en VERDE/AMARILLO no tienen detenidos (salieron en el paso anterior),
+// los detenidos en ROJO siguen detenidos y el resto solo avanza. Una racha de pasos quietos se
+// puede aplicar de una vez. Para dar exactamente los mismos resultados que el motor paso a paso
+// se repiten las mismas operaciones (pos -= speed*dt, total_wait += dt) por vehículo dentro de
+// registros, en lugar de una fórmula cerrada que redondearía distinto.
+
+// Tope de una racha (acota el recorrido de quiet_light_steps si dt es muy chico)
+#define FF_MAX_STEPS 1000000
+
+// Pasos quietos de los semáforos: cuántos de los próximos (a lo sumo max_steps) no cambian estado.
+static inline int quiet_light_steps(const Intersection* X, double dt, int max_steps) {
+    int quiet = max_steps;
+    for (int i = 0; i < X->num_lights; ++i) {
+        TrafficLight L = X->lights[i];
+        for (int k = 0; k < quiet; ++k) {
+            LightState before = L.state;
+            update_traffic_light(&L, dt);
+            if (L.state != before) { quiet = k; break; }
+        }
+    }
+    return quiet;
+}
+
+// Pasos hasta la próxima llegada a la línea en [begin, end), con un paso de margen por redondeo
+// (la resta repetida puede llegar un paso antes que pos / (speed*dt)). FF_MAX_STEPS si nadie avanza.
+static inline int quiet_arrival_steps(const VehicleSoA* S, double dt, int begin, int end) {
+    const real_t*        restrict pos      = S->pos;
+    const real_t*        restrict speed    = S->speed;
+    const unsigned char* restrict waiting  = S->waiting;
+    const unsigned char* restrict finished = S->finished;
+
+    double min_steps = 1e18;
+    #pragma omp simd reduction(min:min_steps)
+    for (int i = begin; i < end; ++i) {
+        double k = ceil(pos[i] / (speed[i] * dt));
+        int moving = (!waiting[i]) & (finished[i] == VEH_EN_ROUTE);
+        min_steps = fmin(min_steps, moving ? k : 1e18);
+    }
+    // Pasos 1..k-2 seguros: la llegada exacta es el paso k y el redondeo la adelanta a lo sumo uno
+    return (min_steps >= FF_MAX_STEPS) ? FF_MAX_STEPS : (int)min_steps - 2;
+}
+
+// Aplica `steps` pasos quietos a [begin, end).
+static inline void advance_quiet_soa(VehicleSoA* S, double dt, int steps, int begin, int end) {
+    const real_t*  restrict speed      = S->speed;
+    real_t*        restrict pos        = S->pos;
+    real_t*        restrict total_wait = S->total_wait;
+    const unsigned char* restrict waiting = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    const real_t   rdt = (real_t)dt;
+
+    #pragma omp simd
+    for (int i = begin; i < end; ++i) {
+        int done = (finished[i] != VEH_EN_ROUTE);
+        real_t p = pos[i], tw = total_wait[i];
+        real_t v = speed[i] * rdt;
+        for (int k = 0; k < steps; ++k) { p -= v; tw += rdt; }
+        pos[i]        = (done | waiting[i]) ? pos[i] : p;
+        total_wait[i] = ((!done) & waiting[i]) ? tw : total_wait[i];
+        finished[i]   = (unsigned char)(done ? VEH_DONE : VEH_EN_ROUTE);
+    }
+}
+
+// Semáforos tras `steps` pasos quietos (misma acumulación de time_in_state que paso a paso).
+static inline void advance_quiet_lights(Intersection* X, double dt, int steps) {
+    for (int k = 0; k < steps; ++k) {
+        for (int i = 0; i < X->num_lights; ++i) update_traffic_light(&X->lights[i], dt);
+    }
+}
+
+// Limita una racha de pasos quietos para no saltarse una impresión: el paso que imprime se
+// ejecuta normal. step = pasos ya ejecutados.
+static inline int clamp_quiet_to_print(int quiet, int step, int print_every) {
+    if (print_every <= 0) return quiet;
+    int to_print = print_every - (step % print_every); // pasos hasta el próximo que imprime
+    return (quiet < to_print - 1) ? quiet : to_print - 1;
+}
+
+// Racha de pasos quietos a partir del estado actual (versión secuencial de todo el cálculo).
+static inline int quiet_steps(const VehicleSoA* S, const Intersection* X, double dt, int step, int print_every) {
+    int quiet = quiet_light_steps(X, dt, clamp_quiet_to_print(FF_MAX_STEPS, step, print_every));
+    for (int l = 0; l < NUM_LANES && quiet > 0; ++l) {
+        int q = quiet_arrival_steps(S, dt, S->lane_begin[l], S->lane_end[l]);
+        if (q < quiet) quiet = q;
+    }
+    return quiet;
+}
+
+// ----------------------- Inicialización -----------------------
+// Semáforos de la semilla en lights (num_lanes, ya reservado; ver también traffic_arena.h).
+static inline void setup_intersection(Intersection* X, int num_lanes, unsigned int seed, TrafficLight* lights) {
+    X->num_lanes = num_lanes;
+    X->num_lights = num_lanes;
+    X->stop_distance = 2.0;
+    X->lights = lights;
+
+    for (int i = 0; i < X->num_lights; ++i) {
+        X->lights[i].id = i;
+        // Tiempos distintos por semáforo (<= 10 s) para ver cambios frecuentes
+        X->lights[i].t_green  = rng_uniform(seed, RNG_LIGHTS, i, 0, 5.0, 9.0); // 5–9 s
+        X->lights[i].t_yellow = rng_uniform(seed, RNG_LIGHTS, i, 1, 2.0, 4.0); // 2–4 s
+        X->lights[i].t_red    = rng_uniform(seed, RNG_LIGHTS, i, 2, 5.0, 9.0); // 5–9 s
+        // Estado inicial alternado para variedad
+        X->lights[i].state = (i % 2 == 0) ? GREEN : RED;
+        X->lights[i].time_in_state = 0.0;
+    }
+}
+
+static inline void init_intersection(Intersection* X, int num_lanes, unsigned int seed) {
+    setup_intersection(X, num_lanes, seed, (TrafficLight*)calloc(num_lanes, sizeof(TrafficLight)));
+}
+
+// Clave de orden para armar los carriles: por carril y, dentro de él, por distancia a la línea.
+typedef struct {
+    int    lane;
+    int    id;
+    double pos;
+    double speed;
+} VehicleSortKey;
+
+static inline int cmp_vehicle_key(const void* a, const void* b) {
+    const VehicleSortKey* x = (const VehicleSortKey*)a;
+    const VehicleSortKey* y = (const VehicleSortKey*)b;
+    if (x->lane != y->lane) return (x->lane > y->lane) - (x->lane < y->lane);
+    if (x->pos != y->pos)   return (x->pos > y->pos) - (x->pos < y->pos);
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// El carril es id % NUM_LANES: el rango de cada carril se conoce antes de sortear.
+static inline void init_lane_ranges(VehicleSoA* S, int N) {
+    S->n = N;
+    S->lane_begin[0] = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_begin[l + 1] = S->lane_begin[l] + (N - l + NUM_LANES - 1) / NUM_LANES;
+        S->lane_end[l] = S->lane_begin[l + 1];
+        S->lane_live[l] = S->lane_end[l] - S->lane_begin[l];
+        S->lane_waiting[l] = 0;
+    }
+}
+
+// Reserva los arreglos sin escribirlos (malloc, no calloc) y fija el rango de cada carril.
+// La primera escritura decide en qué nodo NUMA queda cada página: la hace fill_vehicles_soa,
+// así la versión OpenMP la reparte igual que el bucle de movimiento.
+static inline void alloc_vehicles_soa(VehicleSoA* S, int N) {
+    S->slot       = (int*)malloc((size_t)N * sizeof(int));
+    S->id         = (int*)malloc((size_t)N * sizeof(int));
+    S->lane       = (lane_t*)malloc((size_t)N * sizeof(lane_t));
+    S->pos        = (real_t*)malloc((size_t)N * sizeof(real_t));
+    S->speed      = (real_t*)malloc((size_t)N * sizeof(real_t));
+    S->waiting    = (unsigned char*)malloc((size_t)N * sizeof(unsigned char));
+    S->finished   = (unsigned char*)malloc((size_t)N * sizeof(unsigned char));
+    S->total_wait = (real_t*)malloc((size_t)N * sizeof(real_t));
+    S->crossings  = (cross_t*)malloc((size_t)N * sizeof(cross_t));
+    init_lane_ranges(S, N);
+}
+
+// Sortea los vehículos que caen en los slots [begin, end) antes de ordenar: el slot
+// lane_begin[L] + j es el vehículo id = L + j * NUM_LANES (generador por contador).
+static inline void draw_vehicle_keys(const VehicleSoA* S, VehicleSortKey* key, unsigned int seed,
+                                     int begin, int end) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        int b = (begin > S->lane_begin[l]) ? begin : S->lane_begin[l];
+        int e = (end < S->lane_begin[l + 1]) ? end : S->lane_begin[l + 1];
+        for (int s = b; s < e; ++s) {
+            int id = l + (s - S->lane_begin[l]) * NUM_LANES;
+            key[s].id = id;
+            key[s].lane = l;
+            key[s].pos = rng_uniform(seed, RNG_VEHICLES, id, 0, 20.0, 200.0);
+            key[s].speed = rng_uniform(seed, RNG_VEHICLES, id, 1, 6.0, 14.0);
+        }
+    }
+}
+
+// Ordena el carril l por distancia a la línea de alto.
+static inline void sort_lane_keys(const VehicleSoA* S, VehicleSortKey* key, int l) {
+    qsort(key + S->lane_begin[l], S->lane_begin[l + 1] - S->lane_begin[l], sizeof(VehicleSortKey),
+          cmp_vehicle_key);
+}
+
+// Primera escritura de los slots [begin, end) a partir de las claves ya ordenadas.
+static inline void fill_vehicles_soa(VehicleSoA* S, const VehicleSortKey* key, int begin, int end) {
+    for (int s = begin; s < end; ++s) {
+        int id = key[s].id;
+        S->slot[id] = s;
+        S->id[s] = id;
+        S->lane[s] = (lane_t)key[s].lane;
+        S->pos[s] = (real_t)key[s].pos;
+        S->speed[s] = (real_t)key[s].speed;
+        S->waiting[s] = 0;
+        S->finished[s] = VEH_EN_ROUTE;
+        S->total_wait[s] = 0.0;
+        S->crossings[s] = 0;
+    }
+}
+
+// Sorteo, orden y primera escritura de todos los vehículos desde un solo hilo (arreglos ya reservados).
+static inline void draw_vehicles_soa(VehicleSoA* S, unsigned int seed) {
+    VehicleSortKey* key = (VehicleSortKey*)malloc((size_t)S->n * sizeof(VehicleSortKey));
+    draw_vehicle_keys(S, key, seed, 0, S->n);
+    for (int l = 0; l < NUM_LANES; ++l) sort_lane_keys(S, key, l);
+    fill_vehicles_soa(S, key, 0, S->n);
+    free(key);
+}
+
+// Inicialización completa desde un solo hilo (versión secuencial).
+static inline void init_vehicles_soa(VehicleSoA* S, int N, unsigned int seed) {
+    alloc_vehicles_soa(S, N);
+    draw_vehicles_soa(S, seed);
+}
+
+static inline void free_vehicles_soa(VehicleSoA* S) {
+    free(S->slot);
+    free(S->id);
+    free(S->lane);
+    free(S->pos);
+    free(S->speed);
+    free(S->waiting);
+    free(S->finished);
+    free(S->total_wait);
+    free(S->crossings);
+    S->n = 0;
+}
+
+// ----------------------- Compactación -----------------------
+static inline void swap_vehicles_soa(VehicleSoA* S, int a, int b) {
+    int ti; lane_t tl; real_t tr; unsigned char tc; cross_t tx;
+    ti = S->id[a];         S->id[a] = S->id[b];                 S->id[b] = ti;
+    tl = S->lane[a];       S->lane[a] = S->lane[b];             S->lane[b] = tl;
+    tr = S->pos[a];        S->pos[a] = S->pos[b];               S->pos[b] = tr;
+    tr = S->speed[a];      S->speed[a] = S->speed[b];           S->speed[b] = tr;
+    tc = S->waiting[a];    S->waiting[a] = S->waiting[b];       S->waiting[b] = tc;
+    tc = S->finished[a];   S->finished[a] = S->finished[b];     S->finished[b] = tc;
+    tr = S->total_wait[a]; S->total_wait[a] = S->total_wait[b]; S->total_wait[b] = tr;
+    tx = S->crossings[a];  S->crossings[a] = S->crossings[b];   S->crossings[b] = tx;
+    if (S->slot) { // el flujo continuo no lleva slot[id]
+        S->slot[S->id[a]] = a;
+        S->slot[S->id[b]] = b;
+    }
+}
+
+// Mueve los vehículos que ya cruzaron al final del rango activo del carril l, conservando el
+// orden relativo (por distancia) de los que siguen en ruta. Los que salen del rango ya no pasan
+// por el kernel, así que quedan en VEH_DONE (el estado final que ve quien los lea).
+static inline void compact_lane_soa(VehicleSoA* S, int l) {
+    int w = S->lane_begin[l];
+    for (int r = S->lane_begin[l]; r < S->lane_end[l]; ++r) {
+        if (S->finished[r]) continue;
+        if (w != r) swap_vehicles_soa(S, w, r);
+        ++w;
+    }
+    for (int r = w; r < S->lane_end[l]; ++r) S->finished[r] = VEH_DONE;
+    S->lane_end[l] = w;
+}
+
+// Compacta un carril cuando al menos 1/8 de su rango activo ya cruzó: cada compactación recorre
+// el rango y libera 1/8 de él, así el costo amortizado es O(1) por vehículo que cruza.
+// Devuelve true si compactó algún carril (hay que rearmar los tramos).
+static inline bool lane_needs_compaction(const VehicleSoA* S, int l) {
+    int range = S->lane_end[l] - S->lane_begin[l];
+    int dead = range - S->lane_live[l];
+    return dead > 0 && dead * 8 >= range;
+}
+
+static inline bool any_lane_needs_compaction(const VehicleSoA* S) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        if (lane_needs_compaction(S, l)) return true;
+    }
+    return false;
+}
+
+static inline bool maybe_compact_lanes_soa(VehicleSoA* S) {
+    bool any = false;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        if (!lane_needs_compaction(S, l)) continue;
+        compact_lane_soa(S, l);
+        any = true;
+    }
+    return any;
+}
+
+#endif // TRAFFIC_CORE_H
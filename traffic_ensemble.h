@@ -0,0 +1,315 @@
+// traffic_ensemble.h
+// Ensamble de Monte Carlo (--ensemble K, traffic_seq y traffic_omp): K réplicas de la misma
+// configuración con semillas S, S+1, ..., S+K-1, avanzadas juntas. Los arreglos van por réplica
+// dentro de cada vehículo (el vehículo del slot s en la réplica r está en s*K + r), así el bucle
+// interno del kernel recorre las K réplicas de un vehículo con SIMD y un paso de todas es un
+// solo recorrido de memoria, en lugar de K corridas por separado. Al final se reportan media,
+// desviación estándar, intervalo de confianza y cuantiles de las métricas del resumen.
+//
+// Cada réplica da exactamente lo mismo que `traffic_seq v 0 S+r`: el carril de un vehículo es
+// id % NUM_LANES en todas las semillas, el modo del carril se resuelve por réplica con una máscara
+// y la espera promedio se suma en orden de id. No hay compactación (cada réplica termina a otro
+// ritmo): las que ya terminaron siguen en el recorrido sin cambiar, y el paso cuesta N*K hasta que
+// termina la más lenta.
+// Compartido por los dos motores: con -fopenmp los bucles por tramo se reparten entre hilos;
+// traffic_seq (-fopenmp-simd) los corre en un solo hilo.
+
+#ifndef TRAFFIC_ENSEMBLE_H
+#define TRAFFIC_ENSEMBLE_H
+
+#include "traffic_core.h"
+#include "traffic_arena.h"
+#include "traffic_profile.h" // profile_now()
+
+// Vehículos por tramo del bucle paralelo (cada tramo mueve ENSEMBLE_BLOCK * K elementos).
+#define ENSEMBLE_BLOCK 256
+
+typedef struct {
+    int            n;            // vehículos por réplica
+    int            k;            // réplicas
+    unsigned int   seed;         // semilla de la réplica 0
+    double         stop_distance;
+    int            lane_begin[NUM_LANES + 1]; // mismo reparto por carril que alloc_vehicles_soa
+    double*        pos;          // n*k: (slot s, réplica r) en s*k + r
+    double*        speed;
+    double*        total_wait;
+    unsigned char* waiting;
+    unsigned char* finished;     // 0 en ruta, 1 cruzó
+    TrafficLight*  lights;       // k*NUM_LANES: (réplica r, carril l) en r*NUM_LANES + l
+    unsigned char* go;           // NUM_LANES*k: este paso, (carril l, réplica r) en l*k + r
+    LaneSlice*     slices;
+    int            num_slices;
+    Arena          arena;        // todos los arreglos de arriba
+} Ensemble;
+
+// Métricas de una réplica.
+typedef struct {
+    int    steps;
+    double avg_wait;
+    double sim_time;
+} ReplicaResult;
+
+// Resumen de una métrica sobre las réplicas.
+typedef struct {
+    double mean, stddev, ci95;  // ci95: semiancho del intervalo del 95 % de la media (normal)
+    double min, p05, p50, p95, max;
+} EnsembleStats;
+
+static inline void ensemble_check_config(const SimConfig* cfg) {
+    if (cfg->num_vehicles < 1) {
+        fprintf(stderr, "El ensamble necesita al menos un vehículo\n");
+        exit(1);
+    }
+}
+
+// ----------------------- Inicialización -----------------------
+// Sortea la réplica r del slot s con la misma clave que draw_vehicle_keys en la semilla S+r.
+// La primera escritura se hace por tramos con el mismo reparto que el kernel (NUMA).
+static inline void init_ensemble(Ensemble* E, int N, int K, unsigned int seed, bool huge_pages) {
+    E->n = N;
+    E->k = K;
+    E->seed = seed;
+    const size_t total = (size_t)N * (size_t)K;
+    const size_t max_slices = (size_t)(N / ENSEMBLE_BLOCK + NUM_LANES);
+    Arena* A = &E->arena;
+    arena_init(A, 3 * arena_bytes(total, sizeof(double)) + 2 * arena_bytes(total, 1) +
+                  arena_bytes((size_t)NUM_LANES * K, 1) + arena_bytes((size_t)K * NUM_LANES, sizeof(TrafficLight)) +
+                  arena_bytes(max_slices, sizeof(LaneSlice)), huge_pages);
+    E->pos        = (double*)arena_alloc(A, total * sizeof(double));
+    E->speed      = (double*)arena_alloc(A, total * sizeof(double));
+    E->total_wait = (double*)arena_alloc(A, total * sizeof(double));
+    E->waiting    = (unsigned char*)arena_alloc(A, total * sizeof(unsigned char));
+    E->finished   = (unsigned char*)arena_alloc(A, total * sizeof(unsigned char));
+    E->go         = (unsigned char*)arena_alloc(A, (size_t)NUM_LANES * K * sizeof(unsigned char));
+    E->lights     = (TrafficLight*)arena_alloc(A, (size_t)K * NUM_LANES * sizeof(TrafficLight));
+
+    E->lane_begin[0] = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        E->lane_begin[l + 1] = E->lane_begin[l] + (N - l + NUM_LANES - 1) / NUM_LANES;
+    }
+    E->slices = (LaneSlice*)arena_alloc(A, max_slices * sizeof(LaneSlice));
+    E->num_slices = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        for (int b = E->lane_begin[l]; b < E->lane_begin[l + 1]; b += ENSEMBLE_BLOCK) {
+            int e = (b + ENSEMBLE_BLOCK < E->lane_begin[l + 1]) ? b + ENSEMBLE_BLOCK : E->lane_begin[l + 1];
+            E->slices[E->num_slices++] = (LaneSlice){ l, b, e };
+        }
+    }
+
+    for (int r = 0; r < K; ++r) {
+        Intersection X;
+        setup_intersection(&X, NUM_LANES, seed + (unsigned int)r, &E->lights[(size_t)r * NUM_LANES]);
+        E->stop_distance = X.stop_distance;
+    }
+
+    #pragma omp parallel for schedule(static)
+    for (int k = 0; k < E->num_slices; ++k) {
+        const LaneSlice sl = E->slices[k];
+        for (int s = sl.begin; s < sl.end; ++s) {
+            const int id = sl.lane + (s - E->lane_begin[sl.lane]) * NUM_LANES;
+            for (int r = 0; r < K; ++r) {
+                const size_t i = (size_t)s * K + r;
+                E->pos[i]        = rng_uniform(seed + (unsigned int)r, RNG_VEHICLES, id, 0, 20.0, 200.0);
+                E->speed[i]      = rng_uniform(seed + (unsigned int)r, RNG_VEHICLES, id, 1, 6.0, 14.0);
+                E->total_wait[i] = 0.0;
+                E->waiting[i]    = 0;
+                E->finished[i]   = 0;
+            }
+        }
+    }
+}
+
+static inline void free_ensemble(Ensemble* E) {
+    arena_free(&E->arena);
+    E->n = E->k = 0;
+}
+
+// ----------------------- Kernel -----------------------
+// Mueve los slots [begin, end) de un carril en todas las réplicas; go[r] es la luz del carril en
+// la réplica r. Mismas operaciones que move_vehicles_soa (un carril en ROJO con todos detenidos
+// da lo mismo que wait_vehicles_soa). Suma en crossed[r] los cruces de cada réplica.
+static inline void move_ensemble_range(Ensemble* E, const unsigned char* restrict go, double dt,
+                                       int begin, int end, int* restrict crossed) {
+    const int K = E->k;
+    const double stop_distance = E->stop_distance;
+    for (int s = begin; s < end; ++s) {
+        const double*  restrict speed      = E->speed + (size_t)s * K;
+        double*        restrict pos        = E->pos + (size_t)s * K;
+        double*        restrict total_wait = E->total_wait + (size_t)s * K;
+        unsigned char* restrict waiting    = E->waiting + (size_t)s * K;
+        unsigned char* restrict finished   = E->finished + (size_t)s * K;
+
+        #pragma omp simd
+        for (int r = 0; r < K; ++r) {
+            int done = finished[r];
+            int g = go[r];                    // 0/1: g ^ 1 en lugar de !g, si no GCC no vectoriza el bucle
+            int w = waiting[r] & (g ^ 1);
+            double p = w ? pos[r] : pos[r] - speed[r] * dt;
+
+            int arrive = (p <= 0.0);
+            int cross  = (!done) & arrive & g;
+            int halt   = (!done) & arrive & (g ^ 1) & (!w);
+            w |= halt;
+
+            pos[r]        = done ? pos[r] : (cross ? 0.0 : (halt ? stop_distance : p));
+            waiting[r]    = (unsigned char)(done ? waiting[r] : w);
+            total_wait[r] += ((!done) & w) ? dt : 0.0;
+            finished[r]   = (unsigned char)(done | cross);
+            crossed[r]   += cross;
+        }
+    }
+}
+
+// Un paso de todas las réplicas: semáforos, máscara de luces y movimiento. crossed (K) recibe
+// los cruces de cada réplica en este paso.
+static inline void ensemble_step(Ensemble* E, double dt, int* crossed) {
+    const int K = E->k;
+    for (int r = 0; r < K; ++r) {
+        for (int l = 0; l < NUM_LANES; ++l) {
+            TrafficLight* L = &E->lights[(size_t)r * NUM_LANES + l];
+            update_traffic_light(L, dt);
+            E->go[(size_t)l * K + r] = (unsigned char)(L->state == GREEN || L->state == YELLOW);
+        }
+        crossed[r] = 0;
+    }
+
+    #pragma omp parallel for schedule(static) reduction(+:crossed[:K])
+    for (int k = 0; k < E->num_slices; ++k) {
+        const LaneSlice* sl = &E->slices[k];
+        move_ensemble_range(E, &E->go[(size_t)sl->lane * K], dt, sl->begin, sl->end, crossed);
+    }
+}
+
+// Espera promedio de la réplica r, sumada en orden de id como en el resumen de traffic_seq.
+static inline double ensemble_avg_wait(const Ensemble* E, int r) {
+    double sum = 0.0;
+    for (int id = 0; id < E->n; ++id) {
+        const int l = id % NUM_LANES;
+        const int s = E->lane_begin[l] + id / NUM_LANES;
+        sum += E->total_wait[(size_t)s * E->k + r];
+    }
+    return sum / (double)E->n;
+}
+
+// ----------------------- Estadística -----------------------
+static inline int cmp_double(const void* a, const void* b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+// Cuantil q de sorted[0..n) con interpolación lineal entre rangos.
+static inline double quantile_sorted(const double* sorted, int n, double q) {
+    double h = q * (n - 1);
+    int lo = (int)floor(h);
+    int hi = (lo + 1 < n) ? lo + 1 : lo;
+    return sorted[lo] + (h - lo) * (sorted[hi] - sorted[lo]);
+}
+
+static inline EnsembleStats ensemble_stats(const double* values, int n) {
+    EnsembleStats st = {0};
+    double* sorted = (double*)malloc((size_t)n * sizeof(double));
+    double sum = 0.0;
+    for (int i = 0; i < n; ++i) { sorted[i] = values[i]; sum += values[i]; }
+    st.mean = sum / n;
+    double sq = 0.0;
+    for (int i = 0; i < n; ++i) sq += (values[i] - st.mean) * (values[i] - st.mean);
+    st.stddev = (n > 1) ? sqrt(sq / (n - 1)) : 0.0; // muestral
+    st.ci95 = 1.96 * st.stddev / sqrt((double)n);
+    qsort(sorted, n, sizeof(double), cmp_double);
+    st.min = sorted[0];
+    st.p05 = quantile_sorted(sorted, n, 0.05);
+    st.p50 = quantile_sorted(sorted, n, 0.50);
+    st.p95 = quantile_sorted(sorted, n, 0.95);
+    st.max = sorted[n - 1];
+    free(sorted);
+    return st;
+}
+
+static inline void print_stats_row(const char* name, const EnsembleStats* st) {
+    print_padded(name, 22);
+    printf(" %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f %10.3f\n",
+           st->mean, st->stddev, st->ci95, st->min, st->p05, st->p50, st->p95, st->max);
+}
+
+// ----------------------- Corrida -----------------------
+// v vehículos, K réplicas; imprime cada t pasos cuántas réplicas terminaron. Con --ensemble-out
+// escribe además una fila CSV por réplica.
+static inline void run_ensemble(const SimConfig* cfg) {
+    const int N = cfg->num_vehicles;
+    const int K = cfg->ensemble;
+    const double dt = cfg->dt;
+
+    Ensemble E;
+    init_ensemble(&E, N, K, cfg->seed, cfg->huge_pages);
+    printf("Ensamble: %d réplicas (semillas %u..%u), %d vehículos por réplica, dt=%.1f s\n",
+           K, cfg->seed, cfg->seed + (unsigned int)(K - 1), N, dt);
+
+    int* crossed = (int*)malloc((size_t)K * sizeof(int));
+    int* total_crossed = (int*)calloc((size_t)K, sizeof(int));
+    ReplicaResult* res = (ReplicaResult*)calloc((size_t)K, sizeof(ReplicaResult));
+    int running = K, step = 0;
+
+    double wall_t0 = profile_now();
+    while (running > 0) {
+        ensemble_step(&E, dt, crossed);
+        step += 1;
+        for (int r = 0; r < K; ++r) {
+            if (total_crossed[r] >= N) continue;
+            total_crossed[r] += crossed[r];
+            if (total_crossed[r] >= N) {
+                res[r].steps = step;
+                res[r].sim_time = step * dt;
+                --running;
+            }
+        }
+        if (cfg->print_every > 0 && step % cfg->print_every == 0) {
+            printf("Paso %d (t=%.0f s): réplicas terminadas %d/%d\n", step, step * dt, K - running, K);
+        }
+    }
+    double wall_t1 = profile_now();
+
+    double* avg_wait = (double*)malloc((size_t)K * sizeof(double));
+    double* sim_time = (double*)malloc((size_t)K * sizeof(double));
+    for (int r = 0; r < K; ++r) {
+        res[r].avg_wait = ensemble_avg_wait(&E, r);
+        avg_wait[r] = res[r].avg_wait;
+        sim_time[r] = res[r].sim_time;
+    }
+    EnsembleStats st_wait = ensemble_stats(avg_wait, K);
+    EnsembleStats st_time = ensemble_stats(sim_time, K);
+
+    printf("\n--- Resumen del ensamble (%d réplicas) ---\n", K);
+    print_padded("métrica", 22);
+    printf(" %10s %10s %10s %10s %10s %10s %10s %10s\n",
+           "media", "desv.est.", "IC95 ±", "mín", "p5", "p50", "p95", "máx");
+    print_stats_row("Espera promedio (s)", &st_wait);
+    print_stats_row("Tiempo simulado (s)", &st_time);
+    printf("Pasos ejecutados: %d (hasta la réplica más lenta)\n", step);
+    printf("Tiempo de EJECUCIÓN (wall clock): %.3f s (%.2e vehículos-réplica por segundo)\n",
+           wall_t1 - wall_t0,
+           (wall_t1 > wall_t0) ? (double)N * K * step / (wall_t1 - wall_t0) : 0.0);
+    if (cfg->huge_pages) print_arena_usage(stdout, &E.arena);
+
+    if (cfg->ensemble_out) {
+        FILE* out = fopen(cfg->ensemble_out, "w");
+        if (!out) {
+            fprintf(stderr, "No se pudo crear %s\n", cfg->ensemble_out);
+            exit(1);
+        }
+        fprintf(out, "replica,seed,vehicles,steps,avg_wait_s,sim_time_s\n");
+        for (int r = 0; r < K; ++r) {
+            fprintf(out, "%d,%u,%d,%d,%.6f,%.1f\n", r, cfg->seed + (unsigned int)r, N,
+                    res[r].steps, res[r].avg_wait, res[r].sim_time);
+        }
+        fclose(out);
+    }
+
+    free(avg_wait);
+    free(sim_time);
+    free(res);
+    free(total_crossed);
+    free(crossed);
+    free_ensemble(&E);
+}
+
+#endif // TRAFFIC_ENSEMBLE_H
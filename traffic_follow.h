@@ -0,0 +1,116 @@
+// traffic_follow.h
+// Seguimiento de vehículos (--car-following, traffic_seq y traffic_omp): cada vehículo se queda
+// al menos --min-gap metros detrás del que tiene adelante en su carril, así las colas se forman
+// hacia atrás desde la línea de alto (el primero espera en stop_distance, los demás detrás de él)
+// y nadie atraviesa a nadie. Al ponerse la luz en verde la cola arranca de a uno por paso.
+//
+// Modelo de distancia mínima: la nueva posición es la de flujo libre (pos - speed*dt) limitada
+// por la posición del líder AL INICIO del paso más la distancia mínima, y nunca hacia atrás.
+// Como el líder solo avanza, nadie se acerca a menos de min_gap del líder ni lo pasa: el orden por
+// distancia del carril (el de init_vehicles_soa) se mantiene solo y no hay que reordenar. El líder
+// del slot i es el slot i-1 (O(1)), y los que ya cruzaron quedan siempre al principio del rango.
+// Un vehículo que no pudo avanzar por su líder cuenta como detenido (suma espera).
+//
+// Cada tramo se recorre de atrás hacia adelante: el slot i lee el i-1 antes de que se escriba.
+// El líder del primer vehículo de un tramo está en el tramo anterior del mismo carril, que puede
+// estar moviendo otro hilo: cada tramo deja la posición de su último vehículo en tail[] y el
+// siguiente la lee en el paso que sigue (dos búferes por paridad, como los parciales por hilo).
+
+#ifndef TRAFFIC_FOLLOW_H
+#define TRAFFIC_FOLLOW_H
+
+#include "traffic_core.h"
+
+#define FOLLOW_NO_LEADER (-HUGE_VAL) // posición del líder cuando no hay (o ya cruzó)
+
+// Posición del vehículo vivo del slot i (FOLLOW_NO_LEADER si ya cruzó).
+static inline double follow_position(const VehicleSoA* S, int i) {
+    return S->finished[i] ? FOLLOW_NO_LEADER : S->pos[i];
+}
+
+// Líder del primer vehículo del tramo k: el último del tramo anterior si es del mismo carril.
+static inline double follow_slice_lead(const LaneSlice* slices, int k, const double* tail) {
+    return (k > 0 && slices[k - 1].lane == slices[k].lane) ? tail[k - 1] : FOLLOW_NO_LEADER;
+}
+
+// tail[k] de todos los tramos a partir del estado actual (al empezar y después de compactar).
+static inline void follow_init_tails(const VehicleSoA* S, const LaneSlice* slices, int num_slices, double* tail) {
+    for (int k = 0; k < num_slices; ++k) tail[k] = follow_position(S, slices[k].end - 1);
+}
+
+// Mueve el slot i un paso; ahead es la posición de su líder al inicio del paso.
+// Suma a *crossed y *waiting si cruzó o quedó detenido.
+static inline void follow_vehicle(VehicleSoA* S, int i, double ahead, int go, double stop_distance,
+                                  double min_gap, double dt, int* crossed, int* waiting) {
+    real_t*        restrict pos        = S->pos;
+    real_t*        restrict total_wait = S->total_wait;
+    unsigned char* restrict wait       = S->waiting;
+    unsigned char* restrict finished   = S->finished;
+    const real_t   rdt  = (real_t)dt;
+    const real_t   stop = (real_t)stop_distance;
+
+    int done = (finished[i] != VEH_EN_ROUTE);
+    // Detenido en la línea con ROJO (el único que puede estar a stop_distance o menos)
+    int hold = wait[i] & !go & (pos[i] <= stop);
+    real_t p_free = pos[i] - S->speed[i] * rdt;
+    real_t limit = (real_t)(ahead + min_gap);
+    real_t p = (p_free > limit) ? p_free : limit;
+    p = hold ? pos[i] : (p < pos[i] ? p : pos[i]);
+
+    // Solo el primero de la cola llega a la línea: los demás quedan a min_gap de un vivo
+    int arrive  = (p <= (real_t)0);
+    int cross   = (!done) & arrive & go;
+    int halt    = (!done) & arrive & (!go) & (!hold);
+    int blocked = (!done) & (!hold) & (!arrive) & (p >= pos[i]);
+    int w = hold | halt | blocked;
+
+    pos[i]        = done ? pos[i] : (cross ? (real_t)0 : (halt ? stop : p));
+    wait[i]       = (unsigned char)(done ? wait[i] : w);
+    total_wait[i] += ((!done) & w) ? rdt : (real_t)0;
+    finished[i]   = (unsigned char)(done ? VEH_DONE : (cross ? VEH_CROSSED_NOW : VEH_EN_ROUTE));
+    S->crossings[i] |= (cross_t)cross;
+    *crossed += cross;
+    *waiting += (!done) & w;
+}
+
+// Avanza un tramo con seguimiento. lead: líder del primer vehículo (follow_slice_lead); deja en
+// *tail la posición del último para el tramo siguiente. Suma cruces en *crossed y, en *waiting,
+// los vivos que quedaron detenidos (para end_follow_step). events puede ser NULL.
+static inline void move_lane_slice_following(VehicleSoA* S, const LaneSlice* sl, LaneMode mode,
+                                             double stop_distance, double min_gap, double dt, double lead,
+                                             EventBuffer* events, int* crossed, int* waiting, double* tail) {
+    if (sl->end <= sl->begin) return; // carril vacío (traffic_seq: un tramo por carril)
+    if (mode == LANE_RED_QUEUED) {     // todos detenidos: ni el primero ni los de atrás se mueven
+        wait_vehicles_soa(S, dt, sl->begin, sl->end);
+        *tail = follow_position(S, sl->end - 1);
+        return;
+    }
+    const int go = (mode == LANE_GO);
+    int n_crossed = 0, n_waiting = 0;
+    for (int i = sl->end - 1; i > sl->begin; --i) {
+        follow_vehicle(S, i, follow_position(S, i - 1), go, stop_distance, min_gap, dt, &n_crossed, &n_waiting);
+    }
+    follow_vehicle(S, sl->begin, lead, go, stop_distance, min_gap, dt, &n_crossed, &n_waiting);
+    *tail = follow_position(S, sl->end - 1);
+    if (n_crossed > 0 && events) {
+        event_buffer_reserve(events, events->count + n_crossed);
+        for (int i = sl->begin; i < sl->end; ++i) {
+            if (S->finished[i] == VEH_CROSSED_NOW) events->ids[events->count++] = S->id[i];
+        }
+    }
+    *crossed += n_crossed;
+    *waiting += n_waiting;
+}
+
+// Cierre del paso con seguimiento: con VERDE también hay detenidos (los que esperan a su líder),
+// así que los detenidos por carril son los que contó el kernel. En ROJO con cola completa no
+// cambia nada.
+static inline void end_follow_step(VehicleSoA* S, const LaneMode mode[NUM_LANES],
+                                   const int crossed[NUM_LANES], const int waiting[NUM_LANES]) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_live[l] -= crossed[l];
+        if (mode[l] != LANE_RED_QUEUED) S->lane_waiting[l] = waiting[l];
+    }
+}
+
+#endif // TRAFFIC_FOLLOW_H
@@ -0,0 +1,201 @@
+// traffic_grid.c
+// Simulación de tráfico en una malla de intersecciones (Versión Paralela con OpenMP).
+// Descomposición de dominio: cada hilo es dueño de un tile de filas contiguas de la malla y de
+// los vehículos que están en sus intersecciones; los que cruzan a una fila de otro tile pasan
+// por colas de traspaso con el tile vecino. Una sola barrera por paso.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include <omp.h>
+
+#include "traffic_grid.h"
+
+// Entero por hilo en su propia línea de caché (contadores escritos por un hilo, leídos por todos)
+typedef struct {
+    _Alignas(64) int value;
+} PaddedInt;
+
+// ----------------------- Impresión amigable -----------------------
+void print_grid_configuration(const Grid* M, const VehicleRecord* fleet, int N, bool vehicles) {
+    printf("\nResumen de configuración (malla %dx%d):\n", M->rows, M->cols);
+    if (vehicles) {
+        for (int i = 0; i < N; ++i) {
+            printf("Vehículo %d - Intersección (%d,%d), Carril: %d, Velocidad: %.2f m/s, Posición inicial: %.2f m\n",
+                   fleet[i].id, fleet[i].node / M->cols, fleet[i].node % M->cols, fleet[i].lane,
+                   fleet[i].speed, fleet[i].pos);
+        }
+    }
+    for (int n = 0; n < M->rows * M->cols; ++n) {
+        printf("Intersección (%d,%d) -", n / M->cols, n % M->cols);
+        for (int l = 0; l < NUM_LANES; ++l) {
+            const TrafficLight* L = &M->lights[n * NUM_LANES + l];
+            printf(" S%d: %s R%.1f/V%.1f/A%.1f", l, state_to_str(L->state), L->t_red, L->t_green, L->t_yellow);
+        }
+        printf("\n");
+    }
+    printf("\n");
+}
+
+void print_grid_state(int step, double sim_time, const Grid* M, const GridTile* tiles, int num_tiles,
+                      int exited) {
+    int nodes = M->rows * M->cols;
+    int* count = (int*)calloc(nodes, sizeof(int));
+    int* queued = (int*)calloc(nodes, sizeof(int));
+    int in_grid = 0;
+    for (int t = 0; t < num_tiles; ++t) {
+        const GridVehicles* G = &tiles[t].V;
+        for (int s = 0; s < G->n; ++s) {
+            count[G->node[s]] += 1;
+            queued[G->node[s]] += G->waiting[s];
+        }
+        in_grid += G->n;
+    }
+
+    printf("Iteración %d (t=%.1fs): en la malla: %d, ya salieron: %d\n", step, sim_time, in_grid, exited);
+    for (int n = 0; n < nodes; ++n) {
+        printf("Intersección (%d,%d) - Vehículos: %d (ESPERANDO: %d), Semáforos:",
+               n / M->cols, n % M->cols, count[n], queued[n]);
+        for (int l = 0; l < NUM_LANES; ++l) printf(" %s", state_to_str(M->lights[n * NUM_LANES + l].state));
+        printf("\n");
+    }
+    printf("\n");
+    free(count);
+    free(queued);
+}
+
+// ----------------------- Simulación -----------------------
+void run_grid_simulation(const SimConfig* cfg) {
+    const int    num_vehicles = cfg->num_vehicles;
+    const int    print_every  = cfg->print_every;
+    const double dt           = cfg->dt;
+
+    double wall_t0 = omp_get_wtime();
+
+    Grid M;
+    init_grid(&M, cfg->grid_rows, cfg->grid_cols, cfg->seed);
+    VehicleRecord* fleet = (VehicleRecord*)malloc((size_t)num_vehicles * sizeof(VehicleRecord));
+    init_grid_vehicles(&M, num_vehicles, cfg->seed, fleet);
+
+    print_grid_configuration(&M, fleet, num_vehicles, print_every > 0);
+
+    // Un tile por hilo, sin tiles vacíos (cada tile tiene al menos una fila)
+    omp_set_dynamic(0);
+    const int num_tiles = (omp_get_max_threads() < M.rows) ? omp_get_max_threads() : M.rows;
+    GridTile* tiles = (GridTile*)calloc(num_tiles, sizeof(GridTile));
+    int* row_tile = (int*)malloc((size_t)M.rows * sizeof(int));
+    for (int t = 0; t < num_tiles; ++t) {
+        grid_tile_rows(M.rows, t, num_tiles, &tiles[t].r0, &tiles[t].r1);
+        for (int r = tiles[t].r0; r < tiles[t].r1; ++r) row_tile[r] = t;
+    }
+    for (int i = 0; i < num_vehicles; ++i) {
+        grid_vehicles_push(&tiles[row_tile[fleet[i].node / M.cols]].V, &fleet[i]);
+    }
+    free(fleet);
+
+    // Colas de traspaso y contadores de salidas, por paridad de paso: lo que un tile escribe en
+    // el paso k lo lee el vecino tras la barrera de k, y no se vuelve a escribir hasta k+2
+    // (después de la barrera de k+1), así alcanza con una barrera por paso.
+    HandoffQueue* queues = (HandoffQueue*)calloc((size_t)2 * num_tiles * 2, sizeof(HandoffQueue));
+    #define GRID_QUEUE(p, t, d) (&queues[((p) * num_tiles + (t)) * 2 + (d)])
+    PaddedInt* exited_slot = (PaddedInt*)aligned_alloc(64, (size_t)2 * num_tiles * sizeof(PaddedInt));
+    for (int k = 0; k < 2 * num_tiles; ++k) exited_slot[k].value = 0;
+
+    GridResults R = {0};
+    R.total_wait = (double*)calloc(num_vehicles, sizeof(double));
+    R.crossings = (int*)calloc(num_vehicles, sizeof(int));
+
+    int step = 0;
+    double sim_time = 0.0;
+
+    #pragma omp parallel num_threads(num_tiles) default(shared)
+    {
+        const int t = omp_get_thread_num();
+        GridTile* T = &tiles[t];
+        int my_step = 0;         // cada hilo lleva su copia: todos avanzan igual
+        double my_time = 0.0;
+        int my_exited = 0;       // acumulado de salidas desde este tile
+
+        for (;;) {
+            const int p = my_step & 1;
+
+            // --- Tile: semáforos propios, mover, y enrutar los que cruzaron ---
+            update_grid_lights(&M, T->r0, T->r1, dt);
+            move_grid_vehicles(&T->V, M.go_mask, M.stop_distance, dt, &T->crossed);
+            my_exited += route_grid_crossings(T, &M, GRID_QUEUE(p, t, HANDOFF_UP),
+                                              GRID_QUEUE(p, t, HANDOFF_DOWN), &R);
+            exited_slot[p * num_tiles + t].value = my_exited;
+
+            #pragma omp barrier
+
+            // --- Recibir de los vecinos y sumar salidas (lectura de lo escrito en paridad p) ---
+            if (t > 0)             drain_handoff(T, GRID_QUEUE(p, t - 1, HANDOFF_DOWN));
+            if (t < num_tiles - 1) drain_handoff(T, GRID_QUEUE(p, t + 1, HANDOFF_UP));
+            int total_exited = 0;
+            for (int k = 0; k < num_tiles; ++k) total_exited += exited_slot[p * num_tiles + k].value;
+
+            my_step += 1;
+            my_time += dt;
+
+            if (print_every > 0 && (my_step % print_every) == 0) {
+                #pragma omp barrier
+                #pragma omp master
+                print_grid_state(my_step, my_time, &M, tiles, num_tiles, total_exited);
+                #pragma omp barrier
+            }
+
+            if (total_exited >= num_vehicles) break;
+        }
+
+        #pragma omp master
+        {
+            step = my_step;
+            sim_time = my_time;
+        }
+    }
+    #undef GRID_QUEUE
+
+    double wall_t1 = omp_get_wtime();
+
+    // Métricas finales (orden por id: no depende del número de hilos)
+    double avg_wait = 0.0;
+    long long total_crossings = 0;
+    for (int id = 0; id < num_vehicles; ++id) {
+        avg_wait += R.total_wait[id];
+        total_crossings += R.crossings[id];
+    }
+    avg_wait /= (double)num_vehicles;
+
+    printf("\n--- Resumen (Malla OpenMP) ---\n");
+    printf("Malla: %dx%d intersecciones, tiles (hilos): %d\n", M.rows, M.cols, num_tiles);
+    printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
+    printf("Vehículos que salieron de la malla: %d/%d\n", num_vehicles, num_vehicles);
+    printf("Intersecciones cruzadas (suma de crossings): %lld\n", total_crossings);
+    printf("Espera promedio por vehículo: %.3f s\n", avg_wait);
+    printf("Tiempo total SIMULADO: %.1f s\n", sim_time);
+    printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+
+    for (int k = 0; k < 2 * num_tiles * 2; ++k) handoff_free(&queues[k]);
+    for (int t = 0; t < num_tiles; ++t) {
+        grid_vehicles_free(&tiles[t].V);
+        event_buffer_free(&tiles[t].crossed);
+    }
+    free(queues);
+    free(exited_slot);
+    free(row_tile);
+    free(tiles);
+    free(R.total_wait);
+    free(R.crossings);
+    free_grid(&M);
+}
+
+int main(int argc, char** argv) {
+    SimConfig cfg; // v: vehículos, t: imprimir cada k pasos, semilla, --grid FxC
+    parse_sim_args(argc, argv, &cfg);
+
+    printf("OpenMP: max threads disponibles: %d\n", omp_get_max_threads());
+    run_grid_simulation(&cfg);
+    return 0;
+}
@@ -0,0 +1,329 @@
+// traffic_grid.h
+// Modelo de ciudad: malla de R x C intersecciones, cada una con NUM_LANES semáforos propios.
+// Los vehículos siguen derecho: al cruzar pasan al mismo carril de la intersección siguiente
+// y solo terminan cuando salen de la malla. La malla se reparte en tiles de filas contiguas;
+// los vehículos que cruzan a otro tile viajan por colas de traspaso (HandoffQueue).
+// Compartido por traffic_grid.c (un tile por hilo OpenMP) y traffic_mpi.c (un bloque por proceso).
+
+#ifndef TRAFFIC_GRID_H
+#define TRAFFIC_GRID_H
+
+#include "traffic_core.h"
+
+#define GRID_BLOCK_LENGTH 100.0 // m entre intersecciones consecutivas
+
+// Carril = por dónde llega el vehículo: desde el N viaja al sur, desde el E al oeste,
+// desde el S al norte y desde el O al este.
+static inline int grid_lane_dr(int lane) { return (lane == 0) ? 1 : (lane == 2 ? -1 : 0); }
+static inline int grid_lane_dc(int lane) { return (lane == 1) ? -1 : (lane == 3 ? 1 : 0); }
+
+// ----------------------- Estructuras -----------------------
+typedef struct {
+    int            rows;
+    int            cols;
+    double         stop_distance;
+    double         block_length;
+    TrafficLight*  lights;   // rows*cols*NUM_LANES; semáforo (nodo n, carril l) en n*NUM_LANES + l
+    unsigned char* go_mask;  // por nodo: bit l encendido si el carril l puede avanzar en este paso
+} Grid;
+
+// Vehículos de un tile (SoA que crece a demanda). node = intersección (global) donde está.
+typedef struct {
+    int            n;
+    int            cap;
+    int*           id;
+    int*           node;
+    unsigned char* lane;
+    double*        pos;         // distancia a la línea de alto de su intersección (m)
+    double*        speed;       // m/s
+    unsigned char* waiting;
+    unsigned char* finished;    // VEH_EN_ROUTE / VEH_CROSSED_NOW (los que salen se quitan)
+    double*        total_wait;
+    int*           crossings;   // intersecciones cruzadas
+} GridVehicles;
+
+// Vehículo en tránsito entre tiles o procesos: solo se arma en los bordes, formato AoS.
+typedef struct {
+    int    id;
+    int    node;
+    int    lane;
+    int    crossings;
+    double pos;
+    double speed;
+    double total_wait;
+} VehicleRecord;
+
+typedef struct {
+    VehicleRecord* v;
+    int            count;
+    int            cap;
+} HandoffQueue;
+
+enum { HANDOFF_UP = 0, HANDOFF_DOWN = 1 };
+
+// Resultados por id de los vehículos que salieron de la malla (arreglos compartidos entre tiles:
+// cada id lo escribe solo el tile por el que sale). NULL = no se guardan (traffic_mpi).
+typedef struct {
+    double*   total_wait;
+    int*      crossings;
+} GridResults;
+
+typedef struct {
+    int          r0;        // filas [r0, r1) de la malla
+    int          r1;
+    GridVehicles V;
+    EventBuffer  crossed;   // slots (no ids) que cruzaron en el paso; uso interno del tile
+    double       sum_wait;      // de los que salieron de la malla por este tile
+    long long    sum_crossings;
+} GridTile;
+
+// ----------------------- Colas de traspaso -----------------------
+static inline void handoff_push(HandoffQueue* Q, const VehicleRecord* r) {
+    if (Q->count == Q->cap) {
+        Q->cap = Q->cap ? 2 * Q->cap : 64;
+        Q->v = (VehicleRecord*)realloc(Q->v, (size_t)Q->cap * sizeof(VehicleRecord));
+    }
+    Q->v[Q->count++] = *r;
+}
+
+static inline void handoff_free(HandoffQueue* Q) {
+    free(Q->v);
+    Q->v = NULL;
+    Q->count = Q->cap = 0;
+}
+
+// ----------------------- Vehículos del tile -----------------------
+static inline void grid_vehicles_reserve(GridVehicles* G, int cap) {
+    if (cap <= G->cap) return;
+    int c = G->cap ? G->cap : 256;
+    while (c < cap) c *= 2;
+    G->id         = (int*)realloc(G->id, (size_t)c * sizeof(int));
+    G->node       = (int*)realloc(G->node, (size_t)c * sizeof(int));
+    G->lane       = (unsigned char*)realloc(G->lane, (size_t)c);
+    G->pos        = (double*)realloc(G->pos, (size_t)c * sizeof(double));
+    G->speed      = (double*)realloc(G->speed, (size_t)c * sizeof(double));
+    G->waiting    = (unsigned char*)realloc(G->waiting, (size_t)c);
+    G->finished   = (unsigned char*)realloc(G->finished, (size_t)c);
+    G->total_wait = (double*)realloc(G->total_wait, (size_t)c * sizeof(double));
+    G->crossings  = (int*)realloc(G->crossings, (size_t)c * sizeof(int));
+    G->cap = c;
+}
+
+// Agrega un vehículo que entra al tile; llega en movimiento a su nueva intersección.
+static inline void grid_vehicles_push(GridVehicles* G, const VehicleRecord* r) {
+    grid_vehicles_reserve(G, G->n + 1);
+    int s = G->n++;
+    G->id[s]         = r->id;
+    G->node[s]       = r->node;
+    G->lane[s]       = (unsigned char)r->lane;
+    G->pos[s]        = r->pos;
+    G->speed[s]      = r->speed;
+    G->waiting[s]    = 0;
+    G->finished[s]   = VEH_EN_ROUTE;
+    G->total_wait[s] = r->total_wait;
+    G->crossings[s]  = r->crossings;
+}
+
+static inline VehicleRecord grid_vehicles_record(const GridVehicles* G, int s) {
+    VehicleRecord r = { G->id[s], G->node[s], G->lane[s], G->crossings[s],
+                        G->pos[s], G->speed[s], G->total_wait[s] };
+    return r;
+}
+
+// Quita el slot s moviendo el último a su lugar.
+static inline void grid_vehicles_remove(GridVehicles* G, int s) {
+    int last = --G->n;
+    if (s == last) return;
+    G->id[s]         = G->id[last];
+    G->node[s]       = G->node[last];
+    G->lane[s]       = G->lane[last];
+    G->pos[s]        = G->pos[last];
+    G->speed[s]      = G->speed[last];
+    G->waiting[s]    = G->waiting[last];
+    G->finished[s]   = G->finished[last];
+    G->total_wait[s] = G->total_wait[last];
+    G->crossings[s]  = G->crossings[last];
+}
+
+static inline void grid_vehicles_free(GridVehicles* G) {
+    free(G->id); free(G->node); free(G->lane); free(G->pos); free(G->speed);
+    free(G->waiting); free(G->finished); free(G->total_wait); free(G->crossings);
+    *G = (GridVehicles){0};
+}
+
+// ----------------------- Semáforos de la malla -----------------------
+static inline void init_grid(Grid* M, int rows, int cols, unsigned int seed) {
+    M->rows = rows;
+    M->cols = cols;
+    M->stop_distance = 2.0;
+    M->block_length = GRID_BLOCK_LENGTH;
+    M->lights = (TrafficLight*)calloc((size_t)rows * cols * NUM_LANES, sizeof(TrafficLight));
+    M->go_mask = (unsigned char*)calloc((size_t)rows * cols, 1);
+
+    for (int n = 0; n < rows * cols; ++n) {
+        for (int l = 0; l < NUM_LANES; ++l) {
+            TrafficLight* L = &M->lights[n * NUM_LANES + l];
+            L->id = l;
+            const int k = n * NUM_LANES + l;
+            L->t_green  = rng_uniform(seed, RNG_GRID_LIGHTS, k, 0, 5.0, 9.0); // 5–9 s
+            L->t_yellow = rng_uniform(seed, RNG_GRID_LIGHTS, k, 1, 2.0, 4.0); // 2–4 s
+            L->t_red    = rng_uniform(seed, RNG_GRID_LIGHTS, k, 2, 5.0, 9.0); // 5–9 s
+            // Alternado por carril y por intersección (malla en damero)
+            L->state = ((l + n / cols + n % cols) % 2 == 0) ? GREEN : RED;
+            L->time_in_state = 0.0;
+        }
+    }
+}
+
+static inline void free_grid(Grid* M) {
+    free(M->lights);
+    free(M->go_mask);
+}
+
+// Actualiza los semáforos de las filas [r0, r1) y su máscara de carriles que avanzan.
+static inline void update_grid_lights(Grid* M, int r0, int r1, double dt) {
+    for (int n = r0 * M->cols; n < r1 * M->cols; ++n) {
+        unsigned char mask = 0;
+        for (int l = 0; l < NUM_LANES; ++l) {
+            TrafficLight* L = &M->lights[n * NUM_LANES + l];
+            update_traffic_light(L, dt);
+            if (L->state == GREEN || L->state == YELLOW) mask |= (unsigned char)(1u << l);
+        }
+        M->go_mask[n] = mask;
+    }
+}
+
+// Intersección inicial del vehículo id (la parte del sorteo que necesita todo proceso para
+// saber de quién es el vehículo).
+static inline int draw_grid_node(const Grid* M, int id, unsigned int seed) {
+    int nodes = M->rows * M->cols;
+    int node = (int)rng_uniform(seed, RNG_GRID_VEHICLES, id, 0, 0.0, (double)nodes);
+    return (node < nodes) ? node : nodes - 1;
+}
+
+// Sortea el vehículo id. Generador por contador: se puede llamar en cualquier orden y desde
+// cualquier hilo o proceso, la flota es la misma.
+static inline VehicleRecord draw_grid_vehicle(const Grid* M, int id, unsigned int seed) {
+    VehicleRecord r;
+    r.id = id;
+    r.node = draw_grid_node(M, id, seed);
+    r.lane = id % NUM_LANES;
+    r.crossings = 0;
+    r.pos = rng_uniform(seed, RNG_GRID_VEHICLES, id, 1, 20.0, 200.0);
+    r.speed = rng_uniform(seed, RNG_GRID_VEHICLES, id, 2, 6.0, 14.0);
+    r.total_wait = 0.0;
+    return r;
+}
+
+static inline void init_grid_vehicles(const Grid* M, int N, unsigned int seed, VehicleRecord* out) {
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < N; ++i) out[i] = draw_grid_vehicle(M, i, seed);
+}
+
+// ----------------------- Kernel de la malla -----------------------
+// Igual que move_vehicles_soa, pero la luz sale de la máscara de la intersección de cada
+// vehículo. Mueve los slots [begin, end); los que cruzan quedan en VEH_CROSSED_NOW.
+// Devuelve cuántos cruzaron.
+static inline int move_grid_range(GridVehicles* G, const unsigned char* go_mask,
+                                  double stop_distance, double dt, int begin, int end) {
+    const int*           restrict node       = G->node;
+    const unsigned char* restrict lane       = G->lane;
+    const double*        restrict speed      = G->speed;
+    double*              restrict pos        = G->pos;
+    double*              restrict total_wait = G->total_wait;
+    unsigned char*       restrict waiting    = G->waiting;
+    unsigned char*       restrict finished   = G->finished;
+
+    int n_crossed = 0;
+
+    #pragma omp simd reduction(+:n_crossed)
+    for (int i = begin; i < end; ++i) {
+        int go = (go_mask[node[i]] >> lane[i]) & 1;
+
+        int w = waiting[i] & !go;
+        double p = w ? pos[i] : pos[i] - speed[i] * dt;
+
+        int arrive = (p <= 0.0);
+        int cross  = arrive & go;
+        int halt   = arrive & (!go) & (!w);
+        w |= halt;
+
+        pos[i]         = cross ? 0.0 : (halt ? stop_distance : p);
+        waiting[i]     = (unsigned char)w;
+        total_wait[i] += w ? dt : 0.0;
+        finished[i]    = (unsigned char)(cross ? VEH_CROSSED_NOW : VEH_EN_ROUTE);
+        n_crossed     += cross;
+    }
+    return n_crossed;
+}
+
+// Deja en crossed_slots (de menor a mayor) los slots que cruzaron en este paso.
+static inline void collect_grid_crossings(const GridVehicles* G, int n_crossed, EventBuffer* crossed_slots) {
+    crossed_slots->count = 0;
+    if (n_crossed <= 0) return;
+    event_buffer_reserve(crossed_slots, n_crossed);
+    for (int i = 0; i < G->n; ++i) {
+        if (G->finished[i] == VEH_CROSSED_NOW) crossed_slots->ids[crossed_slots->count++] = i;
+    }
+}
+
+static inline int move_grid_vehicles(GridVehicles* G, const unsigned char* go_mask,
+                                     double stop_distance, double dt, EventBuffer* crossed_slots) {
+    int n_crossed = move_grid_range(G, go_mask, stop_distance, dt, 0, G->n);
+    collect_grid_crossings(G, n_crossed, crossed_slots);
+    return n_crossed;
+}
+
+// Lleva a cada vehículo que cruzó a la intersección siguiente: si queda en el tile cambia de
+// nodo en su lugar, si queda en otro tile va a la cola up/down, y si sale de la malla se guarda
+// su resultado en R (y en las sumas del tile). Devuelve cuántos salieron de la malla.
+static inline int route_grid_crossings(GridTile* T, const Grid* M, HandoffQueue* up,
+                                       HandoffQueue* down, GridResults* R) {
+    GridVehicles* G = &T->V;
+    int exited = 0;
+
+    // De mayor a menor slot: el que se trae al hueco al quitar ya fue procesado o no cruzó
+    for (int k = T->crossed.count - 1; k >= 0; --k) {
+        int s = T->crossed.ids[k];
+        G->crossings[s] += 1;
+
+        int r = G->node[s] / M->cols + grid_lane_dr(G->lane[s]);
+        int c = G->node[s] % M->cols + grid_lane_dc(G->lane[s]);
+
+        if (r < 0 || r >= M->rows || c < 0 || c >= M->cols) { // sale de la malla
+            if (R->total_wait) R->total_wait[G->id[s]] = G->total_wait[s];
+            if (R->crossings)  R->crossings[G->id[s]] = G->crossings[s];
+            T->sum_wait += G->total_wait[s];
+            T->sum_crossings += G->crossings[s];
+            grid_vehicles_remove(G, s);
+            exited += 1;
+            continue;
+        }
+
+        G->node[s] = r * M->cols + c;
+        G->pos[s] = M->block_length;
+        G->finished[s] = VEH_EN_ROUTE;
+
+        if (r < T->r0 || r >= T->r1) { // intersección de otro tile
+            VehicleRecord rec = grid_vehicles_record(G, s);
+            handoff_push((r < T->r0) ? up : down, &rec);
+            grid_vehicles_remove(G, s);
+        }
+    }
+    return exited;
+}
+
+// Recibe los vehículos de una cola de traspaso y la deja vacía.
+static inline void drain_handoff(GridTile* T, HandoffQueue* Q) {
+    grid_vehicles_reserve(&T->V, T->V.n + Q->count);
+    for (int k = 0; k < Q->count; ++k) grid_vehicles_push(&T->V, &Q->v[k]);
+    Q->count = 0;
+}
+
+// Filas del tile t de nt (bandas contiguas, lo más parejas posible).
+static inline void grid_tile_rows(int rows, int t, int nt, int* r0, int* r1) {
+    *r0 = (int)((long long)rows * t / nt);
+    *r1 = (int)((long long)rows * (t + 1) / nt);
+}
+
+#endif // TRAFFIC_GRID_H
@@ -0,0 +1,152 @@
+// traffic_metrics.h
+// Métricas en vivo (--metrics NOMBRE, traffic_seq y traffic_omp): una página de memoria
+// compartida (/dev/shm/NOMBRE) con el progreso de la corrida, que otro proceso lee sin frenarla
+// (metrics_reader.c la expone en formato de texto de Prometheus). No hay llamadas al sistema por
+// paso: la simulación solo hace stores atómicos sobre la página.
+//
+// Lo publica el hilo maestro al terminar cada vuelta del bucle (después del cierre del paso que
+// ya hacen todos los hilos): paso, tiempo simulado y de reloj, vivos, detenidos, cruces y los
+// tiempos por fase del hilo 0. Esos campos van bajo un seqlock: el lector reintenta si los leyó
+// mientras se escribían, así nunca ve un paso a medias. Cada hilo publica además sus propios
+// tiempos de movimiento y de barrera en su línea de la página (ninguna línea la escriben dos
+// hilos), de donde sale el desbalance. Los tiempos por fase son los de --profile: con --metrics
+// se toman aunque no se imprima la tabla.
+// Al terminar el bucle la página pasa a running = 0 con el último paso; se borra al cerrar la corrida.
+
+#ifndef TRAFFIC_METRICS_H
+#define TRAFFIC_METRICS_H
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "traffic_core.h"
+#include "traffic_profile.h"
+
+#define METRICS_MAGIC       "TRFMET1"
+#define METRICS_VERSION     1
+#define METRICS_MAX_THREADS 256
+
+// Línea de un hilo (tiempos acumulados en s, como bits de double).
+typedef struct {
+    _Alignas(64) uint64_t move;
+    uint64_t barrier;
+} MetricsThread;
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    int32_t  pid;
+    char     engine[16];
+    int32_t  num_vehicles;
+    int32_t  num_threads;
+    // Bajo el seqlock (impar = escribiendo)
+    _Alignas(64) uint64_t seq;
+    uint64_t running;      // 1 mientras corre el bucle de pasos
+    uint64_t step;
+    uint64_t ff_steps;
+    uint64_t crossed;
+    uint64_t active;
+    uint64_t waiting;
+    uint64_t sim_time;     // bits de double, s
+    uint64_t wall;         // bits de double, s desde metrics_open
+    uint64_t phase[PH_COUNT]; // bits de double, s del hilo 0
+    MetricsThread thread[METRICS_MAX_THREADS];
+} MetricsPage;
+
+typedef struct {
+    MetricsPage* page; // NULL = sin --metrics
+    char         name[256];
+    double       t0;
+} MetricsWriter;
+
+static inline uint64_t metrics_bits(double x) {
+    uint64_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+static inline double metrics_double(uint64_t b) {
+    double x;
+    memcpy(&x, &b, sizeof(x));
+    return x;
+}
+
+static inline void metrics_store(uint64_t* field, uint64_t v) {
+    __atomic_store_n(field, v, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t metrics_load(const uint64_t* field) {
+    return __atomic_load_n(field, __ATOMIC_RELAXED);
+}
+
+// Crea (o reemplaza) la página /NOMBRE. engine: "seq" / "omp".
+static inline void metrics_open(MetricsWriter* M, const char* name, const char* engine, int num_vehicles,
+                                int num_threads) {
+    *M = (MetricsWriter){0};
+    snprintf(M->name, sizeof(M->name), "/%s", name);
+    int fd = shm_open(M->name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0 || ftruncate(fd, (off_t)sizeof(MetricsPage)) != 0) {
+        fprintf(stderr, "No se pudo crear la página de métricas: %s\n", M->name);
+        exit(1);
+    }
+    void* p = mmap(NULL, sizeof(MetricsPage), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (p == MAP_FAILED) {
+        fprintf(stderr, "No se pudo mapear la página de métricas: %s\n", M->name);
+        exit(1);
+    }
+    MetricsPage* P = (MetricsPage*)p; // en cero (ftruncate)
+    P->version = METRICS_VERSION;
+    P->pid = (int32_t)getpid();
+    snprintf(P->engine, sizeof(P->engine), "%s", engine);
+    P->num_vehicles = num_vehicles;
+    P->num_threads = num_threads < METRICS_MAX_THREADS ? num_threads : METRICS_MAX_THREADS;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    memcpy(P->magic, METRICS_MAGIC, sizeof(P->magic)); // último: el lector la da por válida
+    M->page = P;
+    M->t0 = profile_now();
+}
+
+// Progreso del paso: S trae los contadores por carril ya cerrados; T, los tiempos del hilo 0 (o NULL).
+static inline void metrics_publish(MetricsWriter* M, bool running, int step, double sim_time, int crossed,
+                                   int ff_steps, const VehicleSoA* S, const PhaseProfile* T) {
+    MetricsPage* P = M->page;
+    int active = 0, waiting = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        active += S->lane_live[l];
+        waiting += S->lane_waiting[l];
+    }
+    uint64_t seq = metrics_load(&P->seq);
+    metrics_store(&P->seq, seq + 1);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    metrics_store(&P->running, running);
+    metrics_store(&P->step, (uint64_t)step);
+    metrics_store(&P->ff_steps, (uint64_t)ff_steps);
+    metrics_store(&P->crossed, (uint64_t)crossed);
+    metrics_store(&P->active, (uint64_t)active);
+    metrics_store(&P->waiting, (uint64_t)waiting);
+    metrics_store(&P->sim_time, metrics_bits(sim_time));
+    metrics_store(&P->wall, metrics_bits(profile_now() - M->t0));
+    if (T) {
+        for (int ph = 0; ph < PH_COUNT; ++ph) metrics_store(&P->phase[ph], metrics_bits(T->phase[ph]));
+    }
+    __atomic_store_n(&P->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+// Tiempos de un hilo, en su propia línea.
+static inline void metrics_publish_thread(MetricsWriter* M, int t, const PhaseProfile* T) {
+    if (t >= METRICS_MAX_THREADS) return;
+    metrics_store(&M->page->thread[t].move, metrics_bits(T->phase[PH_MOVE]));
+    metrics_store(&M->page->thread[t].barrier, metrics_bits(T->phase[PH_BARRIER]));
+}
+
+static inline void metrics_close(MetricsWriter* M) {
+    if (!M->page) return;
+    munmap(M->page, sizeof(MetricsPage));
+    shm_unlink(M->name);
+    M->page = NULL;
+}
+
+#endif // TRAFFIC_METRICS_H
@@ -0,0 +1,30 @@
+// traffic_move_variant.h
+// Plantilla de una variante del recorrido de movimiento (ver traffic_specialize.h). Sin guarda de
+// inclusión a propósito: cada inclusión genera una función con los parámetros de compilación
+//   MOVE_VARIANT  nombre de la función
+//   MOVE_EVENTS   1 = junta los ids de los que cruzan en events (lo que imprime print_state)
+//   MOVE_STATS    1 = escanea los tramos con cruces para --stats (stats_scan_slice)
+// Con el parámetro en 0 la prueba y el segundo recorrido desaparecen de la función generada.
+
+static void MOVE_VARIANT(VehicleSoA* S, const LaneSlice* slices, int num_slices, const LaneMode mode[NUM_LANES],
+                         double stop_distance, double dt, EventBuffer* events, RunStats* R,
+                         int crossed[NUM_LANES], int halted[NUM_LANES], long long* cross_wait) {
+    // Dentro de la región paralela de traffic_omp reparte los tramos como el resto del paso
+    #pragma omp for schedule(static) nowait
+    for (int k = 0; k < num_slices; ++k) {
+        const LaneSlice* sl = &slices[k];
+        const int l = sl->lane;
+        if (mode[l] == LANE_RED_QUEUED) { // nadie llega a la línea: ni eventos ni esperas al cruzar
+            wait_vehicles_soa(S, dt, sl->begin, sl->end);
+            continue;
+        }
+        int n = move_vehicles_soa(S, mode[l] == LANE_GO, stop_distance, dt, sl->begin, sl->end,
+                                  MOVE_EVENTS ? events : NULL, &halted[l]);
+        crossed[l] += n;
+        if (MOVE_STATS && n > 0) *cross_wait += stats_scan_slice(S, sl, dt, R);
+    }
+}
+
+#undef MOVE_VARIANT
+#undef MOVE_EVENTS
+#undef MOVE_STATS
@@ -0,0 +1,251 @@
+// traffic_mpi.c
+// Simulación de tráfico en una malla de intersecciones (Versión Híbrida MPI + OpenMP).
+// Cada proceso es dueño de un bloque de filas contiguas de la malla (mismo reparto que los
+// tiles de traffic_grid.c) y mueve sus vehículos con los hilos OpenMP del nodo. Los vehículos
+// que cruzan a una fila de otro proceso se envían una vez por paso con MPI_Isend; la
+// comunicación se solapa con el movimiento de los vehículos locales del paso siguiente.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <math.h>
+#include <mpi.h>
+#include <omp.h>
+
+#include "traffic_grid.h"
+
+// Tamaño de bloque del bucle OpenMP dentro de cada proceso
+#define VEH_BLOCK 2048
+
+#define TAG_HANDOFF 1
+
+// ----------------------- Intercambio de bordes -----------------------
+// Envíos pendientes hacia los vecinos de arriba/abajo (MPI_PROC_NULL en los bordes de la malla).
+typedef struct {
+    int          up;
+    int          down;
+    MPI_Request  send[2];
+    HandoffQueue out[2][2];   // [paridad][HANDOFF_UP/DOWN]: la cola en vuelo no se toca hasta Wait
+} Halo;
+
+static inline void halo_post_sends(Halo* H, int p) {
+    HandoffQueue* up = &H->out[p][HANDOFF_UP];
+    HandoffQueue* dn = &H->out[p][HANDOFF_DOWN];
+    MPI_Isend(up->v, up->count * (int)sizeof(VehicleRecord), MPI_BYTE, H->up, TAG_HANDOFF,
+              MPI_COMM_WORLD, &H->send[HANDOFF_UP]);
+    MPI_Isend(dn->v, dn->count * (int)sizeof(VehicleRecord), MPI_BYTE, H->down, TAG_HANDOFF,
+              MPI_COMM_WORLD, &H->send[HANDOFF_DOWN]);
+}
+
+// Recibe (tamaño variable: Probe + Recv) lo que mandó un vecino y lo agrega al tile.
+static inline void halo_receive(GridTile* T, HandoffQueue* scratch, int from) {
+    if (from == MPI_PROC_NULL) return;
+    MPI_Status st;
+    int bytes = 0;
+    MPI_Probe(from, TAG_HANDOFF, MPI_COMM_WORLD, &st);
+    MPI_Get_count(&st, MPI_BYTE, &bytes);
+    int count = bytes / (int)sizeof(VehicleRecord);
+    if (count > scratch->cap) {
+        scratch->cap = count;
+        scratch->v = (VehicleRecord*)realloc(scratch->v, (size_t)count * sizeof(VehicleRecord));
+    }
+    MPI_Recv(scratch->v, bytes, MPI_BYTE, from, TAG_HANDOFF, MPI_COMM_WORLD, MPI_STATUS_IGNORE);
+    scratch->count = count;
+    drain_handoff(T, scratch);
+}
+
+// ----------------------- Kernel local (OpenMP) -----------------------
+static inline int move_local(GridVehicles* G, const Grid* M, double dt, int begin, int end) {
+    int crossed = 0;
+    int num_blocks = (end - begin + VEH_BLOCK - 1) / VEH_BLOCK;
+    #pragma omp parallel for schedule(static) reduction(+:crossed)
+    for (int b = 0; b < num_blocks; ++b) {
+        int lo = begin + b * VEH_BLOCK;
+        int hi = (lo + VEH_BLOCK < end) ? lo + VEH_BLOCK : end;
+        crossed += move_grid_range(G, M->go_mask, M->stop_distance, dt, lo, hi);
+    }
+    return crossed;
+}
+
+// ----------------------- Impresión amigable (rank 0) -----------------------
+// Junta en rank 0 conteos por intersección (incluye los vehículos en vuelo, contados en la
+// intersección destino) y estados de los semáforos de cada bloque.
+void print_mpi_state(int step, double sim_time, const Grid* M, const GridTile* T, const Halo* H,
+                     int p, int my_exited, int rank) {
+    int nodes = M->rows * M->cols;
+    int* local = (int*)calloc((size_t)2 * nodes, sizeof(int));
+    unsigned char* light_local = (unsigned char*)calloc((size_t)nodes * NUM_LANES, 1);
+    for (int s = 0; s < T->V.n; ++s) {
+        local[T->V.node[s]] += 1;
+        local[nodes + T->V.node[s]] += T->V.waiting[s];
+    }
+    for (int d = 0; d < 2; ++d) {
+        for (int k = 0; k < H->out[p][d].count; ++k) local[H->out[p][d].v[k].node] += 1;
+    }
+    // Estado + 1 en las filas propias, 0 en las ajenas: MAX arma la malla completa
+    for (int n = T->r0 * M->cols; n < T->r1 * M->cols; ++n) {
+        for (int l = 0; l < NUM_LANES; ++l) {
+            light_local[n * NUM_LANES + l] = (unsigned char)(M->lights[n * NUM_LANES + l].state + 1);
+        }
+    }
+
+    int* all = (rank == 0) ? (int*)calloc((size_t)2 * nodes, sizeof(int)) : NULL;
+    unsigned char* light_all = (rank == 0) ? (unsigned char*)calloc((size_t)nodes * NUM_LANES, 1) : NULL;
+    MPI_Reduce(local, all, 2 * nodes, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+    MPI_Reduce(light_local, light_all, nodes * NUM_LANES, MPI_UNSIGNED_CHAR, MPI_MAX, 0, MPI_COMM_WORLD);
+    int exited = 0;
+    MPI_Reduce(&my_exited, &exited, 1, MPI_INT, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    if (rank == 0) {
+        int in_grid = 0;
+        for (int n = 0; n < nodes; ++n) in_grid += all[n];
+        printf("Iteración %d (t=%.1fs): en la malla: %d, ya salieron: %d\n", step, sim_time, in_grid, exited);
+        for (int n = 0; n < nodes; ++n) {
+            printf("Intersección (%d,%d) - Vehículos: %d (ESPERANDO: %d), Semáforos:",
+                   n / M->cols, n % M->cols, all[n], all[nodes + n]);
+            for (int l = 0; l < NUM_LANES; ++l) {
+                printf(" %s", state_to_str((LightState)(light_all[n * NUM_LANES + l] - 1)));
+            }
+            printf("\n");
+        }
+        printf("\n");
+        fflush(stdout);
+    }
+    free(all);
+    free(light_all);
+    free(local);
+    free(light_local);
+}
+
+// ----------------------- Simulación -----------------------
+void run_mpi_simulation(const SimConfig* cfg, int rank, int size) {
+    const int    num_vehicles = cfg->num_vehicles;
+    const int    print_every  = cfg->print_every;
+    const double dt           = cfg->dt;
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double wall_t0 = MPI_Wtime();
+
+    // Todos los procesos arman los mismos semáforos (misma semilla); cada uno actualiza los suyos
+    Grid M;
+    init_grid(&M, cfg->grid_rows, cfg->grid_cols, cfg->seed);
+
+    GridTile T = {0};
+    grid_tile_rows(M.rows, rank, size, &T.r0, &T.r1);
+
+    // Cada proceso sortea solo la intersección de cada id y el resto de los datos únicamente
+    // para los vehículos de sus filas (generador por contador: no hace falta recorrer en orden)
+    for (int i = 0; i < num_vehicles; ++i) {
+        int row = draw_grid_node(&M, i, cfg->seed) / M.cols;
+        if (row >= T.r0 && row < T.r1) {
+            VehicleRecord r = draw_grid_vehicle(&M, i, cfg->seed);
+            grid_vehicles_push(&T.V, &r);
+        }
+    }
+
+    Halo H = {0};
+    H.up   = (rank > 0) ? rank - 1 : MPI_PROC_NULL;
+    H.down = (rank < size - 1) ? rank + 1 : MPI_PROC_NULL;
+    H.send[0] = H.send[1] = MPI_REQUEST_NULL;
+    HandoffQueue scratch = {0};
+
+    GridResults R = {0}; // sin arreglos por id: nada de tamaño N por proceso (las sumas van en T)
+    int my_exited = 0, total_exited = 0, exited_prev = 0;
+    MPI_Request exited_req = MPI_REQUEST_NULL;
+    int step = 0;
+    double sim_time = 0.0;
+
+    if (rank == 0) {
+        printf("MPI: procesos: %d, OpenMP: hilos por proceso: %d\n", size, omp_get_max_threads());
+        printf("Malla: %dx%d intersecciones, vehículos: %d\n\n", M.rows, M.cols, num_vehicles);
+    }
+
+    for (;;) {
+        const int p = step & 1;
+
+        // 1) Semáforos propios y movimiento de los vehículos locales (mientras viajan los bordes)
+        update_grid_lights(&M, T.r0, T.r1, dt);
+        int local_n = T.V.n;
+        int crossed = move_local(&T.V, &M, dt, 0, local_n);
+
+        // 2) Completar lo del paso anterior: llegadas de los vecinos, envíos y total de salidas
+        if (step > 0) {
+            halo_receive(&T, &scratch, H.up);
+            halo_receive(&T, &scratch, H.down);
+            MPI_Waitall(2, H.send, MPI_STATUSES_IGNORE);
+            H.out[1 - p][HANDOFF_UP].count = H.out[1 - p][HANDOFF_DOWN].count = 0;
+            MPI_Wait(&exited_req, MPI_STATUS_IGNORE);
+            total_exited = exited_prev;
+            if (total_exited >= num_vehicles) break; // el paso anterior fue el último
+        }
+
+        // 3) Los que llegaron de otros procesos se mueven en este mismo paso
+        crossed += move_local(&T.V, &M, dt, local_n, T.V.n);
+
+        // 4) Enrutar cruces: dentro del bloque, a la cola de un vecino o fuera de la malla
+        collect_grid_crossings(&T.V, crossed, &T.crossed);
+        my_exited += route_grid_crossings(&T, &M, &H.out[p][HANDOFF_UP], &H.out[p][HANDOFF_DOWN], &R);
+        halo_post_sends(&H, p);
+        MPI_Iallreduce(&my_exited, &exited_prev, 1, MPI_INT, MPI_SUM, MPI_COMM_WORLD, &exited_req);
+
+        step += 1;
+        sim_time += dt;
+
+        if (print_every > 0 && (step % print_every) == 0) {
+            print_mpi_state(step, sim_time, &M, &T, &H, p, my_exited, rank);
+        }
+    }
+
+    // El último paso con movimiento fue step (el bucle cortó al empezar el siguiente)
+    double sums[2] = { T.sum_wait, (double)T.sum_crossings };
+    double total[2] = { 0.0, 0.0 };
+    MPI_Reduce(sums, total, 2, MPI_DOUBLE, MPI_SUM, 0, MPI_COMM_WORLD);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    double wall_t1 = MPI_Wtime();
+
+    if (rank == 0) {
+        printf("\n--- Resumen (Malla MPI + OpenMP) ---\n");
+        printf("Malla: %dx%d intersecciones, procesos: %d\n", M.rows, M.cols, size);
+        printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
+        printf("Vehículos que salieron de la malla: %d/%d\n", total_exited, num_vehicles);
+        printf("Intersecciones cruzadas (suma de crossings): %lld\n", (long long)total[1]);
+        printf("Espera promedio por vehículo: %.3f s\n", total[0] / (double)num_vehicles);
+        printf("Tiempo total SIMULADO: %.1f s\n", sim_time);
+        printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+    }
+
+    for (int q = 0; q < 2; ++q) {
+        handoff_free(&H.out[q][HANDOFF_UP]);
+        handoff_free(&H.out[q][HANDOFF_DOWN]);
+    }
+    handoff_free(&scratch);
+    grid_vehicles_free(&T.V);
+    event_buffer_free(&T.crossed);
+    free_grid(&M);
+}
+
+int main(int argc, char** argv) {
+    int provided = 0;
+    MPI_Init_thread(&argc, &argv, MPI_THREAD_FUNNELED, &provided); // solo el hilo maestro llama a MPI
+
+    int rank = 0, size = 1;
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+    SimConfig cfg; // v: vehículos, t: imprimir cada k pasos, semilla, --grid FxC
+    parse_sim_args(argc, argv, &cfg);
+    // Todos los procesos necesitan la misma semilla (la de time(NULL) puede variar entre nodos)
+    MPI_Bcast(&cfg.seed, 1, MPI_UNSIGNED, 0, MPI_COMM_WORLD);
+
+    if (size > cfg.grid_rows) {
+        if (rank == 0) fprintf(stderr, "Hay más procesos (%d) que filas de la malla (%d)\n", size, cfg.grid_rows);
+        MPI_Finalize();
+        return 1;
+    }
+
+    run_mpi_simulation(&cfg, rank, size);
+    MPI_Finalize();
+    return 0;
+}
@@ -0,0 +1,134 @@
+// traffic_offload.h
+// Movimiento de los vehículos en un acelerador (--offload, traffic_omp) con OpenMP target: los
+// arreglos SoA se copian al dispositivo una vez al empezar y quedan ahí toda la corrida. En cada
+// paso el host actualiza los semáforos y sube solo si cada carril puede salir (un byte por
+// carril, lo que el kernel usa de los 4 semáforos); el kernel devuelve solo los cruces y
+// detenidos por carril. El resto del bucle (semáforos, contadores por carril, fin de la
+// simulación) sigue en el host con los mismos cierres de paso que el motor de CPU.
+// Los vehículos bajan al host solo cuando alguien los mira: en los pasos que imprimen (o todos con
+// --trace), en cada paso con --hash-log / --verify-against, en los checkpoints y al terminar.
+//
+// El kernel hace por vehículo las mismas operaciones que move_vehicles_soa, así que el estado
+// es el mismo que en la CPU (un carril en ROJO con la cola completa pasa por el mismo código:
+// los detenidos no llegan a la línea y solo suman espera). En el dispositivo no hay compactación:
+// los que ya cruzaron siguen en el rango y el kernel los deja como están.
+// Compilado sin soporte de offload (o sin dispositivo al correr) la región target corre en el
+// host; el resumen dice dónde corrió. Con GCC: -fopenmp -foffload=nvptx-none (o amdgcn-amdhsa).
+
+#ifndef TRAFFIC_OFFLOAD_H
+#define TRAFFIC_OFFLOAD_H
+
+#include <omp.h>
+
+#include "traffic_core.h"
+
+// Lo que cruzó entre host y dispositivo (para el resumen).
+typedef struct {
+    bool      on_device; // el kernel corrió en un dispositivo (no en el fallback del host)
+    long long bytes_up;
+    long long bytes_down;
+    long long fetches;   // veces que el estado bajó al host
+} OffloadStats;
+
+// Bytes de los arreglos que cambian en cada paso (los que bajan para verificar o al terminar).
+static inline long long offload_state_bytes(int n) {
+    return (long long)n * (2 * (long long)sizeof(real_t) + 2 + (long long)sizeof(cross_t));
+}
+
+// Copia todos los arreglos al dispositivo (quedan residentes hasta offload_exit).
+static inline void offload_enter(const VehicleSoA* S, OffloadStats* st) {
+    const int n = S->n;
+    #pragma omp target enter data map(to: S->speed[0:n], S->lane[0:n], S->pos[0:n], S->total_wait[0:n], \
+                                          S->waiting[0:n], S->finished[0:n], S->crossings[0:n])
+    int initial = 1;
+    #pragma omp target map(from: initial)
+    initial = omp_is_initial_device();
+    st->on_device = !initial;
+    st->bytes_up += offload_state_bytes(n) + (long long)n * (sizeof(real_t) + sizeof(lane_t));
+}
+
+// Baja lo que hace falta para imprimir: posición, espera y estado de cada vehículo.
+static inline void offload_fetch_snapshot(const VehicleSoA* S, OffloadStats* st) {
+    const int n = S->n;
+    #pragma omp target update from(S->pos[0:n], S->waiting[0:n], S->finished[0:n])
+    st->bytes_down += (long long)n * (sizeof(real_t) + 2);
+    st->fetches += 1;
+}
+
+// Baja todo el estado que cambia (hash, checkpoint).
+static inline void offload_fetch_state(const VehicleSoA* S, OffloadStats* st) {
+    const int n = S->n;
+    #pragma omp target update from(S->pos[0:n], S->total_wait[0:n], S->waiting[0:n], S->finished[0:n], \
+                                   S->crossings[0:n])
+    st->bytes_down += offload_state_bytes(n);
+    st->fetches += 1;
+}
+
+// Estado final al host y libera el dispositivo.
+static inline void offload_exit(const VehicleSoA* S, OffloadStats* st) {
+    const int n = S->n;
+    #pragma omp target exit data map(from: S->pos[0:n], S->total_wait[0:n], S->waiting[0:n], S->finished[0:n], \
+                                           S->crossings[0:n]) map(delete: S->speed[0:n], S->lane[0:n])
+    st->bytes_down += offload_state_bytes(n);
+}
+
+// ----------------------- Kernel -----------------------
+// Un paso de todos los vehículos en el dispositivo. go[l]: el carril l puede salir (luz VERDE o
+// AMARILLA). Suma en crossed/halted los cruces y detenidos de cada carril.
+static inline void offload_move_vehicles(const VehicleSoA* S, const unsigned char go[NUM_LANES],
+                                         double stop_distance, double dt, int crossed[NUM_LANES],
+                                         int halted[NUM_LANES], OffloadStats* st) {
+    const int n = S->n;
+    const real_t*  speed      = S->speed;
+    const lane_t*  lane       = S->lane;
+    real_t*        pos        = S->pos;
+    real_t*        total_wait = S->total_wait;
+    unsigned char* waiting    = S->waiting;
+    unsigned char* finished   = S->finished;
+    cross_t*       crossings  = S->crossings;
+    const real_t   rdt  = (real_t)dt;
+    const real_t   stop = (real_t)stop_distance;
+    int n_crossed[NUM_LANES] = {0}, n_halted[NUM_LANES] = {0};
+
+    // Los arreglos ya están en el dispositivo (map sin copia); sube go y bajan las sumas
+    #pragma omp target teams distribute parallel for \
+        map(alloc: speed[0:n], lane[0:n], pos[0:n], total_wait[0:n], waiting[0:n], finished[0:n], crossings[0:n]) \
+        map(to: go[0:NUM_LANES]) reduction(+: n_crossed[0:NUM_LANES], n_halted[0:NUM_LANES])
+    for (int i = 0; i < n; ++i) {
+        int g    = go[lane[i]];
+        int done = (finished[i] != VEH_EN_ROUTE);
+
+        // Mismas operaciones que move_vehicles_soa
+        int w = waiting[i] & !g;
+        real_t p = w ? pos[i] : pos[i] - speed[i] * rdt;
+
+        int arrive = (p <= (real_t)0);
+        int cross  = (!done) & arrive & g;
+        int halt   = (!done) & arrive & (!g) & (!w);
+        w |= halt;
+
+        pos[i]        = done ? pos[i] : (cross ? (real_t)0 : (halt ? stop : p));
+        waiting[i]    = (unsigned char)(done ? waiting[i] : w);
+        total_wait[i] += ((!done) & w) ? rdt : (real_t)0;
+        finished[i]   = (unsigned char)(done ? VEH_DONE : (cross ? VEH_CROSSED_NOW : VEH_EN_ROUTE));
+        crossings[i]  |= (cross_t)cross;
+        n_crossed[lane[i]] += cross;
+        n_halted[lane[i]]  += halt;
+    }
+
+    for (int l = 0; l < NUM_LANES; ++l) {
+        crossed[l] += n_crossed[l];
+        halted[l] += n_halted[l];
+    }
+    st->bytes_up += NUM_LANES;
+    st->bytes_down += 2 * NUM_LANES * (long long)sizeof(int);
+}
+
+static inline void print_offload_stats(const OffloadStats* st) {
+    if (st->on_device) printf("Offload: kernel en el dispositivo %d de %d\n", omp_get_default_device(), omp_get_num_devices());
+    else printf("Offload: sin dispositivo, el kernel corrió en el host (fallback de OpenMP target)\n");
+    printf("Transferencias%s: %.2f MiB al dispositivo, %.2f MiB al host (%lld descargas del estado)\n",
+           st->on_device ? "" : " (las que haría con dispositivo)", (double)st->bytes_up / (1 << 20), (double)st->bytes_down / (1 << 20), st->fetches);
+}
+
+#endif // TRAFFIC_OFFLOAD_H
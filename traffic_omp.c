@@ -1,278 +1,1080 @@
 // traffic_omp.c
 // Simulación de tráfico con semáforos y vehículos (Versión Paralela con OpenMP - OPTIMIZADA: Paso 7)
 
+#define _GNU_SOURCE // syscall(): consulta de ubicación NUMA con move_pages
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <time.h>
 #include <math.h>
 #include <omp.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
-typedef enum { RED = 0, GREEN = 1, YELLOW = 2 } LightState;
+#include "traffic_core.h"
+#include "traffic_arena.h"
+#include "traffic_trace.h"
+#include "traffic_checkpoint.h"
+#include "traffic_stream.h"
+#include "traffic_bench.h"
+#include "traffic_profile.h"
+#include "traffic_verify.h"
+#include "traffic_ensemble.h"
+#include "traffic_follow.h"
+#include "traffic_actuated.h"
+#include "traffic_tiling.h"
+#include "traffic_offload.h"
+#include "traffic_stats.h"
+#include "traffic_metrics.h"
+#include "traffic_batch.h"
+#include "traffic_scenario.h"
+#include "traffic_specialize.h"
 
-// ----------------------- Estructuras -----------------------
-typedef struct {
-    int        id;
-    LightState state;
-    double     time_in_state; // segundos en el estado actual
-    double     t_green;       // duración de verde (<= 10 s)
-    double     t_yellow;      // duración de amarillo (<= 10 s)
-    double     t_red;         // duración de rojo (<= 10 s)
-} TrafficLight;
+// Tamaño de tramo del bucle paralelo: cada iteración del omp for mueve un tramo contiguo de un
+// solo carril con el kernel SoA (el compilador ve un bucle interno simple, sin luz por vehículo).
+#define VEH_BLOCK 2048
 
-typedef struct {
-    int    id;
-    int    lane;           // 0..3 (N, E, S, O)
-    double pos;            // distancia a la línea de alto (m)
-    double speed;          // m/s
-    bool   waiting;        // está detenido
-    double total_wait;     // s acumulados esperando
-    int    crossings;      // 0 o 1 (cruzó)
-    bool   finished;       // true cuando ya cruzó
-} Vehicle;
+// ----------------------- Impresión amigable -----------------------
+void print_configuration(const VehicleSoA* V, const Intersection* X) {
+    printf("\nResumen de configuración:\n");
+    for (int id = 0; id < V->n; ++id) {
+        int i = V->slot[id];
+        printf("Vehículo %d - Carril: %d, Velocidad: %.2f m/s, Posición inicial: %.2f m\n",
+               id, V->lane[i], V->speed[i], V->pos[i]);
+    }
+    for (int i = 0; i < X->num_lights; ++i) {
+        printf("Semáforo %d - Estado inicial: %s, Tiempos: R: %.1fs, V: %.1fs, A: %.1fs\n",
+               i, state_to_str(X->lights[i].state), X->lights[i].t_red, X->lights[i].t_green, X->lights[i].t_yellow);
+    }
+    printf("\n");
+}
 
-typedef struct {
-    int           num_lanes;
-    int           num_lights;
-    double        stop_distance;
-    TrafficLight* lights;
-} Intersection;
+// Consumidor de snapshots (hilo escritor): texto en los pasos que imprimen y traza binaria en
+// todos si se pidió --trace.
+static void omp_snapshot_sink(void* ctx, const Snapshot* snap) {
+    TraceWriter* trace = (TraceWriter*)ctx;
+    if (snap->text) write_snapshot_text(stdout, snap);
+    if (trace) trace_write_step(trace, snap);
+}
 
-// ----------------------- Utilidades -----------------------
-static inline double rand_uniform(double a, double b) { return a + (b - a) * (rand() / (double)RAND_MAX); }
+// ----------------------- Ubicación NUMA -----------------------
+#define NUMA_MAX_NODES 64
 
-static inline const char* state_to_str(LightState s) {
-    return (s == GREEN) ? "V" : (s == YELLOW ? "A" : "R");
+// Cuenta las páginas de [base, base + bytes) por nodo NUMA (move_pages sin nodos destino solo
+// consulta, no mueve nada). absent: páginas todavía no escritas. Devuelve false si el sistema
+// no permite la consulta.
+static bool numa_page_nodes(const void* base, size_t bytes, int* per_node, int* absent) {
+#ifdef SYS_move_pages
+    const size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    const size_t batch = 4096;
+    uintptr_t first = (uintptr_t)base & ~(uintptr_t)(page - 1);
+    size_t num_pages = ((uintptr_t)base + bytes - first + page - 1) / page;
+    void** pages = (void**)malloc(batch * sizeof(void*));
+    int* status = (int*)malloc(batch * sizeof(int));
+    bool ok = true;
+    for (size_t p0 = 0; p0 < num_pages && ok; p0 += batch) {
+        size_t count = (num_pages - p0 < batch) ? num_pages - p0 : batch;
+        for (size_t k = 0; k < count; ++k) pages[k] = (void*)(first + (p0 + k) * page);
+        if (syscall(SYS_move_pages, 0, (unsigned long)count, pages, NULL, status, 0) != 0) {
+            ok = false;
+            break;
+        }
+        for (size_t k = 0; k < count; ++k) {
+            if (status[k] >= 0 && status[k] < NUMA_MAX_NODES) per_node[status[k]] += 1;
+            else *absent += 1;
+        }
+    }
+    free(pages);
+    free(status);
+    return ok;
+#else
+    (void)base; (void)bytes; (void)per_node; (void)absent;
+    return false;
+#endif
 }
 
-// ----------------------- Semáforos -----------------------
-static inline void update_traffic_light(TrafficLight* L, double dt) {
-    L->time_in_state += dt;
-    switch (L->state) {
-        case GREEN:
-            if (L->time_in_state >= L->t_green) {
-                L->state = YELLOW;
-                L->time_in_state = 0.0;
-            }
-            break;
-        case YELLOW:
-            if (L->time_in_state >= L->t_yellow) {
-                L->state = RED;
-                L->time_in_state = 0.0;
-            }
-            break;
-        case RED:
-        default:
-            if (L->time_in_state >= L->t_red) {
-                L->state = GREEN;
-                L->time_in_state = 0.0;
-            }
-            break;
+// Resumen de dónde quedaron las páginas de los arreglos calientes del kernel.
+void print_numa_placement(const VehicleSoA* V) {
+    const struct { const char* name; const void* base; size_t bytes; } arrays[] = {
+        { "pos",        V->pos,        (size_t)V->n * sizeof(real_t) },
+        { "speed",      V->speed,      (size_t)V->n * sizeof(real_t) },
+        { "total_wait", V->total_wait, (size_t)V->n * sizeof(real_t) },
+        { "waiting",    V->waiting,    (size_t)V->n },
+        { "finished",   V->finished,   (size_t)V->n },
+    };
+    printf("Ubicación NUMA de los vehículos (páginas por nodo):\n");
+    for (size_t a = 0; a < sizeof(arrays) / sizeof(arrays[0]); ++a) {
+        int per_node[NUMA_MAX_NODES] = {0};
+        int absent = 0;
+        if (!numa_page_nodes(arrays[a].base, arrays[a].bytes, per_node, &absent)) {
+            printf("  (el sistema no permite consultar la ubicación de las páginas)\n\n");
+            return;
+        }
+        printf("  %-10s:", arrays[a].name);
+        for (int n = 0; n < NUMA_MAX_NODES; ++n) {
+            if (per_node[n] > 0) printf(" nodo %d: %d", n, per_node[n]);
+        }
+        if (absent > 0) printf(" sin asignar: %d", absent);
+        printf("\n");
     }
+    printf("\n");
 }
 
-// ----------------------- Vehículos -----------------------
-// Devuelve 1 si el vehículo cruzó en este paso; 0 si no.
-static inline int move_vehicle(Vehicle* V, const Intersection* X, double dt) {
-    if (V->finished) return 0; // ya cruzó
+// ----------------------- Simulación  -----------------------
+// Lo que cada hilo aporta a un paso: cruces y detenidos por carril, y la racha quieta de sus tramos.
+typedef struct {
+    _Alignas(64) int crossed[NUM_LANES];
+    int halted[NUM_LANES];
+    int quiet;
+    LaneDemand demand; // --actuated: demanda de mis tramos
+    long long cross_wait; // --stats: espera de los que cruzaron en mis tramos, en pasos
+} StepPartial;
 
-    TrafficLight* L = &X->lights[V->lane];
+// Con cfg->bench no imprime nada: solo deja en result los pasos y el tiempo del bucle.
+void run_simulation(const SimConfig* cfg, SimResult* result) {
+    const int    num_vehicles = cfg->num_vehicles;
+    const int    print_every  = cfg->print_every;
+    const double dt           = cfg->dt;
 
-    // Si está esperando y la luz permite, sale
-    if (V->waiting && (L->state == GREEN || L->state == YELLOW)) {
-        V->waiting = false;
-    }
+    double wall_t0 = omp_get_wtime(); // inicio medición wall-clock de alta precisión
+
+    Intersection X;
+    VehicleSoA V;
+    VehicleSortKey* init_key = NULL;
+    SimProgress P = {0};
+    CheckpointMapping resumed = {0}; // con --resume, V vive en el mapeo del checkpoint
+    CheckpointMapping table = {0};   // con la tabla del escenario, en el mapeo de la tabla
+    const bool resuming = cfg->resume_path != NULL;
+    const bool drawing = !resuming && !cfg->vehicle_table; // vehículos sorteados con la semilla
+    const bool following = cfg->car_following;
+    const bool actuated = cfg->actuated;
+    const bool blocking = cfg->time_block > 1; // --time-block (ver traffic_tiling.h)
+    const bool counting = cfg->stats_path != NULL; // --stats (ver traffic_stats.h)
+    const int max_slices = num_vehicles / VEH_BLOCK + NUM_LANES;
+    const int max_threads = omp_get_max_threads();
+
+    // Todo lo que dura la corrida sale de una arena: semáforos y vehículos (salvo al reanudar o
+    // con tabla, que están en el mapeo), tramos, colas de tramo y parciales por hilo
+    Arena arena;
+    size_t arena_size = arena_bytes((size_t)max_slices, sizeof(LaneSlice)) +
+                        arena_bytes((size_t)2 * max_threads, sizeof(StepPartial));
+    if (following) arena_size += arena_bytes((size_t)2 * max_slices, sizeof(double));
+    if (blocking) arena_size += arena_bytes((size_t)2 * max_threads, sizeof(TimeBlockPartial));
+    if (!resuming) arena_size += intersection_arena_bytes();
+    if (drawing) arena_size += vehicles_arena_bytes(num_vehicles);
+    arena_init(&arena, arena_size, cfg->huge_pages);
 
-    // Avance simple si no espera
-    if (!V->waiting) {
-        V->pos -= V->speed * dt;
+    if (resuming) {
+        if (!checkpoint_map(cfg->resume_path, &V, &X, &P, &resumed)) exit(1);
+    } else {
+        init_intersection_arena(&X, cfg->seed, &arena);
+        if (cfg->scenario_path) scenario_apply_lights(cfg->scenario_path, &X);
     }
+    if (cfg->vehicle_table) {
+        if (!vehicle_table_map(cfg->vehicle_table, &V, &table)) exit(1);
+    } else if (drawing) {
+        // Los vehículos se escriben por primera vez dentro de la región paralela (ver abajo)
+        alloc_vehicles_soa_arena(&V, num_vehicles, &arena);
+        init_key = (VehicleSortKey*)malloc((size_t)num_vehicles * sizeof(VehicleSortKey));
+    }
+
+    // Tramos por carril del rango activo; se rearman solo cuando hay compactación
+    LaneSlice* slices = (LaneSlice*)arena_alloc(&arena, (size_t)max_slices * sizeof(LaneSlice));
+    int num_slices = build_lane_slices(&V, VEH_BLOCK, slices);
+    // --car-following: último vivo de cada tramo, por paridad de vuelta (ver traffic_follow.h)
+    double* tail = following ? (double*)arena_alloc(&arena, (size_t)2 * max_slices * sizeof(double)) : NULL;
 
-    // Llegó a la línea de alto
-    if (V->pos <= 0.0) {
-        if (L->state == GREEN || L->state == YELLOW) {
-            V->crossings = 1;
-            V->finished = true;
-            V->pos = 0.0;
-            return 1;
-        } else { // ROJO: se detiene a cierta distancia antes de la línea
-            V->pos = X->stop_distance;
-            V->waiting = true;
+    int total_crossed = 0;
+    int step = 0;
+    double sim_time = 0.0;
+    int ff_steps = 0;              // pasos aplicados en bloque por el avance rápido
+    double loop_t0 = 0.0, loop_t1 = 0.0; // bucle de pasos (lo que mide --bench)
+    long long vehicle_updates = 0;
+    SnapshotRing ring;             // snapshots: los escribe un hilo aparte
+    Snapshot* snap = NULL;         // búfer del paso que imprime (lo obtiene el hilo maestro)
+    TraceWriter trace;             // traza binaria (--trace): un registro por paso
+    const bool tracing = cfg->trace_path != NULL;
+    const bool snapshots = tracing || print_every > 0;
+    const int snap_every = tracing ? 1 : print_every; // cada cuántos pasos hay snapshot
+
+    // Equipo estable: sin cambios de tamaño por iteración (reduce overhead)
+    omp_set_dynamic(0);
+
+    // Parciales por hilo de cada vuelta, por paridad: lo que un hilo escribe en la vuelta k lo
+    // leen todos tras la barrera de k, y no se vuelve a escribir hasta k+2 (después de la barrera
+    // de k+1). Así la reducción de cruces, la prueba de salida y la racha del avance rápido salen
+    // de una sola barrera por paso.
+    StepPartial* partial = (StepPartial*)arena_alloc(&arena, (size_t)2 * max_threads * sizeof(StepPartial));
+    // Con --time-block, los cruces y detenidos por paso del bloque (misma paridad)
+    TimeBlockPartial* block_partial =
+        blocking ? (TimeBlockPartial*)arena_alloc(&arena, (size_t)2 * max_threads * sizeof(TimeBlockPartial)) : NULL;
+    // Uno por hilo; --metrics publica los tiempos por fase aunque no se imprima la tabla
+    PhaseProfile* profile = (cfg->profile || cfg->metrics_name) ? profile_alloc(max_threads) : NULL;
+    MetricsWriter metrics = {0};
+    if (cfg->metrics_name) metrics_open(&metrics, cfg->metrics_name, "omp", num_vehicles, max_threads);
+    StateVerifier verifier; // --hash-log / --verify-against
+    verify_open(&verifier, cfg);
+    verifier.sparse = verifier.sparse || blocking; // un hash por bloque
+    const bool verifying = verify_active(&verifier);
+    RunStats* stats = counting ? (RunStats*)calloc((size_t)max_threads, sizeof(RunStats)) : NULL; // uno por hilo
+    FILE* stats_out = counting ? stats_open(cfg->stats_path) : NULL;
+    // Modelo básico: variante fijada al empezar, sin eventos (ver traffic_specialize.h)
+    const MoveLanesFn move_lanes = select_move_lanes(false, counting);
+    LaneDemand demand0;      // --actuated: demanda del estado inicial (la toman todos los hilos)
+    ActuatedStats act = {0}; // la del maestro, para el resumen (todos deciden lo mismo)
+    int team_size = 1;
+
+    // Región paralela PERSISTENTE: todos los hilos permanecen vivos durante toda la simulación.
+    // Cada hilo lleva su copia de los semáforos y de los contadores por carril (avanzan igual en
+    // todos), y con schedule(static) sobre los mismos tramos cada hilo mueve siempre los mismos
+    // vehículos: entre pasos solo hay que esperar por las sumas, no por los datos.
+    #pragma omp parallel default(shared)
+    {
+        const int t = omp_get_thread_num();
+        const int nt = omp_get_num_threads();
+
+        // --- Inicialización: primera escritura (first touch) por tramos con el mismo reparto
+        // static que el bucle de movimiento, así cada página queda en el nodo NUMA del hilo que
+        // la va a mover. Solo el orden por carril cruza tramos (un carril por hilo).
+        // Al reanudar o con tabla no hay nada que escribir: las páginas del mapeo se copian al
+        // primer uso (y quedan en el nodo del hilo que las mueve).
+        if (drawing) {
+            #pragma omp for schedule(static)
+            for (int k = 0; k < num_slices; ++k) {
+                draw_vehicle_keys(&V, init_key, cfg->seed, slices[k].begin, slices[k].end);
+            }
+            #pragma omp for schedule(static)
+            for (int l = 0; l < NUM_LANES; ++l) sort_lane_keys(&V, init_key, l);
+            #pragma omp for schedule(static)
+            for (int k = 0; k < num_slices; ++k) fill_vehicles_soa(&V, init_key, slices[k].begin, slices[k].end);
         }
-    }
 
-    if (V->waiting) V->total_wait += dt;
-    return 0;
-}
+        // Resumen de configuración
+        #pragma omp single
+        {
+            free(init_key);
+            if (following) follow_init_tails(&V, slices, num_slices, tail);
+            if (actuated) lane_demand_scan(&V, dt, &demand0);
+            if (resuming) {
+                printf("\nReanudando desde %s: paso %d (t=%.1fs), cruzaron %d/%d\n\n",
+                       cfg->resume_path, P.step, P.sim_time, P.total_crossed, num_vehicles);
+            } else if (!cfg->bench) {
+                if (cfg->scenario_path) print_scenario(cfg, &X);
+                print_configuration(&V, &X);
+            }
+            if (cfg->numa_report) print_numa_placement(&V);
+            fflush(stdout);
+            if (tracing && !trace_open(&trace, cfg->trace_path, cfg, &X, &V)) {
+                fprintf(stderr, "No se pudo crear la traza: %s\n", cfg->trace_path);
+                exit(1);
+            }
+            if (snapshots) {
+                snapshot_ring_start(&ring, num_vehicles, X.num_lights, omp_snapshot_sink, tracing ? &trace : NULL);
+            }
+            if (tracing) { // primer registro: la configuración inicial (o el punto de reanudación)
+                Snapshot* first = snapshot_ring_acquire(&ring);
+                snapshot_store_vehicles(first, &V, 0, num_vehicles);
+                snapshot_store_lights(first, P.step, P.sim_time, &X);
+                first->text = false;
+                snapshot_ring_publish(&ring);
+            }
+        }
 
-// ----------------------- Inicialización -----------------------
-void init_intersection(Intersection* X, int num_lanes) {
-    X->num_lanes = num_lanes;
-    X->num_lights = num_lanes;
-    X->stop_distance = 2.0;
-    X->lights = (TrafficLight*)calloc(X->num_lights, sizeof(TrafficLight));
+        // Copias privadas: semáforos y encabezado de V (los arreglos siguen compartidos)
+        TrafficLight* my_lights = (TrafficLight*)malloc((size_t)X.num_lights * sizeof(TrafficLight));
+        memcpy(my_lights, X.lights, (size_t)X.num_lights * sizeof(TrafficLight));
+        Intersection my_X = X;
+        my_X.lights = my_lights;
+        VehicleSoA lanes = V;
+        LaneMode mode[NUM_LANES];
+        int my_step = P.step, my_crossed = P.total_crossed, my_ff = P.ff_steps;
+        double my_time = P.sim_time;
+        int next_checkpoint = next_checkpoint_step(my_step, cfg->checkpoint_every);
+        long long my_updates = 0;
+        LaneDemand my_demand = demand0; // copia privada, como los semáforos
+        TimeBlock* plan = blocking ? (TimeBlock*)malloc(sizeof(TimeBlock)) : NULL;
+        ActuatedStats my_act = {0};
+        PhaseProfile* prof = profile ? &profile[t] : NULL;
+        RunStats* my_stats = counting ? &stats[t] : NULL;
+        if (prof && cfg->perf_counters) profile_perf_open(prof); // cuenta solo este hilo
 
-    for (int i = 0; i < X->num_lights; ++i) {
-        X->lights[i].id = i;
-        // Tiempos distintos por semáforo (<= 10 s) para ver cambios frecuentes
-        X->lights[i].t_green  = rand_uniform(5.0, 9.0); // 5–9 s
-        X->lights[i].t_yellow = rand_uniform(2.0, 4.0); // 2–4 s
-        X->lights[i].t_red    = rand_uniform(5.0, 9.0); // 5–9 s
-        X->lights[i].state = (i % 2 == 0) ? GREEN : RED;
-        X->lights[i].time_in_state = 0.0;
-    }
-}
+        #pragma omp barrier // con la inicialización terminada en todos los hilos
+        #pragma omp master
+        loop_t0 = omp_get_wtime();
+
+        for (int iter = 0; my_crossed < num_vehicles; ++iter) { // sin vehículos, ningún paso (como traffic_seq)
+            const int p = iter & 1; // paridad por vuelta, no por paso (el avance rápido salta pasos)
+            StepPartial* mine = &partial[p * nt + t];
+            TimeBlockPartial* my_block = blocking ? &block_partial[p * nt + t] : NULL;
+            double tp = profile_start(prof);
+            // Pasos de esta vuelta: uno, o un bloque que termina a lo sumo en el próximo snapshot
+            const int steps = blocking ? time_block_steps(cfg->time_block, my_step, snapshots ? snap_every : 0) : 1;
+
+            // --- Sin sincronizar: semáforos y modo de cada carril (mismo resultado en cada hilo) ---
+            if (blocking) plan_time_block(&my_X, &lanes, dt, steps, plan);
+            else if (actuated) update_actuated_lights(&my_X, dt, cfg, &my_demand, &my_act);
+            else for (int i = 0; i < my_X.num_lights; ++i) update_traffic_light(&my_X.lights[i], dt);
+            lane_modes(&lanes, &my_X, mode);
+            tp = profile_mark(prof, PH_LIGHTS, tp);
+
+            // Si el paso imprime, el maestro pide el búfer ya (solo espera si el anillo está lleno)
+            const bool printing = snapshots && ((my_step + steps) % snap_every) == 0;
+            if (printing) {
+                #pragma omp master
+                snap = snapshot_ring_acquire(&ring);
+                tp = profile_mark(prof, PH_PRINT, tp);
+            }
+
+            // --- Mover mis tramos (trabajo dominante) ---
+            for (int l = 0; l < NUM_LANES; ++l) {
+                mine->crossed[l] = mine->halted[l] = 0;
+                my_updates += (long long)steps * (lanes.lane_end[l] - lanes.lane_begin[l]);
+            }
+            if (actuated) lane_demand_clear(&mine->demand);
+            mine->cross_wait = 0;
+            if (blocking) time_block_clear(my_block, steps);
+            tp = profile_mark(prof, PH_CLEAR, tp);
+            profile_perf_enable(prof);
+            if (blocking) { // cada tramo avanza todo el bloque mientras está en caché
+                #pragma omp for schedule(static) nowait
+                for (int k = 0; k < num_slices; ++k) {
+                    move_lane_slice_time_block(&V, &slices[k], plan, my_X.stop_distance, dt, my_block);
+                }
+            } else if (actuated) { // la demanda de los semáforos sale del mismo recorrido
+                #pragma omp for schedule(static) nowait
+                for (int k = 0; k < num_slices; ++k) {
+                    int l = slices[k].lane, before = mine->crossed[l];
+                    move_lane_slice_actuated(&V, &slices[k], mode[l], my_X.stop_distance, dt, NULL,
+                                             &mine->crossed[l], &mine->halted[l], &mine->demand);
+                    if (counting && mine->crossed[l] > before) {
+                        mine->cross_wait += stats_scan_slice(&V, &slices[k], dt, my_stats);
+                    }
+                }
+            } else if (following) { // lee los tail de la vuelta anterior, escribe los de esta
+                const double* tail_in = &tail[p * max_slices];
+                double* tail_out = &tail[(p ^ 1) * max_slices];
+                #pragma omp for schedule(static) nowait
+                for (int k = 0; k < num_slices; ++k) {
+                    int l = slices[k].lane, before = mine->crossed[l];
+                    move_lane_slice_following(&V, &slices[k], mode[l], my_X.stop_distance, cfg->min_gap, dt,
+                                              follow_slice_lead(slices, k, tail_in), NULL,
+                                              &mine->crossed[l], &mine->halted[l], &tail_out[k]);
+                    if (counting && mine->crossed[l] > before) {
+                        mine->cross_wait += stats_scan_slice(&V, &slices[k], dt, my_stats);
+                    }
+                }
+            } else { // modelo básico: la variante reparte todos los tramos con su omp for interno
+                move_lanes(&V, slices, num_slices, mode, my_X.stop_distance, dt, NULL, my_stats,
+                           mine->crossed, mine->halted, &mine->cross_wait);
+            }
+            profile_perf_disable(prof);
+            tp = profile_mark(prof, PH_MOVE, tp);
+
+            // --- Avance rápido: racha quieta de mis tramos (los semáforos los ve cada hilo) ---
+            int light_quiet = 0;
+            mine->quiet = 0;
+            if (cfg->fast_forward) {
+                light_quiet = quiet_light_steps(&my_X, dt, clamp_quiet_to_print(FF_MAX_STEPS, my_step + 1, snap_every));
+                mine->quiet = light_quiet;
+                if (light_quiet > 0) {
+                    #pragma omp for schedule(static) nowait
+                    for (int k = 0; k < num_slices; ++k) {
+                        int q = quiet_arrival_steps(&V, dt, slices[k].begin, slices[k].end);
+                        if (q < mine->quiet) mine->quiet = q;
+                    }
+                }
+            }
+            tp = profile_mark(prof, PH_OTHER, tp);
+
+            #pragma omp barrier // única sincronización de un paso común
+            tp = profile_mark(prof, PH_BARRIER, tp);
+
+            // --- Cada hilo suma los parciales: cierre del paso, salida y racha quieta ---
+            int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+            int ff_quiet = light_quiet;
+            if (actuated) lane_demand_clear(&my_demand);
+            for (int k = 0; k < nt; ++k) {
+                const StepPartial* q = &partial[p * nt + k];
+                for (int l = 0; l < NUM_LANES; ++l) {
+                    crossed[l] += q->crossed[l];
+                    halted[l] += q->halted[l];
+                }
+                if (q->quiet < ff_quiet) ff_quiet = q->quiet;
+                if (actuated) lane_demand_add(&my_demand, &q->demand); // enteros: mismo total en todos
+            }
+            long long cross_wait = 0; // solo la usa el maestro (fila de --stats)
+            if (counting) {
+                #pragma omp master
+                for (int k = 0; k < nt; ++k) cross_wait += partial[p * nt + k].cross_wait;
+            }
+            if (blocking) {
+                // Cierre de cada paso del bloque; si todos cruzan antes del último, los semáforos
+                // vuelven al plan de ese paso (los vehículos ya no cambian)
+                for (int s = 0; s < steps; ++s) {
+                    int bc[NUM_LANES] = {0}, bh[NUM_LANES] = {0};
+                    for (int k = 0; k < nt; ++k) {
+                        const TimeBlockPartial* q = &block_partial[p * nt + k];
+                        for (int l = 0; l < NUM_LANES; ++l) {
+                            bc[l] += q->crossed[s][l];
+                            bh[l] += q->halted[s][l];
+                        }
+                    }
+                    end_lane_step(&lanes, plan->mode[s], bc, bh);
+                    for (int l = 0; l < NUM_LANES; ++l) my_crossed += bc[l];
+                    my_step += 1;
+                    my_time += dt;
+                    if (my_crossed >= num_vehicles) {
+                        memcpy(my_X.lights, plan->lights[s], NUM_LANES * sizeof(TrafficLight));
+                        break;
+                    }
+                }
+            } else {
+                if (following) end_follow_step(&lanes, mode, crossed, halted); // halted: detenidos
+                else end_lane_step(&lanes, mode, crossed, halted);
+                for (int l = 0; l < NUM_LANES; ++l) my_crossed += crossed[l];
+                my_step += 1;
+                my_time += dt;
+            }
+            if (counting) {
+                #pragma omp master
+                stats_write_step(stats_out, my_step, my_time, crossed, cross_wait, &lanes, dt);
+            }
+            if (verifying) { // hash del paso con los arreglos quietos (single: nadie los toca hasta el final)
+                #pragma omp single
+                verify_step(&verifier, my_step, state_hash(&V, &my_X));
+            }
+            tp = profile_mark(prof, PH_REDUCE, tp);
+
+            if (printing) {
+                // Copia en paralelo por ids (el estado VEH_CROSSED_NOW marca los cruces del paso);
+                // el formato y la escritura quedan para el hilo escritor
+                #pragma omp for schedule(static)
+                for (int b = 0; b < num_vehicles; b += VEH_BLOCK) {
+                    snapshot_store_vehicles(snap, &V, b, (b + VEH_BLOCK < num_vehicles) ? b + VEH_BLOCK : num_vehicles);
+                }
+                #pragma omp master
+                {
+                    snapshot_store_lights(snap, my_step, my_time, &my_X);
+                    snap->text = print_every > 0 && (my_step % print_every) == 0;
+                    snapshot_ring_publish(&ring);
+                }
+                tp = profile_mark(prof, PH_PRINT, tp);
+            }
+
+            if (my_crossed >= num_vehicles) break;
+
+            // Sacar del rango activo a los que ya cruzaron (todos ven la misma condición)
+            if (any_lane_needs_compaction(&lanes)) {
+                #pragma omp single
+                {
+                    maybe_compact_lanes_soa(&lanes);
+                    for (int l = 0; l < NUM_LANES; ++l) V.lane_end[l] = lanes.lane_end[l];
+                    num_slices = build_lane_slices(&V, VEH_BLOCK, slices);
+                    if (following) follow_init_tails(&V, slices, num_slices, &tail[(p ^ 1) * max_slices]);
+                }
+                for (int l = 0; l < NUM_LANES; ++l) lanes.lane_end[l] = V.lane_end[l];
+                tp = profile_mark(prof, PH_COMPACT, tp);
+            }
 
-Vehicle* init_vehicles(int N) {
-    Vehicle* A = (Vehicle*)calloc(N, sizeof(Vehicle));
-    for (int i = 0; i < N; ++i) {
-        A[i].id = i;
-        A[i].lane = i % 4;
-        A[i].pos = rand_uniform(20.0, 200.0);
-        A[i].speed = rand_uniform(6.0, 14.0);
-        A[i].waiting = false;
-        A[i].total_wait = 0.0;
-        A[i].crossings = 0;
-        A[i].finished = false;
+            // --- Avance rápido (opcional): la racha ya está reducida, cada hilo avanza lo suyo ---
+            if (ff_quiet > 0) {
+                #pragma omp for schedule(static) nowait
+                for (int k = 0; k < num_slices; ++k) {
+                    advance_quiet_soa(&V, dt, ff_quiet, slices[k].begin, slices[k].end);
+                }
+                advance_quiet_lights(&my_X, dt, ff_quiet);
+                for (int k = 0; k < ff_quiet; ++k) my_time += dt;
+                for (int l = 0; l < NUM_LANES; ++l) {
+                    my_updates += (long long)ff_quiet * (lanes.lane_end[l] - lanes.lane_begin[l]);
+                }
+                my_step += ff_quiet;
+                my_ff += ff_quiet;
+            }
+
+            // --- Checkpoint periódico: volcado entre pasos con todos los hilos detenidos ---
+            if (cfg->checkpoint_path && my_step >= next_checkpoint) {
+                #pragma omp barrier // terminan los avances en bloque (nowait)
+                #pragma omp single
+                {
+                    SimProgress now = { my_step, my_time, my_crossed, my_ff };
+                    checkpoint_write(cfg->checkpoint_path, cfg, &lanes, &my_X, &now);
+                }
+                next_checkpoint = next_checkpoint_step(my_step, cfg->checkpoint_every);
+            }
+            profile_mark(prof, PH_OTHER, tp);
+
+            // --- Métricas en vivo: cada hilo su línea, el maestro el progreso (solo stores) ---
+            if (metrics.page) {
+                metrics_publish_thread(&metrics, t, prof);
+                #pragma omp master
+                metrics_publish(&metrics, true, my_step, my_time, my_crossed, my_ff, &lanes, prof);
+            }
+        } // fin for(;;)
+        if (prof) profile_perf_close(prof);
+
+        #pragma omp master
+        {
+            loop_t1 = omp_get_wtime();
+            team_size = nt;
+            vehicle_updates = my_updates;
+            act = my_act;
+            memcpy(X.lights, my_lights, (size_t)X.num_lights * sizeof(TrafficLight));
+            for (int l = 0; l < NUM_LANES; ++l) {
+                V.lane_live[l] = lanes.lane_live[l];
+                V.lane_waiting[l] = lanes.lane_waiting[l];
+            }
+            total_crossed = my_crossed;
+            step = my_step;
+            sim_time = my_time;
+            ff_steps = my_ff;
+            if (metrics.page) metrics_publish(&metrics, false, my_step, my_time, my_crossed, my_ff, &lanes, prof);
+        }
+        free(plan);
+        free(my_lights);
+    } // fin región paralela
+
+    if (snapshots) snapshot_ring_finish(&ring); // el wall clock incluye vaciar el anillo
+    if (tracing) trace_close(&trace);
+    double wall_t1 = omp_get_wtime(); // fin medición
+    *result = (SimResult){ step - P.step, loop_t1 - loop_t0, vehicle_updates, false };
+
+    // Métricas finales
+    double avg_wait = 0.0;
+    int total_crossings = 0;
+    for (int id = 0; id < num_vehicles; ++id) { // orden por id: la suma no depende de la compactación
+        int i = V.slot[id];
+        avg_wait += V.total_wait[i];
+        total_crossings += V.crossings[i]; // 0 o 1
+    }
+    avg_wait /= (double)num_vehicles;
+    if (verifying) result->mismatch = !verify_finish(&verifier, step, total_crossed, total_crossings, avg_wait);
+    if (counting) { // los acumulados de los hilos, en orden (enteros)
+        for (int k = 1; k < team_size; ++k) stats_merge(&stats[0], &stats[k]);
+        fclose(stats_out);
     }
-    return A;
-}
 
-// ----------------------- Impresión amigable -----------------------
-void print_configuration(const Vehicle* V, int N, const Intersection* X) {
-    printf("\nResumen de configuración:\n");
-    for (int i = 0; i < N; ++i) {
-        printf("Vehículo %d - Carril: %d, Velocidad: %.2f m/s, Posición inicial: %.2f m\n",
-               V[i].id, V[i].lane, V[i].speed, V[i].pos);
+    if (!cfg->bench) {
+        printf("\n--- Resumen (OpenMP OPTIMIZADO) ---\n");
+        printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
+        printf("Vehículos que cruzaron: %d/%d\n", total_crossed, num_vehicles);
+        printf("Cruces totales por vehículo (suma de V.crossings): %d\n", total_crossings);
+        printf("Espera promedio por vehículo: %.3f s\n", avg_wait);
+        printf("Tiempo total SIMULADO: %.1f s\n", sim_time);
+        if (cfg->fast_forward) printf("Pasos aplicados en bloque (fast-forward): %d\n", ff_steps);
+        if (actuated) print_actuated_stats(cfg, &act);
+        if (blocking) printf("Bloque temporal: hasta %d pasos por recorrido de cada tramo\n", cfg->time_block);
+        if (counting) print_run_stats(&stats[0], cfg->stats_path, dt, sim_time - P.sim_time);
+        if (tracing) printf("Traza binaria: %s (%u registros)\n", cfg->trace_path, trace.header.num_records);
+        if (snapshots && cfg->profile) printf("Esperas por anillo de snapshots lleno: %lld\n", ring.stalls);
+        printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+        if (cfg->huge_pages) print_arena_usage(stdout, &arena);
+        if (cfg->profile) print_profile(profile, team_size, step - P.step, loop_t1 - loop_t0, cfg->perf_counters);
     }
-    for (int i = 0; i < X->num_lights; ++i) {
-        printf("Semáforo %d - Estado inicial: %s, Tiempos: R: %.1fs, V: %.1fs, A: %.1fs\n",
-               i, state_to_str(X->lights[i].state), X->lights[i].t_red, X->lights[i].t_green, X->lights[i].t_yellow);
+
+    metrics_close(&metrics);
+    free(stats);
+    free(profile);
+    if (resuming) {
+        free(X.lights);
+        checkpoint_unmap(&resumed);
     }
-    printf("\n");
+    if (cfg->vehicle_table) checkpoint_unmap(&table);
+    arena_free(&arena);
 }
 
-void print_state(int step, double sim_time, const Vehicle* V, const int* crossed_now, int N, const Intersection* X) {
-    printf("Iteración %d (t=%.1fs):\n", step, sim_time);
-    for (int i = 0; i < N; ++i) {
-        if (crossed_now && crossed_now[i]) {
-            printf("Vehículo %d - Carril: %d, Posición: 0.00 (CRUZÓ en esta iteración)\n",
-                   V[i].id, V[i].lane);
-        } else if (V[i].finished) {
-            printf("Vehículo %d - Carril: %d, Posición: 0.00 (YA CRUZÓ)\n",
-                   V[i].id, V[i].lane);
+// --offload (ver traffic_offload.h): los vehículos se mueven en el dispositivo y el resto del
+// bucle queda en el host, paso a paso como run_simulation (sin avance rápido ni compactación).
+void run_offload_simulation(const SimConfig* cfg, SimResult* result) {
+    const int    num_vehicles = cfg->num_vehicles;
+    const int    print_every  = cfg->print_every;
+    const double dt           = cfg->dt;
+
+    double wall_t0 = omp_get_wtime();
+
+    Intersection X;
+    VehicleSoA V;
+    SimProgress P = {0};
+    CheckpointMapping resumed = {0}; // con --resume, V vive en el mapeo del checkpoint
+    CheckpointMapping table = {0};   // con la tabla del escenario, en el mapeo de la tabla
+    const bool resuming = cfg->resume_path != NULL;
+    Arena arena;
+    arena_init(&arena, resuming ? 0 : intersection_arena_bytes() +
+                                      (cfg->vehicle_table ? 0 : vehicles_arena_bytes(num_vehicles)),
+               cfg->huge_pages);
+    if (resuming) {
+        if (!checkpoint_map(cfg->resume_path, &V, &X, &P, &resumed)) exit(1);
+        printf("\nReanudando desde %s: paso %d (t=%.1fs), cruzaron %d/%d\n\n",
+               cfg->resume_path, P.step, P.sim_time, P.total_crossed, num_vehicles);
+    } else {
+        init_intersection_arena(&X, cfg->seed, &arena);
+        if (cfg->scenario_path) scenario_apply_lights(cfg->scenario_path, &X);
+        if (cfg->vehicle_table) {
+            if (!vehicle_table_map(cfg->vehicle_table, &V, &table)) exit(1);
         } else {
-            printf("Vehículo %d - Carril: %d, Posición: %.2f%s\n",
-                   V[i].id, V[i].lane, V[i].pos, V[i].waiting ? " (ESPERANDO)" : "");
+            alloc_vehicles_soa_arena(&V, num_vehicles, &arena);
+            draw_vehicles_soa(&V, cfg->seed);
         }
+        if (cfg->scenario_path && !cfg->bench) print_scenario(cfg, &X);
+        if (!cfg->bench) print_configuration(&V, &X);
     }
-    for (int i = 0; i < X->num_lights; ++i) {
-        printf("Semáforo %d - Estado: %s, Tiempo en estado: %.1fs\n",
-               i, state_to_str(X->lights[i].state), X->lights[i].time_in_state);
+
+    TraceWriter trace;
+    const bool tracing = cfg->trace_path != NULL;
+    const bool snapshots = tracing || print_every > 0;
+    const int snap_every = tracing ? 1 : print_every;
+    SnapshotRing ring;
+    fflush(stdout);
+    if (tracing && !trace_open(&trace, cfg->trace_path, cfg, &X, &V)) {
+        fprintf(stderr, "No se pudo crear la traza: %s\n", cfg->trace_path);
+        exit(1);
     }
-    printf("\n");
+    if (snapshots) snapshot_ring_start(&ring, num_vehicles, X.num_lights, omp_snapshot_sink, tracing ? &trace : NULL);
+    if (tracing) { // primer registro: la configuración inicial (o el punto de reanudación)
+        Snapshot* first = snapshot_ring_acquire(&ring);
+        snapshot_store_vehicles(first, &V, 0, num_vehicles);
+        snapshot_store_lights(first, P.step, P.sim_time, &X);
+        first->text = false;
+        snapshot_ring_publish(&ring);
+    }
+    StateVerifier verifier;
+    verify_open(&verifier, cfg);
+    const bool verifying = verify_active(&verifier);
+
+    OffloadStats dev = {0};
+    offload_enter(&V, &dev);
+
+    int total_crossed = P.total_crossed;
+    int step = P.step;
+    double sim_time = P.sim_time;
+    int next_checkpoint = next_checkpoint_step(step, cfg->checkpoint_every);
+    long long vehicle_updates = 0;
+    double loop_t0 = omp_get_wtime();
+
+    while (total_crossed < num_vehicles) {
+        // 1) Semáforos y modo de cada carril (host); al dispositivo solo va si cada carril sale
+        for (int i = 0; i < X.num_lights; ++i) update_traffic_light(&X.lights[i], dt);
+        LaneMode mode[NUM_LANES];
+        unsigned char go[NUM_LANES];
+        int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+        lane_modes(&V, &X, mode);
+        for (int l = 0; l < NUM_LANES; ++l) go[l] = mode[l] == LANE_GO;
+
+        // 2) Movimiento en el dispositivo; vuelven los cruces y detenidos por carril
+        offload_move_vehicles(&V, go, X.stop_distance, dt, crossed, halted, &dev);
+        vehicle_updates += num_vehicles;
+        end_lane_step(&V, mode, crossed, halted);
+        for (int l = 0; l < NUM_LANES; ++l) total_crossed += crossed[l];
+        step += 1;
+        sim_time += dt;
+
+        // 3) El estado baja solo si alguien lo mira
+        const bool printing = snapshots && (step % snap_every) == 0;
+        const bool checkpointing = cfg->checkpoint_path && step >= next_checkpoint && total_crossed < num_vehicles;
+        if (verifying || checkpointing) offload_fetch_state(&V, &dev);
+        else if (printing) offload_fetch_snapshot(&V, &dev);
+        if (verifying) verify_step(&verifier, step, state_hash(&V, &X));
+        if (printing) {
+            Snapshot* snap = snapshot_ring_acquire(&ring);
+            snapshot_store_vehicles(snap, &V, 0, num_vehicles);
+            snapshot_store_lights(snap, step, sim_time, &X);
+            snap->text = print_every > 0 && (step % print_every) == 0;
+            snapshot_ring_publish(&ring);
+        }
+        if (checkpointing) {
+            SimProgress now = { step, sim_time, total_crossed, 0 };
+            checkpoint_write(cfg->checkpoint_path, cfg, &V, &X, &now);
+            next_checkpoint = next_checkpoint_step(step, cfg->checkpoint_every);
+        }
+    }
+
+    double loop_t1 = omp_get_wtime();
+    offload_exit(&V, &dev);
+    if (snapshots) snapshot_ring_finish(&ring);
+    if (tracing) trace_close(&trace);
+    double wall_t1 = omp_get_wtime();
+    *result = (SimResult){ step - P.step, loop_t1 - loop_t0, vehicle_updates, false };
+
+    // Métricas finales
+    double avg_wait = 0.0;
+    int total_crossings = 0;
+    for (int id = 0; id < num_vehicles; ++id) {
+        int i = V.slot[id];
+        avg_wait += V.total_wait[i];
+        total_crossings += V.crossings[i];
+    }
+    avg_wait /= (double)num_vehicles;
+    if (verifying) result->mismatch = !verify_finish(&verifier, step, total_crossed, total_crossings, avg_wait);
+
+    if (!cfg->bench) {
+        printf("\n--- Resumen (OpenMP OFFLOAD) ---\n");
+        printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
+        printf("Vehículos que cruzaron: %d/%d\n", total_crossed, num_vehicles);
+        printf("Cruces totales por vehículo (suma de V.crossings): %d\n", total_crossings);
+        printf("Espera promedio por vehículo: %.3f s\n", avg_wait);
+        printf("Tiempo total SIMULADO: %.1f s\n", sim_time);
+        print_offload_stats(&dev);
+        if (tracing) printf("Traza binaria: %s (%u registros)\n", cfg->trace_path, trace.header.num_records);
+        printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+        if (cfg->huge_pages) print_arena_usage(stdout, &arena);
+    }
+
+    if (resuming) {
+        free(X.lights);
+        checkpoint_unmap(&resumed);
+    }
+    if (cfg->vehicle_table) checkpoint_unmap(&table);
+    arena_free(&arena);
 }
 
-// ----------------------- Simulación  -----------------------
-void run_simulation(int num_vehicles, int print_every, double dt, unsigned int seed) {
-    srand(seed);
+// Flujo continuo (ver traffic_stream.h). Mismo esquema de una barrera por paso: cada hilo
+// sortea las llegadas del paso (sale igual en todos) y los tramos cubren la capacidad de cada
+// carril, así una llegada la escribe y la mueve el hilo dueño de su slot. Solo reciclar o
+// agrandar el pool pasa por un single.
+void run_stream_simulation(const SimConfig* cfg) {
+    const int    print_every = cfg->print_every;
+    const double dt          = cfg->dt;
+    const int    total_steps = stream_total_steps(cfg);
 
-    double wall_t0 = omp_get_wtime(); // inicio medición wall-clock de alta precisión
+    double wall_t0 = omp_get_wtime();
 
     Intersection X;
-    init_intersection(&X, 4);
-    Vehicle* V = init_vehicles(num_vehicles);
+    VehicleSoA V;
+    ArrivalSource A;
+    if (!stream_open_source(&A, cfg)) exit(1);
+    init_intersection(&X, NUM_LANES, cfg->seed);
+    stream_init_pool(&V, cfg->num_vehicles);
 
-    // Resumen de configuración
-    print_configuration(V, num_vehicles, &X);
+    // Tramos fijos sobre la capacidad de los carriles; se rearman solo al agrandar el pool
+    LaneSlice* slices = (LaneSlice*)malloc((size_t)(V.n / VEH_BLOCK + NUM_LANES) * sizeof(LaneSlice));
+    int num_slices = stream_build_slices(&V, VEH_BLOCK, slices);
 
-    int total_crossed = 0;
+    StreamStats st = {0}; // crossed_wait y grows los actualiza el single; el resto, el maestro al final
     int step = 0;
     double sim_time = 0.0;
-    int* crossed_now = (int*)calloc(num_vehicles, sizeof(int));
-    int crossed_step = 0;
 
-    // Equipo estable: sin cambios de tamaño por iteración (reduce overhead)
     omp_set_dynamic(0);
+    const int max_threads = omp_get_max_threads();
+    StepPartial* partial = (StepPartial*)aligned_alloc(64, (size_t)2 * max_threads * sizeof(StepPartial));
 
-    // Región paralela PERSISTENTE: todos los hilos permanecen vivos durante toda la simulación.
     #pragma omp parallel default(shared)
     {
-        for (;;) {
+        const int t = omp_get_thread_num();
+        const int nt = omp_get_num_threads();
+
+        TrafficLight* my_lights = (TrafficLight*)malloc((size_t)X.num_lights * sizeof(TrafficLight));
+        memcpy(my_lights, X.lights, (size_t)X.num_lights * sizeof(TrafficLight));
+        Intersection my_X = X;
+        my_X.lights = my_lights;
+        VehicleSoA lanes = V;
+        ArrivalSource my_A = A; // cursor propio en modo archivo
+        StreamStats my_st = {0};
+        StepArrivals arr;
+        long long next_id = 0;
+        LaneMode mode[NUM_LANES];
+        int my_step = 0;
+        double my_time = 0.0;
+
+        // Lugar para las llegadas del primer paso
+        stream_arrivals(&my_A, 1, &next_id, &arr);
+        #pragma omp single
+        {
+            stream_reserve(&lanes, &arr, &st);
+            V = lanes;
+            num_slices = stream_build_slices(&V, VEH_BLOCK, slices);
+        }
+        lanes = V;
 
-            // --- Salida temprana sincronizada ---
-            #pragma omp barrier
-            if (omp_get_thread_num() == 0 && total_crossed >= num_vehicles) {
-                // listo para salir
+        for (int iter = 0;; ++iter) {
+            const int p = iter & 1;
+            StepPartial* mine = &partial[p * nt + t];
+
+            // --- Sin sincronizar: semáforos, llegadas (contadores) y modo de cada carril ---
+            for (int i = 0; i < my_X.num_lights; ++i) update_traffic_light(&my_X.lights[i], dt);
+            int first_slot[NUM_LANES];
+            stream_admit(&lanes, &arr, first_slot);
+            my_st.spawned += arr.total;
+            int in_flight = stream_in_flight(&lanes);
+            if (in_flight > my_st.max_in_flight) my_st.max_in_flight = in_flight;
+            lane_modes(&lanes, &my_X, mode);
+
+            // --- Escribir las llegadas de mis tramos y moverlos ---
+            for (int l = 0; l < NUM_LANES; ++l) mine->crossed[l] = mine->halted[l] = 0;
+            #pragma omp for schedule(static) nowait
+            for (int k = 0; k < num_slices; ++k) {
+                int l = slices[k].lane;
+                stream_spawn(&V, &my_A, &arr, l, first_slot[l], slices[k].begin, slices[k].end);
+                LaneSlice sl = stream_clip_slice(&lanes, slices[k]);
+                move_lane_slice(&V, &sl, mode[l], my_X.stop_distance, dt, NULL,
+                                &mine->crossed[l], &mine->halted[l]);
             }
-            #pragma omp barrier
-            if (total_crossed >= num_vehicles) break;
-
-            // --- Un solo hilo: actualizar semáforos y limpiar eventos ---
-            #pragma omp single
-            {
-                for (int i = 0; i < X.num_lights; ++i) {
-                    update_traffic_light(&X.lights[i], dt); // bucle pequeño: secuencial para evitar overhead
-                }
-                for (int i = 0; i < num_vehicles; ++i) crossed_now[i] = 0;
 
-                crossed_step = 0;
+            #pragma omp barrier // única sincronización de un paso común
+
+            int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+            for (int k = 0; k < nt; ++k) {
+                const StepPartial* q = &partial[p * nt + k];
+                for (int l = 0; l < NUM_LANES; ++l) {
+                    crossed[l] += q->crossed[l];
+                    halted[l] += q->halted[l];
+                }
+            }
+            end_lane_step(&lanes, mode, crossed, halted);
+            for (int l = 0; l < NUM_LANES; ++l) {
+                my_st.lane_crossed[l] += crossed[l];
+                my_st.crossed += crossed[l];
             }
+            my_step += 1;
+            my_time += dt;
 
-            // --- Paralelo: mover vehículos (trabajo dominante) ---
-            #pragma omp for schedule(static) reduction(+:crossed_step)
-            for (int i = 0; i < num_vehicles; ++i) {
-                int c = move_vehicle(&V[i], &X, dt);
-                if (c) crossed_now[i] = 1;
-                crossed_step += c;
+            // Impresión por carril: sale de los contadores privados, sin tocar los arreglos
+            if (print_every > 0 && (my_step % print_every) == 0) {
+                #pragma omp master
+                print_stream_state(my_step, my_time, &lanes, &my_st, &my_X, 1);
             }
 
-            // --- Un solo hilo: acumular totales y snapshot ---
-            #pragma omp single
-            {
-                total_crossed += crossed_step;
-                step += 1;
-                sim_time += dt;
+            if (my_step >= total_steps) break;
 
-                if (print_every > 0 && (step % print_every) == 0) {
-                    print_state(step, sim_time, V, crossed_now, num_vehicles, &X);
-                    // printf("Hilos del equipo: %d\n\n", omp_get_num_threads());
+            // --- Llegadas del próximo paso; si no caben, reciclar o agrandar el pool ---
+            stream_arrivals(&my_A, my_step + 1, &next_id, &arr);
+            if (stream_needs_reserve(&lanes, &arr)) {
+                #pragma omp single
+                {
+                    if (stream_reserve(&lanes, &arr, &st)) {
+                        slices = (LaneSlice*)realloc(slices, (size_t)(lanes.n / VEH_BLOCK + NUM_LANES) * sizeof(LaneSlice));
+                        num_slices = stream_build_slices(&lanes, VEH_BLOCK, slices);
+                    }
+                    V = lanes;
                 }
+                lanes = V;
             }
         } // fin for(;;)
+
+        #pragma omp master
+        {
+            memcpy(X.lights, my_lights, (size_t)X.num_lights * sizeof(TrafficLight));
+            V = lanes;
+            st.spawned = my_st.spawned;
+            st.crossed = my_st.crossed;
+            for (int l = 0; l < NUM_LANES; ++l) st.lane_crossed[l] = my_st.lane_crossed[l];
+            st.max_in_flight = my_st.max_in_flight;
+            step = my_step;
+            sim_time = my_time;
+        }
+        free(my_lights);
     } // fin región paralela
 
-    double wall_t1 = omp_get_wtime(); // fin medición
+    double wall_t1 = omp_get_wtime();
+
+    stream_finish_stats(&V, &st);
+    print_stream_summary("OpenMP OPTIMIZADO", cfg, &V, &st, step, sim_time, 1);
+    printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+
+    free(partial);
+    free(slices);
+    stream_close_source(&A);
+    free(X.lights);
+    free_vehicles_soa(&V);
+}
+
+// ----------------------- Lote de escenarios -----------------------
+// Escenarios con al menos estos vehículos reparten los tramos de cada paso entre los hilos
+// (taskloop); los más chicos corren enteros como una sola tarea.
+#ifndef BATCH_SPLIT_VEHICLES
+#define BATCH_SPLIT_VEHICLES 65536
+#endif
+
+// Lo que un escenario de N vehículos toma de la arena.
+static size_t scenario_arena_bytes(int N) {
+    const int max_slices = N / VEH_BLOCK + NUM_LANES;
+    return intersection_arena_bytes() + vehicles_arena_bytes(N) +
+           arena_bytes((size_t)max_slices, sizeof(LaneSlice)) + arena_bytes((size_t)max_slices * 2, sizeof(int));
+}
+
+// Una corrida completa sin impresión (mismo motor por tramos y misma compactación que
+// run_simulation). Corre dentro de una tarea; si el escenario es grande, cada paso genera una
+// tarea por tramo y los hilos libres se las reparten (los que esperan pueden robarlas).
+// Los búferes salen de la arena del hilo, que se vacía al empezar: cada hilo corre un escenario
+// por vez (la tarea es tied y, mientras espera a su taskloop, el hilo solo toma tareas hijas).
+static void run_scenario(const Scenario* sc, double dt, Arena* arena, ScenarioResult* out) {
+    double t0 = omp_get_wtime();
+
+    Intersection X;
+    VehicleSoA V;
+    arena_reset(arena);
+    init_intersection_arena(&X, sc->seed, arena);
+    if (sc->fixed_lights) {
+        for (int i = 0; i < X.num_lights; ++i) {
+            X.lights[i].t_green = sc->t_green;
+            X.lights[i].t_yellow = sc->t_yellow;
+            X.lights[i].t_red = sc->t_red;
+        }
+    }
+    alloc_vehicles_soa_arena(&V, sc->vehicles, arena);
+    draw_vehicles_soa(&V, sc->seed);
+
+    const bool split = sc->vehicles >= BATCH_SPLIT_VEHICLES;
+    const int max_slices = sc->vehicles / VEH_BLOCK + NUM_LANES;
+    LaneSlice* slices = (LaneSlice*)arena_alloc(arena, (size_t)max_slices * sizeof(LaneSlice));
+    int* slice_crossed = (int*)arena_alloc(arena, (size_t)max_slices * 2 * sizeof(int)); // cruces, detenidos
+    int num_slices = build_lane_slices(&V, VEH_BLOCK, slices);
+
+    int total_crossed = 0, step = 0;
+    double sim_time = 0.0;
+    while (total_crossed < sc->vehicles) {
+        for (int i = 0; i < X.num_lights; ++i) update_traffic_light(&X.lights[i], dt);
+        LaneMode mode[NUM_LANES];
+        lane_modes(&V, &X, mode);
+
+        int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+        if (split) {
+            // Un resultado por tramo (sin reducción entre tareas); taskloop espera a todas
+            #pragma omp taskloop grainsize(1) default(shared)
+            for (int k = 0; k < num_slices; ++k) {
+                int c = 0, h = 0;
+                move_lane_slice(&V, &slices[k], mode[slices[k].lane], X.stop_distance, dt, NULL, &c, &h);
+                slice_crossed[2 * k] = c;
+                slice_crossed[2 * k + 1] = h;
+            }
+            for (int k = 0; k < num_slices; ++k) {
+                crossed[slices[k].lane] += slice_crossed[2 * k];
+                halted[slices[k].lane] += slice_crossed[2 * k + 1];
+            }
+        } else {
+            for (int k = 0; k < num_slices; ++k) {
+                int l = slices[k].lane;
+                move_lane_slice(&V, &slices[k], mode[l], X.stop_distance, dt, NULL, &crossed[l], &halted[l]);
+            }
+        }
+        end_lane_step(&V, mode, crossed, halted);
+        for (int l = 0; l < NUM_LANES; ++l) total_crossed += crossed[l];
+        step += 1;
+        sim_time += dt;
+
+        if (maybe_compact_lanes_soa(&V)) num_slices = build_lane_slices(&V, VEH_BLOCK, slices);
+    }
 
-    // Métricas finales
     double avg_wait = 0.0;
-    int total_crossings = 0;
-    for (int i = 0; i < num_vehicles; ++i) {
-        avg_wait += V[i].total_wait;
-        total_crossings += V[i].crossings; // 0 o 1
+    for (int id = 0; id < sc->vehicles; ++id) avg_wait += V.total_wait[V.slot[id]];
+    avg_wait /= (double)sc->vehicles;
+
+    *out = (ScenarioResult){ step, total_crossed, avg_wait, sim_time, omp_get_wtime() - t0, split };
+}
+
+typedef struct {
+    int vehicles;
+    int index;
+} ScenarioOrder;
+
+static int cmp_scenario_order(const void* a, const void* b) { // grandes primero
+    const ScenarioOrder* x = (const ScenarioOrder*)a;
+    const ScenarioOrder* y = (const ScenarioOrder*)b;
+    if (x->vehicles != y->vehicles) return (x->vehicles < y->vehicles) - (x->vehicles > y->vehicles);
+    return (x->index > y->index) - (x->index < y->index);
+}
+
+// Todos los escenarios de la lista en un mismo equipo: una tarea por escenario, de mayor a
+// menor (los chicos rellenan los huecos del final). La tabla sale en el orden de la lista.
+// Una arena por hilo, del tamaño del escenario más grande, que se reusa en cada escenario: las
+// páginas quedan asignadas de uno al siguiente.
+void run_batch(const SimConfig* cfg) {
+    Scenario* sc = NULL;
+    const int count = load_scenarios(cfg->batch_path, &sc);
+    if (count < 0) exit(1);
+    ScenarioResult* res = (ScenarioResult*)calloc((size_t)(count > 0 ? count : 1), sizeof(ScenarioResult));
+    ScenarioOrder* order = (ScenarioOrder*)malloc((size_t)(count > 0 ? count : 1) * sizeof(ScenarioOrder));
+    for (int k = 0; k < count; ++k) order[k] = (ScenarioOrder){ sc[k].vehicles, k };
+    qsort(order, count, sizeof(ScenarioOrder), cmp_scenario_order);
+
+    omp_set_dynamic(0);
+    const size_t arena_size = scenario_arena_bytes(count > 0 ? order[0].vehicles : 0);
+    Arena* arenas = (Arena*)calloc((size_t)omp_get_max_threads(), sizeof(Arena)); // se reservan al primer uso
+    int team = 1;
+    double wall_t0 = omp_get_wtime();
+    #pragma omp parallel default(shared)
+    {
+        #pragma omp single
+        {
+            team = omp_get_num_threads();
+            for (int k = 0; k < count; ++k) {
+                const int idx = order[k].index;
+                #pragma omp task firstprivate(idx)
+                {
+                    Arena* arena = &arenas[omp_get_thread_num()];
+                    if (!arena->base) arena_init(arena, arena_size, cfg->huge_pages);
+                    run_scenario(&sc[idx], cfg->dt, arena, &res[idx]);
+                }
+            }
+        } // la barrera del single espera todas las tareas
     }
-    avg_wait /= (double)num_vehicles;
+    double wall_t1 = omp_get_wtime();
 
-    printf("\n--- Resumen (OpenMP OPTIMIZADO) ---\n");
-    printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
-    printf("Vehículos que cruzaron: %d/%d\n", total_crossed, num_vehicles);
-    printf("Cruces totales por vehículo (suma de V.crossings): %d\n", total_crossings);
-    printf("Espera promedio por vehículo: %.3f s\n", avg_wait);
-    printf("Tiempo total SIMULADO: %.1f s\n", sim_time);
-    printf("Tiempo de EJECUCIÓN (wall clock): %.6f s\n", wall_t1 - wall_t0);
+    print_batch_table(stdout, sc, res, count);
+    fprintf(stderr, "Lote: %d escenarios con %d hilos en %.3f s (%.1f escenarios/s)\n",
+            count, team, wall_t1 - wall_t0, (wall_t1 > wall_t0) ? count / (wall_t1 - wall_t0) : 0.0);
 
-    free(crossed_now);
-    free(X.lights);
-    free(V);
+    for (int t = 0; t < team; ++t) {
+        if (cfg->huge_pages && arenas[t].base) {
+            fprintf(stderr, "Hilo %d: ", t);
+            print_arena_usage(stderr, &arenas[t]);
+        }
+        arena_free(&arenas[t]);
+    }
+    free(arenas);
+    free(order);
+    free(res);
+    free(sc);
+}
+
+static void bench_set_threads(int threads) {
+    omp_set_num_threads(threads);
 }
 
 int main(int argc, char** argv) {
-    int    N           = (argc > 1) ? atoi(argv[1]) : 200; // vehículos
-    int    print_every = (argc > 2) ? atoi(argv[2]) : 5;   // imprimir cada k pasos (= k segundos)
-    double dt          = 1.0;                              // s
-    unsigned int seed  = (argc > 3) ? (unsigned int)atoi(argv[3]) : (unsigned int)time(NULL);
+    SimConfig cfg; // v: vehículos, t: imprimir cada k pasos (= k segundos), semilla
+    parse_sim_args(argc, argv, &cfg);
+    sim_check_config(&cfg);
+    if (cfg.scenario_path) {
+        scenario_apply_config(cfg.scenario_path, &cfg, "omp");
+        sim_check_config(&cfg); // el motor del escenario puede prender --offload
+    }
+    if (cfg.bench && cfg.offload) { // un solo hilo de host: los hilos no cambian nada
+        const int threads[] = { 1 };
+        run_benchmark(&cfg, "omp-offload", run_offload_simulation, threads, 1, NULL);
+        return 0;
+    }
+    if (cfg.bench) { // hilos 1, 2, 4, ..., máx.
+        int threads[32], num_counts = 0;
+        const int max_threads = omp_get_max_threads();
+        for (int nt = 1; num_counts < 32; nt *= 2) {
+            threads[num_counts++] = (nt < max_threads) ? nt : max_threads;
+            if (nt >= max_threads) break;
+        }
+        run_benchmark(&cfg, "omp", run_simulation, threads, num_counts, bench_set_threads);
+        return 0;
+    }
+    if (cfg.ensemble > 0) {
+        ensemble_check_config(&cfg);
+        run_ensemble(&cfg);
+        return 0;
+    }
+    if (cfg.batch_path) {
+        run_batch(&cfg);
+        return 0;
+    }
+    if (stream_enabled(&cfg)) stream_check_config(&cfg);
+    else if (cfg.resume_path) {
+        checkpoint_apply_config(cfg.resume_path, &cfg);
+        sim_check_config(&cfg); // el checkpoint puede prender --car-following o --actuated
+    }
 
     printf("OpenMP: max threads disponibles: %d\n", omp_get_max_threads());
-    run_simulation(N, print_every, dt, seed);
+    if (stream_enabled(&cfg)) run_stream_simulation(&cfg); // v: capacidad inicial del pool de slots
+    else {
+        SimResult result;
+        if (cfg.offload) run_offload_simulation(&cfg, &result);
+        else run_simulation(&cfg, &result);
+        return result.mismatch ? 2 : 0;
+    }
     return 0;
 }
@@ -0,0 +1,194 @@
+// traffic_profile.h
+// Perfil del bucle de pasos (--profile): tiempo por fase y por hilo, con el desbalance del
+// movimiento entre hilos, y opcionalmente (--perf-counters) contadores de hardware de
+// perf_event alrededor del kernel de movimiento (ciclos, instrucciones, fallos de último nivel
+// de caché). Sirve para saber si una corrida lenta está limitada por memoria, por
+// sincronización o por la impresión sin un perfilador externo.
+// Sin --profile no se llama al reloj: cada marca es una comparación con NULL.
+
+#ifndef TRAFFIC_PROFILE_H
+#define TRAFFIC_PROFILE_H
+
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+
+#include "traffic_core.h"
+
+// Fases de un paso. PH_CLEAR: limpiar eventos / parciales; PH_BARRIER: espera en la barrera
+// del paso (solo OpenMP); PH_OTHER: avance rápido y checkpoints.
+enum {
+    PH_LIGHTS = 0, PH_CLEAR, PH_MOVE, PH_BARRIER, PH_REDUCE, PH_PRINT, PH_COMPACT, PH_OTHER,
+    PH_COUNT
+};
+
+static const char* const PHASE_NAMES[PH_COUNT] = {
+    "semáforos", "limpiar", "mover", "barrera", "reducción", "impresión", "compactación", "otros"
+};
+
+enum { PERF_CYCLES = 0, PERF_INSTRUCTIONS, PERF_LLC_MISSES, PERF_COUNT };
+
+// Un perfil por hilo, alineado para que los hilos no compartan línea de caché.
+typedef struct {
+    _Alignas(64) double phase[PH_COUNT]; // s acumulados
+    int       perf_fd[PERF_COUNT];       // -1 si no hay contador
+    long long perf[PERF_COUNT];
+} PhaseProfile;
+
+// Un perfil por hilo, en cero y sin contadores abiertos.
+static inline PhaseProfile* profile_alloc(int nt) {
+    PhaseProfile* T = (PhaseProfile*)aligned_alloc(64, (size_t)nt * sizeof(PhaseProfile));
+    memset(T, 0, (size_t)nt * sizeof(PhaseProfile));
+    for (int t = 0; t < nt; ++t) {
+        for (int c = 0; c < PERF_COUNT; ++c) T[t].perf_fd[c] = -1;
+    }
+    return T;
+}
+
+static inline double profile_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// Marca de inicio (0 si no se perfila).
+static inline double profile_start(const PhaseProfile* T) {
+    return T ? profile_now() : 0.0;
+}
+
+// Suma a `phase` el tiempo desde `since` y devuelve la nueva marca.
+static inline double profile_mark(PhaseProfile* T, int phase, double since) {
+    if (!T) return 0.0;
+    double now = profile_now();
+    T->phase[phase] += now - since;
+    return now;
+}
+
+// ----------------------- Contadores de hardware -----------------------
+// Abre los contadores del hilo que llama (un grupo: se habilitan y leen juntos). Si el sistema
+// no los permite (perf_event_paranoid, contenedor, otro SO) quedan en -1 y el perfil sigue
+// solo con tiempos.
+static inline void profile_perf_open(PhaseProfile* T) {
+    for (int c = 0; c < PERF_COUNT; ++c) T->perf_fd[c] = -1;
+#ifdef __linux__
+    const unsigned long long config[PERF_COUNT] = {
+        PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES
+    };
+    for (int c = 0; c < PERF_COUNT; ++c) {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = config[c];
+        attr.disabled = (c == 0); // el líder arranca deshabilitado y arrastra al grupo
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        int leader = (c == 0) ? -1 : T->perf_fd[0];
+        if (c > 0 && leader < 0) break;
+        T->perf_fd[c] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    }
+#endif
+}
+
+static inline bool profile_perf_ok(const PhaseProfile* T) {
+    return T && T->perf_fd[0] >= 0;
+}
+
+static inline void profile_perf_enable(PhaseProfile* T) {
+#ifdef __linux__
+    if (profile_perf_ok(T)) ioctl(T->perf_fd[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)T;
+#endif
+}
+
+static inline void profile_perf_disable(PhaseProfile* T) {
+#ifdef __linux__
+    if (profile_perf_ok(T)) ioctl(T->perf_fd[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+#else
+    (void)T;
+#endif
+}
+
+// Lee el grupo y cierra los contadores.
+static inline void profile_perf_close(PhaseProfile* T) {
+#ifdef __linux__
+    if (profile_perf_ok(T)) {
+        unsigned long long buf[1 + PERF_COUNT] = {0}; // nr, valores en orden de apertura
+        if (read(T->perf_fd[0], buf, sizeof(buf)) > 0) {
+            for (unsigned long long c = 0; c < buf[0] && c < PERF_COUNT; ++c) T->perf[c] = (long long)buf[1 + c];
+        }
+    }
+    for (int c = 0; c < PERF_COUNT; ++c) {
+        if (T->perf_fd[c] >= 0) close(T->perf_fd[c]);
+        T->perf_fd[c] = -1;
+    }
+#else
+    (void)T;
+#endif
+}
+
+// ----------------------- Resumen -----------------------
+// Columnas con nombres UTF-8: printf cuenta bytes, no caracteres.
+static inline void print_padded(const char* s, int width) {
+    int chars = 0;
+    for (const char* c = s; *c; ++c) chars += ((*c & 0xC0) != 0x80);
+    printf("%s%*s", s, width > chars ? width - chars : 0, "");
+}
+
+// Tabla de fases (promedio por hilo y porcentaje del bucle), desbalance del movimiento y
+// contadores. T: un perfil por hilo; loop_seconds: duración del bucle de pasos.
+static inline void print_profile(const PhaseProfile* T, int nt, int steps, double loop_seconds, bool perf) {
+    printf("\n--- Perfil por fase (%d pasos, %d hilo(s)) ---\n", steps, nt);
+    printf("%-14s %12s %12s %7s\n", "fase", "s/hilo", "us/paso", "%");
+    for (int ph = 0; ph < PH_COUNT; ++ph) {
+        double sum = 0.0;
+        for (int t = 0; t < nt; ++t) sum += T[t].phase[ph];
+        double avg = sum / nt;
+        print_padded(PHASE_NAMES[ph], 14);
+        printf(" %12.6f %12.3f %6.1f%%\n", avg,
+               steps > 0 ? avg / steps * 1e6 : 0.0, loop_seconds > 0.0 ? 100.0 * avg / loop_seconds : 0.0);
+    }
+
+    if (nt > 1) {
+        double max_move = 0.0, sum_move = 0.0;
+        int slowest = 0;
+        for (int t = 0; t < nt; ++t) {
+            sum_move += T[t].phase[PH_MOVE];
+            if (T[t].phase[PH_MOVE] > max_move) { max_move = T[t].phase[PH_MOVE]; slowest = t; }
+        }
+        printf("Desbalance del movimiento: máx/promedio = %.3f (hilo más lento: %d)\n",
+               sum_move > 0.0 ? max_move * nt / sum_move : 1.0, slowest);
+        printf("%6s %12s %12s\n", "hilo", "mover (s)", "barrera (s)");
+        for (int t = 0; t < nt; ++t) printf("%6d %12.6f %12.6f\n", t, T[t].phase[PH_MOVE], T[t].phase[PH_BARRIER]);
+    }
+
+    if (perf) {
+        long long total[PERF_COUNT] = {0};
+        bool any = false;
+        for (int t = 0; t < nt; ++t) {
+            any |= T[t].perf[PERF_CYCLES] > 0;
+            for (int c = 0; c < PERF_COUNT; ++c) total[c] += T[t].perf[c];
+        }
+        if (!any) {
+            printf("Contadores de hardware: no disponibles (perf_event_open no permitido)\n");
+        } else {
+            // Cada fallo de último nivel trae una línea de 64 bytes: cota inferior del tráfico
+            double bytes = (double)total[PERF_LLC_MISSES] * 64.0;
+            double move = 0.0;
+            for (int t = 0; t < nt; ++t) if (T[t].phase[PH_MOVE] > move) move = T[t].phase[PH_MOVE];
+            printf("Contadores del movimiento (todos los hilos): ciclos %lld, instrucciones %lld (IPC %.2f)\n",
+                   total[PERF_CYCLES], total[PERF_INSTRUCTIONS],
+                   total[PERF_CYCLES] > 0 ? (double)total[PERF_INSTRUCTIONS] / total[PERF_CYCLES] : 0.0);
+            printf("Fallos de último nivel de caché: %lld (~%.1f MB desde memoria, ~%.2f GB/s)\n",
+                   total[PERF_LLC_MISSES], bytes / 1e6, move > 0.0 ? bytes / move / 1e9 : 0.0);
+        }
+    }
+}
+
+#endif // TRAFFIC_PROFILE_H
@@ -0,0 +1,337 @@
+// traffic_scenario.h
+// Escenarios (--scenario archivo, traffic_seq y traffic_omp): la corrida sale de un archivo de
+// texto en lugar de la semilla y los argumentos posicionales, y los vehículos pueden venir de
+// una tabla binaria medida (por ejemplo una demanda real) en lugar de sortearse.
+//
+// Encabezado (texto, una clave por línea, '#' comenta; todas las claves son opcionales):
+//   carriles 4                  tiene que coincidir con NUM_LANES
+//   dt 0.5                      s
+//   distancia_alto 2.0          m, donde se detiene el primero de la cola (2 m sin la clave)
+//   motor omp                   seq, omp u offload (--offload); tiene que ser el del ejecutable
+//   semilla 42                  semáforos no listados y flota sorteada
+//   vehiculos 100000            flota sorteada de ese tamaño (sin tabla)
+//   tabla demanda.veh           tabla binaria de vehículos (relativa al escenario)
+//   semaforo 0 8 3 7 rojo 0     semáforo verde amarillo rojo [estado inicial [s en el estado]]
+// Lo que fija el escenario manda sobre la línea de comandos; el resto de las opciones sigue igual.
+//
+// La tabla tiene exactamente el formato de los arreglos de VehicleSoA: un encabezado en la
+// primera página y cada arreglo alineado a VEHTABLE_ALIGN, ya agrupado por carril y ordenado por
+// distancia (como lo deja draw_vehicles_soa). Se mapea con mmap (MAP_PRIVATE) y los arreglos de V
+// apuntan al mapeo, como al reanudar un checkpoint: no hay lectura ni conversión, 100M de
+// vehículos arrancan en lo que tarda el mmap y cada página se carga recién en el primer paso que
+// la recorre (y su copia queda en el nodo NUMA del hilo que la escribe). Los arreglos del estado
+// (espera, cruces) empiezan en cero y el archivo los guarda como huecos: no ocupan disco.
+// El contenido no se valida (sería leerlo todo): la tabla la escribe scenario_pack.c.
+
+#ifndef TRAFFIC_SCENARIO_H
+#define TRAFFIC_SCENARIO_H
+
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "traffic_core.h"
+#include "traffic_checkpoint.h"
+
+#define VEHTABLE_MAGIC   "TRAFVEH"
+#define VEHTABLE_VERSION 1
+#define VEHTABLE_ALIGN   4096
+
+enum {
+    VT_SLOT = 0, VT_ID, VT_LANE, VT_POS, VT_SPEED, VT_WAITING, VT_FINISHED, VT_TOTAL_WAIT, VT_CROSSINGS,
+    VT_NUM_ARRAYS
+};
+
+// Los primeros VT_INPUT_ARRAYS se escriben; el resto (estado inicial en cero) queda como hueco.
+#define VT_INPUT_ARRAYS VT_WAITING
+
+typedef struct {
+    char     magic[8];                // VEHTABLE_MAGIC (con el '\0')
+    uint32_t version;
+    uint32_t num_arrays;
+    int32_t  num_vehicles;
+    int32_t  flags;                   // CKP_FLAG_COMPACT: precisión de los arreglos
+    int32_t  lane_begin[NUM_LANES + 1];
+    uint64_t offset[VT_NUM_ARRAYS];
+    uint64_t bytes[VT_NUM_ARRAYS];
+} VehicleTableHeader;
+
+// Lo que dice el archivo de escenario (campos sin la clave: 0 / false / "").
+typedef struct {
+    int          lanes;
+    double       dt;
+    double       stop_distance;
+    char         engine[16];
+    bool         has_seed;
+    unsigned int seed;
+    int          vehicles;
+    char         table[4096];           // ruta ya resuelta respecto del escenario
+    bool         has_light[NUM_LANES];
+    TrafficLight light[NUM_LANES];
+} ScenarioSpec;
+
+// ----------------------- Tabla de vehículos -----------------------
+static inline void vehicle_table_arrays(const VehicleSoA* S, const void* ptr[VT_NUM_ARRAYS],
+                                        uint64_t bytes[VT_NUM_ARRAYS]) {
+    const size_t n = (size_t)S->n;
+    ptr[VT_SLOT]       = S->slot;       bytes[VT_SLOT]       = n * sizeof(int);
+    ptr[VT_ID]         = S->id;         bytes[VT_ID]         = n * sizeof(int);
+    ptr[VT_LANE]       = S->lane;       bytes[VT_LANE]       = n * sizeof(lane_t);
+    ptr[VT_POS]        = S->pos;        bytes[VT_POS]        = n * sizeof(real_t);
+    ptr[VT_SPEED]      = S->speed;      bytes[VT_SPEED]      = n * sizeof(real_t);
+    ptr[VT_WAITING]    = S->waiting;    bytes[VT_WAITING]    = n;
+    ptr[VT_FINISHED]   = S->finished;   bytes[VT_FINISHED]   = n;
+    ptr[VT_TOTAL_WAIT] = S->total_wait; bytes[VT_TOTAL_WAIT] = n * sizeof(real_t);
+    ptr[VT_CROSSINGS]  = S->crossings;  bytes[VT_CROSSINGS]  = n * sizeof(cross_t);
+}
+
+// Escribe la tabla de una flota recién armada (estado en cero, lane_begin al día).
+static inline bool vehicle_table_write(const char* path, const VehicleSoA* S) {
+    VehicleTableHeader H = {0};
+    memcpy(H.magic, VEHTABLE_MAGIC, sizeof(VEHTABLE_MAGIC));
+    H.version      = VEHTABLE_VERSION;
+    H.num_arrays   = VT_NUM_ARRAYS;
+    H.num_vehicles = S->n;
+    H.flags        = CKP_STATE_FLAGS;
+    for (int l = 0; l <= NUM_LANES; ++l) H.lane_begin[l] = S->lane_begin[l];
+
+    const void* ptr[VT_NUM_ARRAYS];
+    vehicle_table_arrays(S, ptr, H.bytes);
+    uint64_t off = VEHTABLE_ALIGN; // el encabezado ocupa la primera página
+    for (int a = 0; a < VT_NUM_ARRAYS; ++a) {
+        H.offset[a] = off;
+        off += (H.bytes[a] + VEHTABLE_ALIGN - 1) / VEHTABLE_ALIGN * VEHTABLE_ALIGN;
+    }
+
+    FILE* f = fopen(path, "wb");
+    bool ok = (f != NULL);
+    if (ok) {
+        ok = fwrite(&H, sizeof(H), 1, f) == 1;
+        for (int a = 0; a < VT_INPUT_ARRAYS && ok; ++a) {
+            ok = fseek(f, (long)H.offset[a], SEEK_SET) == 0 &&
+                 fwrite(ptr[a], 1, H.bytes[a], f) == H.bytes[a];
+        }
+        // Largo total múltiplo de página: los arreglos del estado quedan como hueco (ceros)
+        ok = ok && fseek(f, (long)off - 1, SEEK_SET) == 0 && fputc(0, f) != EOF;
+        ok = (fclose(f) == 0) && ok;
+    }
+    if (!ok) fprintf(stderr, "No se pudo escribir la tabla de vehículos: %s\n", path);
+    return ok;
+}
+
+static inline bool vehicle_table_read_header(const char* path, VehicleTableHeader* H) {
+    FILE* f = fopen(path, "rb");
+    bool ok = f && fread(H, sizeof(*H), 1, f) == 1 &&
+              memcmp(H->magic, VEHTABLE_MAGIC, sizeof(VEHTABLE_MAGIC)) == 0 &&
+              H->version == VEHTABLE_VERSION && H->num_arrays == VT_NUM_ARRAYS;
+    if (f) fclose(f);
+    if (!ok) {
+        fprintf(stderr, "Tabla de vehículos inválida o de otra versión: %s\n", path);
+        return false;
+    }
+    if ((H->flags & CKP_FLAG_COMPACT) != CKP_STATE_FLAGS) {
+        fprintf(stderr, "La tabla %s es de la otra precisión del estado (con/sin -DTRAFFIC_COMPACT)\n", path);
+        return false;
+    }
+    // Rangos por carril y largos de los arreglos coherentes con num_vehicles
+    VehicleSoA shape = { .n = H->num_vehicles };
+    const void* ptr[VT_NUM_ARRAYS];
+    uint64_t bytes[VT_NUM_ARRAYS];
+    vehicle_table_arrays(&shape, ptr, bytes);
+    ok = H->num_vehicles > 0 && H->lane_begin[0] == 0 && H->lane_begin[NUM_LANES] == H->num_vehicles;
+    for (int l = 0; l < NUM_LANES; ++l) ok = ok && H->lane_begin[l] <= H->lane_begin[l + 1];
+    for (int a = 0; a < VT_NUM_ARRAYS; ++a) ok = ok && H->bytes[a] == bytes[a] && H->offset[a] % VEHTABLE_ALIGN == 0;
+    if (!ok) fprintf(stderr, "Tabla de vehículos con un encabezado incoherente: %s\n", path);
+    return ok;
+}
+
+// Mapea la tabla: los arreglos de S apuntan al mapeo (se libera con checkpoint_unmap).
+static inline bool vehicle_table_map(const char* path, VehicleSoA* S, CheckpointMapping* M) {
+    VehicleTableHeader H;
+    if (!vehicle_table_read_header(path, &H)) return false;
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) close(fd);
+        fprintf(stderr, "No se pudo abrir la tabla de vehículos: %s\n", path);
+        return false;
+    }
+    for (int a = 0; a < VT_NUM_ARRAYS; ++a) {
+        if (H.offset[a] + H.bytes[a] > (uint64_t)st.st_size) {
+            close(fd);
+            fprintf(stderr, "Tabla de vehículos truncada: %s\n", path);
+            return false;
+        }
+    }
+    M->size = (size_t)st.st_size;
+    M->base = mmap(NULL, M->size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (M->base == MAP_FAILED) {
+        fprintf(stderr, "mmap de la tabla de vehículos falló: %s\n", path);
+        return false;
+    }
+    unsigned char* base = (unsigned char*)M->base;
+
+    S->n = H.num_vehicles;
+    for (int l = 0; l <= NUM_LANES; ++l) S->lane_begin[l] = H.lane_begin[l];
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_end[l] = S->lane_begin[l + 1];
+        S->lane_live[l] = S->lane_end[l] - S->lane_begin[l];
+        S->lane_waiting[l] = 0;
+    }
+    S->slot       = (int*)(base + H.offset[VT_SLOT]);
+    S->id         = (int*)(base + H.offset[VT_ID]);
+    S->lane       = (lane_t*)(base + H.offset[VT_LANE]);
+    S->pos        = (real_t*)(base + H.offset[VT_POS]);
+    S->speed      = (real_t*)(base + H.offset[VT_SPEED]);
+    S->waiting    = base + H.offset[VT_WAITING];
+    S->finished   = base + H.offset[VT_FINISHED];
+    S->total_wait = (real_t*)(base + H.offset[VT_TOTAL_WAIT]);
+    S->crossings  = (cross_t*)(base + H.offset[VT_CROSSINGS]);
+    return true;
+}
+
+// ----------------------- Archivo de escenario -----------------------
+static inline bool scenario_light_state(const char* word, LightState* out) {
+    if (strcmp(word, "verde") == 0)    { *out = GREEN;  return true; }
+    if (strcmp(word, "amarillo") == 0) { *out = YELLOW; return true; }
+    if (strcmp(word, "rojo") == 0)     { *out = RED;    return true; }
+    return false;
+}
+
+// La tabla se busca junto al escenario salvo que la ruta sea absoluta. false si no entra en out.
+static inline bool scenario_resolve(const char* scenario_path, const char* rel, char* out, size_t cap) {
+    const char* slash = strrchr(scenario_path, '/');
+    int len = (rel[0] == '/' || !slash) ? snprintf(out, cap, "%s", rel)
+                                        : snprintf(out, cap, "%.*s/%s", (int)(slash - scenario_path), scenario_path, rel);
+    return len >= 0 && (size_t)len < cap;
+}
+
+// Lee el escenario; false si hay un error (ya informado con archivo:línea).
+static inline bool scenario_read(const char* path, ScenarioSpec* sc) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir el escenario: %s\n", path);
+        return false;
+    }
+    *sc = (ScenarioSpec){0};
+    int line_no = 0;
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        ++line_no;
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+        char key[32], word[4096];
+        if (sscanf(line, "%31s", key) != 1) continue; // línea vacía
+        const char* args = strstr(line, key) + strlen(key);
+        const char* expect = NULL;
+        if (strcmp(key, "carriles") == 0) {
+            if (sscanf(args, "%d", &sc->lanes) != 1 || sc->lanes != NUM_LANES) expect = "carriles 4";
+        } else if (strcmp(key, "dt") == 0) {
+            if (sscanf(args, "%lf", &sc->dt) != 1 || !(sc->dt > 0.0)) expect = "dt S (> 0)";
+        } else if (strcmp(key, "distancia_alto") == 0) {
+            if (sscanf(args, "%lf", &sc->stop_distance) != 1 || !(sc->stop_distance > 0.0)) {
+                expect = "distancia_alto M (> 0)";
+            }
+        } else if (strcmp(key, "motor") == 0) {
+            if (sscanf(args, "%15s", sc->engine) != 1 ||
+                (strcmp(sc->engine, "seq") != 0 && strcmp(sc->engine, "omp") != 0 && strcmp(sc->engine, "offload") != 0)) {
+                expect = "motor seq|omp|offload";
+            }
+        } else if (strcmp(key, "semilla") == 0) {
+            long long seed;
+            if (sscanf(args, "%lld", &seed) != 1 || seed < 0) expect = "semilla S (>= 0)";
+            sc->seed = (unsigned int)seed;
+            sc->has_seed = true;
+        } else if (strcmp(key, "vehiculos") == 0) {
+            if (sscanf(args, "%d", &sc->vehicles) != 1 || sc->vehicles < 1) expect = "vehiculos N (> 0)";
+        } else if (strcmp(key, "tabla") == 0) {
+            if (sscanf(args, "%4095s", word) != 1 || !scenario_resolve(path, word, sc->table, sizeof(sc->table))) {
+                expect = "tabla archivo";
+            }
+        } else if (strcmp(key, "semaforo") == 0) {
+            TrafficLight L = {0};
+            char state[16] = "";
+            int got = sscanf(args, "%d %lf %lf %lf %15s %lf", &L.id, &L.t_green, &L.t_yellow, &L.t_red, state,
+                             &L.time_in_state);
+            bool ok = got >= 4 && L.id >= 0 && L.id < NUM_LANES &&
+                      L.t_green > 0.0 && L.t_yellow > 0.0 && L.t_red > 0.0 &&
+                      L.t_green <= 10.0 && L.t_yellow <= 10.0 && L.t_red <= 10.0;
+            // Sin estado, el alternado de setup_intersection
+            L.state = (L.id % 2 == 0) ? GREEN : RED;
+            if (got >= 5) ok = ok && scenario_light_state(state, &L.state);
+            if (got == 6) ok = ok && L.time_in_state >= 0.0;
+            if (ok) {
+                sc->light[L.id] = L;
+                sc->has_light[L.id] = true;
+            } else {
+                expect = "semaforo I verde amarillo rojo [verde|amarillo|rojo [s]] (I en 0..3, tiempos en (0, 10] s)";
+            }
+        } else {
+            fprintf(stderr, "%s:%d: clave desconocida: %s\n", path, line_no, key);
+            fclose(f);
+            return false;
+        }
+        if (expect) {
+            fprintf(stderr, "%s:%d: se espera \"%s\"\n", path, line_no, expect);
+            fclose(f);
+            return false;
+        }
+    }
+    fclose(f);
+    return true;
+}
+
+// Toma del escenario dt, semilla, vehículos y motor (engine: "seq" / "omp", el del ejecutable;
+// "offload" en traffic_omp prende --offload). Con tabla, los vehículos son los de su encabezado
+// y cfg->vehicle_table queda apuntando a ella.
+static inline void scenario_apply_config(const char* path, SimConfig* cfg, const char* engine) {
+    ScenarioSpec sc;
+    if (!scenario_read(path, &sc)) exit(1);
+    bool offload = strcmp(sc.engine, "offload") == 0;
+    if (sc.engine[0] && strcmp(sc.engine, engine) != 0 && !(offload && strcmp(engine, "omp") == 0)) {
+        fprintf(stderr, "El escenario %s es para el motor %s (traffic_%s)\n", path, sc.engine,
+                offload ? "omp" : sc.engine);
+        exit(1);
+    }
+    if (offload) cfg->offload = true;
+    if (sc.dt > 0.0) cfg->dt = sc.dt;
+    if (sc.has_seed) cfg->seed = sc.seed;
+    if (sc.vehicles > 0) cfg->num_vehicles = sc.vehicles;
+    if (sc.table[0]) {
+        VehicleTableHeader H;
+        if (!vehicle_table_read_header(sc.table, &H)) exit(1);
+        if (sc.vehicles > 0 && sc.vehicles != H.num_vehicles) {
+            fprintf(stderr, "El escenario %s pide %d vehículos y la tabla %s tiene %d\n", path, sc.vehicles,
+                    sc.table, H.num_vehicles);
+            exit(1);
+        }
+        cfg->num_vehicles = H.num_vehicles;
+        cfg->vehicle_table = strdup(sc.table); // dura toda la corrida
+    }
+    double stop = sc.stop_distance > 0.0 ? sc.stop_distance : 2.0;
+    if (cfg->car_following && !(cfg->min_gap > stop)) {
+        fprintf(stderr, "Distancia mínima inválida: %.2f (m, > distancia_alto = %.2f)\n", cfg->min_gap, stop);
+        exit(1);
+    }
+}
+
+// Semáforos y distancia de alto del escenario sobre X (ya armada con la semilla).
+static inline void scenario_apply_lights(const char* path, Intersection* X) {
+    ScenarioSpec sc;
+    if (!scenario_read(path, &sc)) exit(1);
+    if (sc.stop_distance > 0.0) X->stop_distance = sc.stop_distance;
+    for (int i = 0; i < X->num_lights && i < NUM_LANES; ++i) {
+        if (sc.has_light[i]) X->lights[i] = sc.light[i];
+    }
+}
+
+static inline void print_scenario(const SimConfig* cfg, const Intersection* X) {
+    printf("Escenario: %s (dt=%.3f s, distancia de alto %.2f m", cfg->scenario_path, cfg->dt, X->stop_distance);
+    if (cfg->vehicle_table) printf(", %d vehículos mapeados de %s)\n", cfg->num_vehicles, cfg->vehicle_table);
+    else printf(", %d vehículos sorteados con semilla %u)\n", cfg->num_vehicles, cfg->seed);
+}
+
+#endif // TRAFFIC_SCENARIO_H
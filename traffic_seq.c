@@ -1,6 +1,8 @@
 // traffic_seq.c
 // Simulación de tráfico con semáforos y vehículos (Versión Secuencial)
 
+#define _GNU_SOURCE // clock_gettime() y syscall(): perfil por fase y contadores perf_event
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
@@ -8,150 +10,35 @@
 #include <math.h>
 #include <sys/time.h> // para medir wall-clock
 
-typedef enum { RED = 0, GREEN = 1, YELLOW = 2 } LightState;
-
-// ----------------------- Estructuras -----------------------
-typedef struct {
-    int        id;
-    LightState state;
-    double     time_in_state; // segundos en el estado actual
-    double     t_green;       // duración de verde (<= 10 s)
-    double     t_yellow;      // duración de amarillo (<= 10 s)
-    double     t_red;         // duración de rojo (<= 10 s)
-} TrafficLight;
-
-typedef struct {
-    int    id;
-    int    lane;           // 0..3 (N, E, S, O)
-    double pos;            // distancia a la línea de alto (m)
-    double speed;          // m/s
-    bool   waiting;        // está detenido esperando luz
-    double total_wait;     // s acumulados esperando
-    int    crossings;      // 0 o 1 (cruzó)
-    bool   finished;       // true cuando ya cruzó
-} Vehicle;
-
-typedef struct {
-    int           num_lanes;
-    int           num_lights;
-    double        stop_distance;
-    TrafficLight* lights;
-} Intersection;
+#include "traffic_core.h"
+#include "traffic_arena.h"
+#include "traffic_checkpoint.h"
+#include "traffic_stream.h"
+#include "traffic_bench.h"
+#include "traffic_profile.h"
+#include "traffic_verify.h"
+#include "traffic_ensemble.h"
+#include "traffic_follow.h"
+#include "traffic_actuated.h"
+#include "traffic_stats.h"
+#include "traffic_metrics.h"
+#include "traffic_scenario.h"
+#include "traffic_specialize.h"
 
 // ----------------------- Utilidades -----------------------
-static inline double rand_uniform(double a, double b) { return a + (b - a) * (rand() / (double)RAND_MAX); }
-
-static inline const char* state_to_str(LightState s) {
-    return (s == GREEN) ? "V" : (s == YELLOW ? "A" : "R");
-}
-
 static inline double now_seconds() {
     struct timeval tv;
     gettimeofday(&tv, NULL);
     return (double)tv.tv_sec + (double)tv.tv_usec / 1e6;
 }
 
-// ----------------------- Semáforos -----------------------
-void update_traffic_light(TrafficLight* L, double dt) {
-    L->time_in_state += dt;
-    switch (L->state) {
-        case GREEN:
-            if (L->time_in_state >= L->t_green) {
-                L->state = YELLOW;
-                L->time_in_state = 0.0;
-            }
-            break;
-        case YELLOW:
-            if (L->time_in_state >= L->t_yellow) {
-                L->state = RED;
-                L->time_in_state = 0.0;
-            }
-            break;
-        case RED:
-        default:
-            if (L->time_in_state >= L->t_red) {
-                L->state = GREEN;
-                L->time_in_state = 0.0;
-            }
-            break;
-    }
-}
-
-// ----------------------- Vehículos -----------------------
-// Devuelve 1 si el vehículo cruzó en este paso; 0 si no.
-int move_vehicle(Vehicle* V, const Intersection* X, double dt) {
-    if (V->finished) return 0; // ya cruzó antes
-
-    TrafficLight* L = &X->lights[V->lane];
-
-    // Si está esperando y la luz permite, sale
-    if (V->waiting && (L->state == GREEN || L->state == YELLOW)) {
-        V->waiting = false;
-    }
-
-    // Avance simple si no espera
-    if (!V->waiting) {
-        V->pos -= V->speed * dt;
-    }
-
-    // Llegó a la línea de alto
-    if (V->pos <= 0.0) {
-        if (L->state == GREEN || L->state == YELLOW) {
-            // Cruza: el vehículo finaliza su participación
-            V->crossings = 1;
-            V->finished = true;
-            V->pos = 0.0;
-            return 1;
-        } else { // ROJO: se detiene a cierta distancia antes de la línea
-            V->pos = X->stop_distance;
-            V->waiting = true;
-        }
-    }
-
-    if (V->waiting) V->total_wait += dt;
-    return 0;
-}
-
-// ----------------------- Inicialización  -----------------------
-void init_intersection(Intersection* X, int num_lanes) {
-    X->num_lanes = num_lanes;
-    X->num_lights = num_lanes;
-    X->stop_distance = 2.0;
-    X->lights = (TrafficLight*)calloc(X->num_lights, sizeof(TrafficLight));
-
-    for (int i = 0; i < X->num_lights; ++i) {
-        X->lights[i].id = i;
-        // Tiempos DIFERENTES por semáforo
-        X->lights[i].t_green  = rand_uniform(5.0, 9.0); // 5–9 s
-        X->lights[i].t_yellow = rand_uniform(2.0, 4.0); // 2–4 s
-        X->lights[i].t_red    = rand_uniform(5.0, 9.0); // 5–9 s
-        // Estado inicial alternado para variedad
-        X->lights[i].state = (i % 2 == 0) ? GREEN : RED;
-        X->lights[i].time_in_state = 0.0;
-    }
-}
-
-Vehicle* init_vehicles(int N) {
-    Vehicle* A = (Vehicle*)calloc(N, sizeof(Vehicle));
-    for (int i = 0; i < N; ++i) {
-        A[i].id = i;
-        A[i].lane = i % 4;
-        A[i].pos = rand_uniform(20.0, 200.0);
-        A[i].speed = rand_uniform(6.0, 14.0);
-        A[i].waiting = false;
-        A[i].total_wait = 0.0;
-        A[i].crossings = 0;
-        A[i].finished = false;
-    }
-    return A;
-}
-
 // ----------------------- Impresión amigable -----------------------
-void print_configuration(const Vehicle* V, int N, const Intersection* X) {
+void print_configuration(const VehicleSoA* V, const Intersection* X) {
     printf("\nResumen de configuración:\n");
-    for (int i = 0; i < N; ++i) {
+    for (int id = 0; id < V->n; ++id) {
+        int i = V->slot[id];
         printf("Vehículo %d - Carril: %d, Velocidad: %.2f m/s, Posición inicial: %.2f m\n",
-               V[i].id, V[i].lane, V[i].speed, V[i].pos);
+               id, V->lane[i], V->speed[i], V->pos[i]);
     }
     for (int i = 0; i < X->num_lights; ++i) {
         printf("Semáforo %d - Estado inicial: %s, Tiempos: R: %.0fs, V: %.0fs, A: %.0fs\n",
@@ -160,18 +47,23 @@ void print_configuration(const Vehicle* V, int N, const Intersection* X) {
     printf("\n");
 }
 
-void print_state(int step, double sim_time, const Vehicle* V, const int* crossed_now, int N, const Intersection* X) {
+// crossed: ids que cruzaron en esta iteración (se ordenan aquí para recorrerlos junto con los ids)
+void print_state(int step, double sim_time, const VehicleSoA* V, EventBuffer* crossed, const Intersection* X) {
     printf("Iteración %d (t=%.0fs):\n", step, sim_time);
-    for (int i = 0; i < N; ++i) {
-        if (crossed_now && crossed_now[i]) {
+    qsort(crossed->ids, crossed->count, sizeof(int), cmp_int);
+    int k = 0;
+    for (int id = 0; id < V->n; ++id) {
+        int i = V->slot[id];
+        if (k < crossed->count && crossed->ids[k] == id) {
+            ++k;
             printf("Vehículo %d - Carril: %d, Posición: 0 (CRUZÓ en esta iteración)\n",
-                   V[i].id, V[i].lane);
-        } else if (V[i].finished) {
+                   id, V->lane[i]);
+        } else if (V->finished[i]) {
             printf("Vehículo %d - Carril: %d, Posición: 0 (YA CRUZÓ)\n",
-                   V[i].id, V[i].lane);
+                   id, V->lane[i]);
         } else {
             printf("Vehículo %d - Carril: %d, Posición: %.2f%s\n",
-                   V[i].id, V[i].lane, V[i].pos, V[i].waiting ? " (ESPERANDO)" : "");
+                   id, V->lane[i], V->pos[i], V->waiting[i] ? " (ESPERANDO)" : "");
         }
     }
     for (int i = 0; i < X->num_lights; ++i) {
@@ -182,80 +74,316 @@ void print_state(int step, double sim_time, const Vehicle* V, const int* crossed
 }
 
 // ----------------------- Simulación -----------------------
-void run_simulation(int num_vehicles, int print_every, double dt, unsigned int seed) {
-    srand(seed);
+// Con cfg->bench no imprime nada: solo deja en result los pasos y el tiempo del bucle.
+void run_simulation(const SimConfig* cfg, SimResult* result) {
+    const int    num_vehicles = cfg->num_vehicles;
+    const int    print_every  = cfg->print_every;
+    const double dt           = cfg->dt;
 
     double wall_t0 = now_seconds(); // inicio medición de ejecución
 
     Intersection X;
-    init_intersection(&X, 4);
-    Vehicle* V = init_vehicles(num_vehicles);
+    VehicleSoA V;
+    SimProgress P = {0};
+    CheckpointMapping resumed = {0}; // con --resume, V vive en el mapeo del checkpoint
+    CheckpointMapping table = {0};   // con la tabla del escenario, en el mapeo de la tabla
+    // Semáforos, vehículos (al reanudar o con tabla están en el mapeo) y eventos en una arena
+    Arena arena;
+    size_t arena_size = arena_bytes((size_t)num_vehicles, sizeof(int));
+    if (!cfg->resume_path) arena_size += intersection_arena_bytes();
+    if (!cfg->resume_path && !cfg->vehicle_table) arena_size += vehicles_arena_bytes(num_vehicles);
+    arena_init(&arena, arena_size, cfg->huge_pages);
+    if (cfg->resume_path) {
+        if (!checkpoint_map(cfg->resume_path, &V, &X, &P, &resumed)) exit(1);
+        printf("\nReanudando desde %s: paso %d (t=%.0fs), cruzaron %d/%d\n\n",
+               cfg->resume_path, P.step, P.sim_time, P.total_crossed, num_vehicles);
+    } else {
+        init_intersection_arena(&X, cfg->seed, &arena);
+        if (cfg->scenario_path) scenario_apply_lights(cfg->scenario_path, &X);
+        if (cfg->vehicle_table) {
+            if (!vehicle_table_map(cfg->vehicle_table, &V, &table)) exit(1);
+        } else {
+            alloc_vehicles_soa_arena(&V, num_vehicles, &arena);
+            draw_vehicles_soa(&V, cfg->seed);
+        }
+        if (cfg->scenario_path && !cfg->bench) print_scenario(cfg, &X);
 
-    // Mostrar resumen de configuración
-    print_configuration(V, num_vehicles, &X);
+        // Mostrar resumen de configuración
+        if (!cfg->bench) print_configuration(&V, &X);
+    }
 
-    int total_crossed = 0;
-    int* crossed_now = (int*)calloc(num_vehicles, sizeof(int));
-    int step = 0;
-    double sim_time = 0.0;
+    int total_crossed = P.total_crossed;
+    EventBuffer crossed_now; // ids que cruzaron en la iteración actual (a lo sumo todos)
+    event_buffer_arena(&crossed_now, num_vehicles, &arena);
+    int step = P.step;
+    double sim_time = P.sim_time;
+    int ff_steps = P.ff_steps; // pasos aplicados en bloque por el avance rápido
+    int next_checkpoint = next_checkpoint_step(step, cfg->checkpoint_every);
+    long long vehicle_updates = 0; // slots recorridos por el kernel
+    StateVerifier verifier;
+    verify_open(&verifier, cfg);
+    LaneDemand demand; // --actuated: demanda de cada carril al terminar el paso anterior
+    ActuatedStats act = {0};
+    if (cfg->actuated) lane_demand_scan(&V, dt, &demand);
+    RunStats* stats = cfg->stats_path ? (RunStats*)calloc(1, sizeof(RunStats)) : NULL; // --stats
+    FILE* stats_out = stats ? stats_open(cfg->stats_path) : NULL;
+    // NULL = sin perfil; --metrics publica los tiempos por fase aunque no se imprima la tabla
+    PhaseProfile* prof = (cfg->profile || cfg->metrics_name) ? profile_alloc(1) : NULL;
+    MetricsWriter metrics = {0};
+    if (cfg->metrics_name) metrics_open(&metrics, cfg->metrics_name, "seq", num_vehicles, 1);
+    if (prof && cfg->perf_counters) profile_perf_open(prof);
+    // Modelo básico: variantes fijadas al empezar, con y sin eventos (ver traffic_specialize.h)
+    const bool plain_model = !cfg->actuated && !cfg->car_following;
+    const MoveLanesFn move_lanes = select_move_lanes(false, stats != NULL);
+    const MoveLanesFn move_lanes_print = select_move_lanes(true, stats != NULL);
+    double loop_t0 = now_seconds();
 
     // Bucle sin duración predefinida: termina cuando todos cruzan
     while (total_crossed < num_vehicles) {
+        double tp = profile_start(prof);
+
         // 1) Actualizar semáforos
-        for (int i = 0; i < X.num_lights; ++i) {
-            update_traffic_light(&X.lights[i], dt);
+        if (cfg->actuated) {
+            update_actuated_lights(&X, dt, cfg, &demand, &act);
+        } else {
+            for (int i = 0; i < X.num_lights; ++i) {
+                update_traffic_light(&X.lights[i], dt);
+            }
         }
-
-        // 2) Limpiar eventos de cruce de esta iteración
-        for (int i = 0; i < num_vehicles; ++i) crossed_now[i] = 0;
-
-        // 3) Mover vehículos
-        int crossed_step = 0;
-        for (int i = 0; i < num_vehicles; ++i) {
-            int c = move_vehicle(&V[i], &X, dt);
-            if (c) { crossed_now[i] = 1; crossed_step += 1; }
+        tp = profile_mark(prof, PH_LIGHTS, tp);
+
+        // 2) Mover vehículos que siguen en ruta, carril por carril; en los pasos que imprimen,
+        // los cruces quedan como eventos
+        const bool printing = print_every > 0 && ((step + 1) % print_every) == 0;
+        EventBuffer* events = printing ? &crossed_now : NULL;
+        LaneMode mode[NUM_LANES];
+        LaneSlice lanes[NUM_LANES]; // un tramo por carril
+        int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+        lane_modes(&V, &X, mode);
+        crossed_now.count = 0;
+        if (cfg->actuated) lane_demand_clear(&demand);
+        long long cross_wait = 0; // --stats: espera de los que cruzan en este paso, en pasos
+        for (int l = 0; l < NUM_LANES; ++l) {
+            lanes[l] = (LaneSlice){ l, V.lane_begin[l], V.lane_end[l] };
+            vehicle_updates += lanes[l].end - lanes[l].begin;
         }
-        total_crossed += crossed_step;
+        tp = profile_mark(prof, PH_CLEAR, tp);
+        profile_perf_enable(prof);
+        if (plain_model) {
+            (printing ? move_lanes_print : move_lanes)(&V, lanes, NUM_LANES, mode, X.stop_distance, dt, events,
+                                                       stats, crossed, halted, &cross_wait);
+        } else {
+            for (int l = 0; l < NUM_LANES; ++l) {
+                if (cfg->actuated) { // la demanda para los semáforos sale del mismo recorrido
+                    move_lane_slice_actuated(&V, &lanes[l], mode[l], X.stop_distance, dt, events,
+                                             &crossed[l], &halted[l], &demand);
+                } else { // un tramo por carril: el primero no tiene líder
+                    double tail;
+                    move_lane_slice_following(&V, &lanes[l], mode[l], X.stop_distance, cfg->min_gap, dt,
+                                              FOLLOW_NO_LEADER, events, &crossed[l], &halted[l], &tail);
+                }
+                if (stats && crossed[l] > 0) cross_wait += stats_scan_slice(&V, &lanes[l], dt, stats);
+            }
+        }
+        profile_perf_disable(prof);
+        tp = profile_mark(prof, PH_MOVE, tp);
+        if (cfg->car_following) end_follow_step(&V, mode, crossed, halted); // halted: detenidos
+        else end_lane_step(&V, mode, crossed, halted);
+        for (int l = 0; l < NUM_LANES; ++l) total_crossed += crossed[l];
 
         step += 1;
         sim_time += dt;
+        if (verify_active(&verifier)) verify_step(&verifier, step, state_hash(&V, &X));
+        if (stats) stats_write_step(stats_out, step, sim_time, crossed, cross_wait, &V, dt);
+        tp = profile_mark(prof, PH_REDUCE, tp);
 
-        // 4) Impresión según intervalo
-        if (print_every > 0 && (step % print_every) == 0) {
-            print_state(step, sim_time, V, crossed_now, num_vehicles, &X);
+        // 3) Impresión según intervalo
+        if (printing) {
+            print_state(step, sim_time, &V, &crossed_now, &X);
+        }
+        tp = profile_mark(prof, PH_PRINT, tp);
+
+        // 4) Sacar del rango activo a los que ya cruzaron
+        maybe_compact_lanes_soa(&V);
+        tp = profile_mark(prof, PH_COMPACT, tp);
+
+        // 5) Avance rápido: aplicar de una vez la racha de pasos sin eventos
+        if (cfg->fast_forward && total_crossed < num_vehicles) {
+            int quiet = quiet_steps(&V, &X, dt, step, print_every);
+            if (quiet > 0) {
+                for (int l = 0; l < NUM_LANES; ++l) {
+                    advance_quiet_soa(&V, dt, quiet, V.lane_begin[l], V.lane_end[l]);
+                    vehicle_updates += (long long)quiet * (V.lane_end[l] - V.lane_begin[l]);
+                }
+                advance_quiet_lights(&X, dt, quiet);
+                for (int k = 0; k < quiet; ++k) sim_time += dt;
+                step += quiet;
+                ff_steps += quiet;
+            }
+        }
+
+        // 6) Checkpoint periódico (entre pasos: el estado está completo)
+        if (cfg->checkpoint_path && step >= next_checkpoint && total_crossed < num_vehicles) {
+            SimProgress now = { step, sim_time, total_crossed, ff_steps };
+            checkpoint_write(cfg->checkpoint_path, cfg, &V, &X, &now);
+            next_checkpoint = next_checkpoint_step(step, cfg->checkpoint_every);
+        }
+        profile_mark(prof, PH_OTHER, tp);
+
+        // 7) Métricas en vivo (stores en la página compartida, sin llamadas al sistema)
+        if (metrics.page) {
+            metrics_publish_thread(&metrics, 0, prof);
+            metrics_publish(&metrics, true, step, sim_time, total_crossed, ff_steps, &V, prof);
         }
     }
 
     double wall_t1 = now_seconds(); // fin medición de ejecución
+    if (prof) profile_perf_close(prof); // lee los contadores
+    if (metrics.page) metrics_publish(&metrics, false, step, sim_time, total_crossed, ff_steps, &V, prof);
+    *result = (SimResult){ step - P.step, wall_t1 - loop_t0, vehicle_updates, false };
 
     // Métricas finales
     double avg_wait = 0.0;
     int total_crossings = 0;
-    for (int i = 0; i < num_vehicles; ++i) {
-        avg_wait += V[i].total_wait;
-        total_crossings += V[i].crossings; // 0 o 1
+    for (int id = 0; id < num_vehicles; ++id) { // orden por id: la suma no depende de la compactación
+        int i = V.slot[id];
+        avg_wait += V.total_wait[i];
+        total_crossings += V.crossings[i]; // 0 o 1
     }
     avg_wait /= (double)num_vehicles;
+    if (verify_active(&verifier)) {
+        result->mismatch = !verify_finish(&verifier, step, total_crossed, total_crossings, avg_wait);
+    }
+
+    if (!cfg->bench) {
+        printf("\n--- Resumen (Secuencial) ---\n");
+        printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
+        printf("Vehículos que cruzaron: %d/%d\n", total_crossed, num_vehicles);
+        printf("Cruces totales por vehículo (suma de V.crossings): %d\n", total_crossings);
+        printf("Espera promedio por vehículo: %.2f s\n", avg_wait);
+        printf("Tiempo total SIMULADO: %.0f s\n", sim_time);
+        if (cfg->fast_forward) printf("Pasos aplicados en bloque (fast-forward): %d\n", ff_steps);
+        if (cfg->actuated) print_actuated_stats(cfg, &act);
+        if (stats) print_run_stats(stats, cfg->stats_path, dt, sim_time - P.sim_time);
+        printf("Tiempo de EJECUCIÓN (wall clock): %.3f s\n", wall_t1 - wall_t0);
+        if (cfg->huge_pages) print_arena_usage(stdout, &arena);
+        if (cfg->profile) print_profile(prof, 1, step - P.step, wall_t1 - loop_t0, cfg->perf_counters);
+    }
+
+    metrics_close(&metrics);
+    if (stats_out) fclose(stats_out);
+    free(stats);
+    free(prof);
+    if (cfg->resume_path) {
+        free(X.lights);
+        checkpoint_unmap(&resumed);
+    }
+    if (cfg->vehicle_table) checkpoint_unmap(&table);
+    arena_free(&arena);
+}
+
+// Flujo continuo: llegadas por carril durante cfg->duration segundos (ver traffic_stream.h).
+void run_stream_simulation(const SimConfig* cfg) {
+    const int    print_every = cfg->print_every;
+    const double dt          = cfg->dt;
+    const int    total_steps = stream_total_steps(cfg);
+
+    double wall_t0 = now_seconds();
+
+    Intersection X;
+    VehicleSoA V;
+    ArrivalSource A;
+    if (!stream_open_source(&A, cfg)) exit(1);
+    init_intersection(&X, NUM_LANES, cfg->seed);
+    stream_init_pool(&V, cfg->num_vehicles);
+
+    StreamStats st = {0};
+    StepArrivals arr;
+    long long next_id = 0;
+    int step = 0;
+    double sim_time = 0.0;
+
+    while (step < total_steps) {
+        // 1) Actualizar semáforos
+        for (int i = 0; i < X.num_lights; ++i) {
+            update_traffic_light(&X.lights[i], dt);
+        }
+
+        // 2) Llegadas del paso: reciclar o agrandar el pool si hace falta y ocupar sus slots
+        stream_arrivals(&A, step + 1, &next_id, &arr);
+        stream_reserve(&V, &arr, &st);
+        int first_slot[NUM_LANES];
+        stream_admit(&V, &arr, first_slot);
+        for (int l = 0; l < NUM_LANES; ++l) {
+            stream_spawn(&V, &A, &arr, l, first_slot[l], first_slot[l], V.lane_end[l]);
+        }
+        st.spawned += arr.total;
+        int in_flight = stream_in_flight(&V);
+        if (in_flight > st.max_in_flight) st.max_in_flight = in_flight;
+
+        // 3) Mover los vehículos en ruta, carril por carril
+        LaneMode mode[NUM_LANES];
+        int crossed[NUM_LANES] = {0}, halted[NUM_LANES] = {0};
+        lane_modes(&V, &X, mode);
+        for (int l = 0; l < NUM_LANES; ++l) {
+            LaneSlice sl = { l, V.lane_begin[l], V.lane_end[l] };
+            move_lane_slice(&V, &sl, mode[l], X.stop_distance, dt, NULL, &crossed[l], &halted[l]);
+        }
+        end_lane_step(&V, mode, crossed, halted);
+        for (int l = 0; l < NUM_LANES; ++l) {
+            st.lane_crossed[l] += crossed[l];
+            st.crossed += crossed[l];
+        }
+
+        step += 1;
+        sim_time += dt;
 
-    printf("\n--- Resumen (Secuencial) ---\n");
-    printf("Vehículos: %d, Pasos ejecutados: %d, dt=%.1f s\n", num_vehicles, step, dt);
-    printf("Vehículos que cruzaron: %d/%d\n", total_crossed, num_vehicles);
-    printf("Cruces totales por vehículo (suma de V.crossings): %d\n", total_crossings);
-    printf("Espera promedio por vehículo: %.2f s\n", avg_wait);
-    printf("Tiempo total SIMULADO: %.0f s\n", sim_time);
+        // 4) Impresión según intervalo (por carril: no hay una flota que listar)
+        if (print_every > 0 && (step % print_every) == 0) {
+            print_stream_state(step, sim_time, &V, &st, &X, 0);
+        }
+    }
+
+    double wall_t1 = now_seconds();
+
+    stream_finish_stats(&V, &st);
+    print_stream_summary("Secuencial", cfg, &V, &st, step, sim_time, 0);
     printf("Tiempo de EJECUCIÓN (wall clock): %.3f s\n", wall_t1 - wall_t0);
 
-    free(crossed_now);
+    stream_close_source(&A);
     free(X.lights);
-    free(V);
+    free_vehicles_soa(&V);
 }
 
 int main(int argc, char** argv) {
-    int    N           = (argc > 1) ? atoi(argv[1]) : 200;   // vehículos
-    int    print_every = (argc > 2) ? atoi(argv[2]) : 5;   // imprimir cada k pasos (= k segundos)
-    double dt          = 1.0;                              // s
-    unsigned int seed  = (argc > 3) ? (unsigned int)atoi(argv[3]) : (unsigned int)time(NULL);
+    SimConfig cfg; // v: vehículos, t: imprimir cada k pasos (= k segundos), semilla
+    parse_sim_args(argc, argv, &cfg);
+    sim_check_config(&cfg);
+    if (cfg.scenario_path) {
+        scenario_apply_config(cfg.scenario_path, &cfg, "seq");
+        sim_check_config(&cfg);
+    }
+    if (cfg.bench) {
+        const int threads[] = { 1 };
+        run_benchmark(&cfg, "seq", run_simulation, threads, 1, NULL);
+        return 0;
+    }
+    if (cfg.ensemble > 0) {
+        ensemble_check_config(&cfg);
+        run_ensemble(&cfg);
+        return 0;
+    }
+    if (stream_enabled(&cfg)) {
+        stream_check_config(&cfg);
+        run_stream_simulation(&cfg); // v: capacidad inicial del pool de slots
+        return 0;
+    }
+    if (cfg.resume_path) {
+        checkpoint_apply_config(cfg.resume_path, &cfg);
+        sim_check_config(&cfg); // el checkpoint puede prender --car-following o --actuated
+    }
 
-    run_simulation(N, print_every, dt, seed);
-    return 0;
+    SimResult result;
+    run_simulation(&cfg, &result);
+    return result.mismatch ? 2 : 0;
 }
@@ -0,0 +1,171 @@
+// traffic_snapshot.h
+// Escritura asíncrona de snapshots: la simulación copia el estado de un paso a un anillo de
+// búferes y un hilo escritor dedicado lo entrega al consumidor (texto, traza binaria). La simulación solo se bloquea
+// si el anillo está lleno (el escritor va más de SNAPSHOT_RING_SLOTS pasos atrasado).
+
+#ifndef TRAFFIC_SNAPSHOT_H
+#define TRAFFIC_SNAPSHOT_H
+
+#include <pthread.h>
+
+#include "traffic_core.h"
+
+// Búferes del anillo: con 2, mientras el escritor vuelca uno la simulación llena el otro.
+#ifndef SNAPSHOT_RING_SLOTS
+#define SNAPSHOT_RING_SLOTS 2
+#endif
+
+// Estado de un paso, en orden de id (la compactación no cambia el orden de impresión).
+typedef struct {
+    int            step;
+    double         sim_time;
+    bool           text;     // imprimir este paso como texto (si no, solo va a la traza)
+    int            n;
+    unsigned char* lane;
+    unsigned char* state;    // VEH_* tal como quedó en el paso (VEH_CROSSED_NOW = cruzó en este)
+    unsigned char* waiting;
+    double*        pos;
+    int            num_lights;
+    TrafficLight*  lights;
+} Snapshot;
+
+// Consumidor de snapshots: corre en el hilo escritor, uno por vez y en orden de publicación.
+typedef void (*SnapshotSink)(void* ctx, const Snapshot* snap);
+
+typedef struct {
+    Snapshot          slots[SNAPSHOT_RING_SLOTS];
+    int               head;      // próximo a llenar (simulación)
+    int               tail;      // próximo a escribir (escritor)
+    int               count;     // publicados y todavía no escritos
+    bool              closing;
+    long long         stalls;    // veces que la simulación esperó lugar en el anillo
+    pthread_mutex_t   lock;
+    pthread_cond_t    not_empty;
+    pthread_cond_t    not_full;
+    pthread_t         writer;
+    SnapshotSink      sink;
+    void*             ctx;
+} SnapshotRing;
+
+// ----------------------- Copia del estado -----------------------
+// Copia los vehículos con id en [id_begin, id_end); rangos disjuntos se pueden llenar en paralelo.
+static inline void snapshot_store_vehicles(Snapshot* snap, const VehicleSoA* S, int id_begin, int id_end) {
+    for (int id = id_begin; id < id_end; ++id) {
+        int i = S->slot[id];
+        snap->lane[id]    = (unsigned char)S->lane[i];
+        snap->state[id]   = S->finished[i];
+        snap->waiting[id] = S->waiting[i];
+        snap->pos[id]     = S->pos[i];
+    }
+}
+
+static inline void snapshot_store_lights(Snapshot* snap, int step, double sim_time, const Intersection* X) {
+    snap->step = step;
+    snap->sim_time = sim_time;
+    memcpy(snap->lights, X->lights, (size_t)snap->num_lights * sizeof(TrafficLight));
+}
+
+// Formato de texto de un snapshot (el de traffic_omp).
+static inline void write_snapshot_text(FILE* out, const Snapshot* snap) {
+    fprintf(out, "Iteración %d (t=%.1fs):\n", snap->step, snap->sim_time);
+    for (int id = 0; id < snap->n; ++id) {
+        if (snap->state[id] == VEH_CROSSED_NOW) {
+            fprintf(out, "Vehículo %d - Carril: %d, Posición: 0.00 (CRUZÓ en esta iteración)\n",
+                    id, snap->lane[id]);
+        } else if (snap->state[id]) {
+            fprintf(out, "Vehículo %d - Carril: %d, Posición: 0.00 (YA CRUZÓ)\n",
+                    id, snap->lane[id]);
+        } else {
+            fprintf(out, "Vehículo %d - Carril: %d, Posición: %.2f%s\n",
+                    id, snap->lane[id], snap->pos[id], snap->waiting[id] ? " (ESPERANDO)" : "");
+        }
+    }
+    for (int i = 0; i < snap->num_lights; ++i) {
+        fprintf(out, "Semáforo %d - Estado: %s, Tiempo en estado: %.1fs\n",
+                i, state_to_str(snap->lights[i].state), snap->lights[i].time_in_state);
+    }
+    fprintf(out, "\n");
+}
+
+// ----------------------- Hilo escritor -----------------------
+static inline void* snapshot_writer_main(void* arg) {
+    SnapshotRing* R = (SnapshotRing*)arg;
+    pthread_mutex_lock(&R->lock);
+    for (;;) {
+        while (R->count == 0 && !R->closing) pthread_cond_wait(&R->not_empty, &R->lock);
+        if (R->count == 0) break; // cerrando y sin pendientes
+        Snapshot* snap = &R->slots[R->tail];
+        pthread_mutex_unlock(&R->lock);
+
+        R->sink(R->ctx, snap); // sin el candado: la simulación sigue llenando el otro búfer
+
+        pthread_mutex_lock(&R->lock);
+        R->tail = (R->tail + 1) % SNAPSHOT_RING_SLOTS;
+        R->count -= 1;
+        pthread_cond_signal(&R->not_full);
+    }
+    pthread_mutex_unlock(&R->lock);
+    return NULL;
+}
+
+static inline void snapshot_ring_start(SnapshotRing* R, int n, int num_lights, SnapshotSink sink, void* ctx) {
+    *R = (SnapshotRing){0};
+    for (int k = 0; k < SNAPSHOT_RING_SLOTS; ++k) {
+        Snapshot* snap = &R->slots[k];
+        snap->n          = n;
+        snap->lane       = (unsigned char*)malloc((size_t)n);
+        snap->state      = (unsigned char*)malloc((size_t)n);
+        snap->waiting    = (unsigned char*)malloc((size_t)n);
+        snap->pos        = (double*)malloc((size_t)n * sizeof(double));
+        snap->num_lights = num_lights;
+        snap->lights     = (TrafficLight*)malloc((size_t)num_lights * sizeof(TrafficLight));
+    }
+    R->sink = sink;
+    R->ctx = ctx;
+    pthread_mutex_init(&R->lock, NULL);
+    pthread_cond_init(&R->not_empty, NULL);
+    pthread_cond_init(&R->not_full, NULL);
+    pthread_create(&R->writer, NULL, snapshot_writer_main, R);
+}
+
+// Búfer libre para el próximo snapshot; espera solo si el anillo está lleno.
+static inline Snapshot* snapshot_ring_acquire(SnapshotRing* R) {
+    pthread_mutex_lock(&R->lock);
+    if (R->count == SNAPSHOT_RING_SLOTS) R->stalls += 1;
+    while (R->count == SNAPSHOT_RING_SLOTS) pthread_cond_wait(&R->not_full, &R->lock);
+    Snapshot* snap = &R->slots[R->head];
+    pthread_mutex_unlock(&R->lock);
+    return snap;
+}
+
+// Entrega al escritor el búfer obtenido con snapshot_ring_acquire (ya lleno).
+static inline void snapshot_ring_publish(SnapshotRing* R) {
+    pthread_mutex_lock(&R->lock);
+    R->head = (R->head + 1) % SNAPSHOT_RING_SLOTS;
+    R->count += 1;
+    pthread_cond_signal(&R->not_empty);
+    pthread_mutex_unlock(&R->lock);
+}
+
+// Espera a que el escritor vacíe el anillo y lo libera.
+static inline void snapshot_ring_finish(SnapshotRing* R) {
+    pthread_mutex_lock(&R->lock);
+    R->closing = true;
+    pthread_cond_signal(&R->not_empty);
+    pthread_mutex_unlock(&R->lock);
+    pthread_join(R->writer, NULL);
+
+    pthread_mutex_destroy(&R->lock);
+    pthread_cond_destroy(&R->not_empty);
+    pthread_cond_destroy(&R->not_full);
+    for (int k = 0; k < SNAPSHOT_RING_SLOTS; ++k) {
+        Snapshot* snap = &R->slots[k];
+        free(snap->lane);
+        free(snap->state);
+        free(snap->waiting);
+        free(snap->pos);
+        free(snap->lights);
+    }
+}
+
+#endif // TRAFFIC_SNAPSHOT_H
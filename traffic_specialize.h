@@ -0,0 +1,53 @@
+// traffic_specialize.h
+// Recorrido de movimiento del modelo básico (sin --car-following, --actuated ni --time-block)
+// en variantes fijadas en compilación: juntar eventos de cruce sí/no y --stats sí/no. Cada
+// variante sale de traffic_move_variant.h con los parámetros como constantes, así lo que la
+// corrida no usa no queda ni como prueba por tramo. El motor elige la variante una vez al
+// empezar (select_move_lanes) y en cada paso la llama sin mirar la configuración.
+//
+// El número de carriles ya es de compilación (NUM_LANES), y el semáforo de cada vehículo se
+// resuelve por carril (lane_modes), no con una lectura indirecta por vehículo. El kernel por
+// vehículo (move_vehicles_soa) es el mismo en todas las variantes: los resultados no cambian.
+// traffic_seq junta eventos solo en los pasos que imprime; traffic_omp nunca (imprime desde los
+// snapshots, y la traza también).
+
+#ifndef TRAFFIC_SPECIALIZE_H
+#define TRAFFIC_SPECIALIZE_H
+
+#include "traffic_core.h"
+#include "traffic_stats.h"
+
+// Mueve con el modo de su carril los tramos [0, num_slices). Se le pasan todos: dentro de la región
+// paralela de traffic_omp el omp for schedule(static) de la variante los reparte entre los hilos.
+// Suma cruces y detenidos por carril; con eventos, los ids que cruzan van a events; con --stats,
+// la espera de los que cruzan va a R y a *cross_wait.
+typedef void (*MoveLanesFn)(VehicleSoA* S, const LaneSlice* slices, int num_slices, const LaneMode mode[NUM_LANES],
+                            double stop_distance, double dt, EventBuffer* events, RunStats* R,
+                            int crossed[NUM_LANES], int halted[NUM_LANES], long long* cross_wait);
+
+#define MOVE_VARIANT move_lanes_plain
+#define MOVE_EVENTS  0
+#define MOVE_STATS   0
+#include "traffic_move_variant.h"
+
+#define MOVE_VARIANT move_lanes_events
+#define MOVE_EVENTS  1
+#define MOVE_STATS   0
+#include "traffic_move_variant.h"
+
+#define MOVE_VARIANT move_lanes_stats
+#define MOVE_EVENTS  0
+#define MOVE_STATS   1
+#include "traffic_move_variant.h"
+
+#define MOVE_VARIANT move_lanes_events_stats
+#define MOVE_EVENTS  1
+#define MOVE_STATS   1
+#include "traffic_move_variant.h"
+
+static inline MoveLanesFn select_move_lanes(bool events, bool stats) {
+    if (events) return stats ? move_lanes_events_stats : move_lanes_events;
+    return stats ? move_lanes_stats : move_lanes_plain;
+}
+
+#endif // TRAFFIC_SPECIALIZE_H
@@ -0,0 +1,123 @@
+// traffic_stats.h
+// Estadísticas incrementales (--stats archivo, traffic_seq y traffic_omp): en lugar de mirar la
+// flota solo al final, cada paso deja una fila con los cruces por carril, los vivos, los
+// detenidos en rojo y la espera promedio de los que cruzaron, y al terminar el resumen agrega los
+// cuantiles de la espera al cruzar y el flujo por carril.
+//
+// Lo que hace falta sale casi gratis del bucle de movimiento: los cruces por carril ya están en
+// los parciales de cada paso y los vivos y detenidos en los contadores por carril. Lo único nuevo
+// es la espera de los que cruzaron. Los cruces caen en pocos tramos (los carriles están ordenados
+// por distancia), así que, como los eventos de move_vehicles_soa, es un segundo recorrido solo de
+// los tramos en que alguien cruzó, con el tramo todavía en la caché. Cada hilo suma en su propio
+// RunStats (histograma acumulado) y en su parcial del paso (espera de los cruces del paso).
+// Las esperas se cuentan en pasos enteros (wait_in_steps): el histograma es exacto (un casillero
+// por paso, los cuantiles salen sin aproximar) y las sumas no dependen del reparto, así
+// traffic_seq y traffic_omp escriben el mismo archivo con cualquier número de hilos.
+//
+// Archivo (CSV): step,time,crossed_0,...,crossed_3,crossed,active,waiting,mean_wait_crossed
+// Los pasos del avance rápido no tienen fila (en ellos nadie cruza ni se detiene).
+
+#ifndef TRAFFIC_STATS_H
+#define TRAFFIC_STATS_H
+
+#include "traffic_core.h"
+
+// Casilleros del histograma de espera al cruzar, uno por paso; el último junta las más largas.
+#define STATS_WAIT_BINS 1024
+
+// Acumulado de una corrida (o de un hilo, para combinar al final).
+typedef struct {
+    long long wait_hist[STATS_WAIT_BINS]; // cruces por espera, en pasos
+    long long lane_crossed[NUM_LANES];
+    long long crossed;
+    long long wait_steps;                 // suma de las esperas al cruzar
+} RunStats;
+
+static inline void stats_merge(RunStats* dst, const RunStats* src) {
+    for (int b = 0; b < STATS_WAIT_BINS; ++b) dst->wait_hist[b] += src->wait_hist[b];
+    for (int l = 0; l < NUM_LANES; ++l) dst->lane_crossed[l] += src->lane_crossed[l];
+    dst->crossed += src->crossed;
+    dst->wait_steps += src->wait_steps;
+}
+
+// Después de mover el tramo: suma en R los que cruzaron en este paso (VEH_CROSSED_NOW) y devuelve
+// la suma de sus esperas en pasos. Llamarla solo si el tramo tuvo cruces.
+static inline long long stats_scan_slice(const VehicleSoA* S, const LaneSlice* sl, double dt, RunStats* R) {
+    const real_t inv_dt = (real_t)(1.0 / dt);
+    long long sum = 0;
+    for (int i = sl->begin; i < sl->end; ++i) {
+        if (S->finished[i] != VEH_CROSSED_NOW) continue;
+        long long w = wait_in_steps(S->total_wait[i], inv_dt);
+        R->wait_hist[(w < STATS_WAIT_BINS - 1) ? w : STATS_WAIT_BINS - 1] += 1;
+        R->lane_crossed[sl->lane] += 1;
+        R->crossed += 1;
+        sum += w;
+    }
+    R->wait_steps += sum;
+    return sum;
+}
+
+// ----------------------- Serie por paso -----------------------
+static inline FILE* stats_open(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) {
+        fprintf(stderr, "No se pudo crear el archivo de estadísticas: %s\n", path);
+        exit(1);
+    }
+    fprintf(out, "step,time");
+    for (int l = 0; l < NUM_LANES; ++l) fprintf(out, ",crossed_%d", l);
+    fprintf(out, ",crossed,active,waiting,mean_wait_crossed\n");
+    return out;
+}
+
+// Fila del paso `step` con los contadores por carril ya cerrados (end_lane_step).
+static inline void stats_write_step(FILE* out, int step, double sim_time, const int crossed[NUM_LANES],
+                                    long long cross_wait_steps, const VehicleSoA* S, double dt) {
+    int total = 0, active = 0, waiting = 0;
+    fprintf(out, "%d,%.17g", step, sim_time);
+    for (int l = 0; l < NUM_LANES; ++l) {
+        fprintf(out, ",%d", crossed[l]);
+        total += crossed[l];
+        active += S->lane_live[l];
+        waiting += S->lane_waiting[l];
+    }
+    fprintf(out, ",%d,%d,%d,%.17g\n", total, active, waiting,
+            total > 0 ? (double)cross_wait_steps * dt / total : 0.0);
+}
+
+// ----------------------- Resumen -----------------------
+// Espera (s) del cuantil q: el menor casillero con al menos q de los cruces hasta él.
+static inline double stats_quantile(const RunStats* R, double q, double dt) {
+    long long target = (long long)ceil(q * (double)R->crossed);
+    if (target < 1) target = 1;
+    long long cum = 0;
+    for (int b = 0; b < STATS_WAIT_BINS; ++b) {
+        cum += R->wait_hist[b];
+        if (cum >= target) return b * dt;
+    }
+    return (STATS_WAIT_BINS - 1) * dt;
+}
+
+static inline double stats_max_wait(const RunStats* R, double dt) {
+    for (int b = STATS_WAIT_BINS - 1; b >= 0; --b) {
+        if (R->wait_hist[b] > 0) return b * dt;
+    }
+    return 0.0;
+}
+
+static inline void print_run_stats(const RunStats* R, const char* path, double dt, double elapsed) {
+    printf("Estadísticas por paso: %s\n", path);
+    if (R->crossed > 0) {
+        const char* more = R->wait_hist[STATS_WAIT_BINS - 1] > 0 ? ">= " : "";
+        printf("Espera al cruzar (%lld vehículos): media %.3f s, P50 %.1f s, P90 %.1f s, P99 %.1f s, máx. %s%.1f s\n",
+               R->crossed, (double)R->wait_steps * dt / R->crossed, stats_quantile(R, 0.50, dt),
+               stats_quantile(R, 0.90, dt), stats_quantile(R, 0.99, dt), more, stats_max_wait(R, dt));
+    }
+    if (elapsed > 0.0) {
+        printf("Flujo por carril (veh/min):");
+        for (int l = 0; l < NUM_LANES; ++l) printf(" %d: %.2f", l, 60.0 * R->lane_crossed[l] / elapsed);
+        printf("\n");
+    }
+}
+
+#endif // TRAFFIC_STATS_H
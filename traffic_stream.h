@@ -0,0 +1,389 @@
+// traffic_stream.h
+// Flujo continuo de vehículos (--arrival-rate / --arrivals): en lugar de una flota fija que
+// existe desde t=0, cada carril recibe llegadas paso a paso (un proceso de Poisson con la tasa
+// pedida, o las de un archivo) y la corrida dura --duration segundos.
+//
+// Los vehículos viven en el mismo VehicleSoA, con un pool de slots por carril: el carril L tiene
+// reservados [lane_begin[L], lane_begin[L+1]), de los cuales [lane_begin[L], lane_end[L]) están
+// ocupados y el resto libres. Las llegadas toman slots del final del rango ocupado; la
+// compactación deja ahí los slots de los que ya cruzaron, así se reusan. El pool solo crece si
+// un carril se queda sin slots libres, de modo que la memoria acompaña al máximo de vehículos
+// en ruta y no a la demanda total. Sin slot[id] (los ids crecen sin tope): los informes son por
+// carril.
+
+#ifndef TRAFFIC_STREAM_H
+#define TRAFFIC_STREAM_H
+
+#include "traffic_core.h"
+
+#define STREAM_SPAWN_DISTANCE 200.0 // las llegadas entran a 200 m de la línea de alto
+#define STREAM_MIN_LANE_SLOTS 64    // capacidad inicial mínima por carril
+#define STREAM_MAX_ARRIVALS   1000  // tope de llegadas por carril y paso (muestreo de Poisson)
+#define STREAM_MAX_LAMBDA     100.0 // tasa * dt máxima (llegadas esperadas por carril y paso)
+
+// Una llegada del archivo: paso en que entra, carril, velocidad y orden en el archivo.
+typedef struct {
+    int    step;
+    int    lane;
+    int    seq;
+    double speed;
+} ArrivalRecord;
+
+// Fuente de llegadas. Cada hilo puede llevar su copia (solo cambia cursor) y todas dan lo mismo.
+typedef struct {
+    double         rate;    // llegadas/s por carril (modo Poisson)
+    unsigned int   seed;
+    double         dt;
+    ArrivalRecord* list;    // modo archivo: ordenadas por (paso, carril, orden); NULL = Poisson
+    int            count;
+    int            cursor;  // primera llegada de list todavía no usada
+} ArrivalSource;
+
+// Llegadas de un paso. La j-ésima del carril L tiene id id_base[L] + j (y, en modo archivo, es
+// list[first[L] + j]).
+typedef struct {
+    int       count[NUM_LANES];
+    int       first[NUM_LANES];
+    long long id_base[NUM_LANES];
+    int       total;
+} StepArrivals;
+
+typedef struct {
+    long long spawned;
+    long long crossed;
+    long long lane_crossed[NUM_LANES];
+    double    crossed_wait;   // espera acumulada de los que cruzaron
+    int       max_in_flight;
+    int       grows;          // veces que se agrandó el pool
+} StreamStats;
+
+static inline bool stream_enabled(const SimConfig* cfg) {
+    return cfg->arrival_rate > 0.0 || cfg->arrivals_path != NULL;
+}
+
+static inline int stream_total_steps(const SimConfig* cfg) {
+    return (int)ceil(cfg->duration / cfg->dt - 1e-9);
+}
+
+// Las opciones que suponen una flota fija ya las rechaza sim_check_config.
+static inline void stream_check_config(const SimConfig* cfg) {
+    if (cfg->arrival_rate * cfg->dt > STREAM_MAX_LAMBDA) {
+        fprintf(stderr, "Tasa de llegadas demasiado alta: %.1f por carril y paso (máx. %.0f)\n",
+                cfg->arrival_rate * cfg->dt, STREAM_MAX_LAMBDA);
+        exit(1);
+    }
+}
+
+// ----------------------- Fuente de llegadas -----------------------
+static inline int cmp_arrival(const void* a, const void* b) {
+    const ArrivalRecord* x = (const ArrivalRecord*)a;
+    const ArrivalRecord* y = (const ArrivalRecord*)b;
+    if (x->step != y->step) return (x->step > y->step) - (x->step < y->step);
+    if (x->lane != y->lane) return (x->lane > y->lane) - (x->lane < y->lane);
+    return (x->seq > y->seq) - (x->seq < y->seq);
+}
+
+// Archivo de llegadas: una por línea, "t carril velocidad" (s, 0..3, m/s); '#' comenta. Una
+// llegada en t entra en el primer paso que termina en t o después.
+static inline bool load_arrivals(ArrivalSource* A, const char* path) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "No se pudo abrir el archivo de llegadas: %s\n", path);
+        return false;
+    }
+    int cap = 256, line_no = 0;
+    A->list = (ArrivalRecord*)malloc((size_t)cap * sizeof(ArrivalRecord));
+    A->count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), f)) {
+        ++line_no;
+        char* p = line;
+        while (*p == ' ' || *p == '\t') ++p;
+        if (*p == '#' || *p == '\n' || *p == '\r' || *p == '\0') continue;
+        double t, speed;
+        int lane;
+        if (sscanf(p, "%lf %d %lf", &t, &lane, &speed) != 3 || t < 0.0 || lane < 0 ||
+            lane >= NUM_LANES || !(speed > 0.0)) {
+            fprintf(stderr, "%s:%d: se espera \"t carril velocidad\" (t >= 0, carril 0..%d, velocidad > 0)\n",
+                    path, line_no, NUM_LANES - 1);
+            fclose(f);
+            free(A->list);
+            A->list = NULL;
+            return false;
+        }
+        if (A->count == cap) {
+            cap *= 2;
+            A->list = (ArrivalRecord*)realloc(A->list, (size_t)cap * sizeof(ArrivalRecord));
+        }
+        int step = (int)ceil(t / A->dt - 1e-9);
+        A->list[A->count] = (ArrivalRecord){ step < 1 ? 1 : step, lane, A->count, speed };
+        A->count += 1;
+    }
+    fclose(f);
+    qsort(A->list, A->count, sizeof(ArrivalRecord), cmp_arrival);
+    return true;
+}
+
+static inline bool stream_open_source(ArrivalSource* A, const SimConfig* cfg) {
+    *A = (ArrivalSource){0};
+    A->rate = cfg->arrival_rate;
+    A->seed = cfg->seed;
+    A->dt = cfg->dt;
+    return cfg->arrivals_path ? load_arrivals(A, cfg->arrivals_path) : true;
+}
+
+static inline void stream_close_source(ArrivalSource* A) {
+    free(A->list);
+    A->list = NULL;
+}
+
+// Llegadas de Poisson del carril l en el paso step, por inversión de la acumulada (la media
+// tasa * dt está acotada por STREAM_MAX_LAMBDA).
+static inline int poisson_arrivals(const ArrivalSource* A, int step, int l) {
+    double lambda = A->rate * A->dt;
+    double u = rng_uniform(A->seed, RNG_ARRIVALS, (uint64_t)step * NUM_LANES + l, 0, 0.0, 1.0);
+    double p = exp(-lambda), acc = p;
+    int k = 0;
+    while (u > acc && k < STREAM_MAX_ARRIVALS) {
+        ++k;
+        p *= lambda / k;
+        acc += p;
+    }
+    return k;
+}
+
+// Llegadas del paso step (1, 2, ...; se piden en orden). Los ids se asignan por carril a
+// partir de *next_id.
+static inline void stream_arrivals(ArrivalSource* A, int step, long long* next_id, StepArrivals* out) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        out->count[l] = 0;
+        out->first[l] = -1;
+    }
+    if (A->list) {
+        for (; A->cursor < A->count && A->list[A->cursor].step <= step; ++A->cursor) {
+            const ArrivalRecord* r = &A->list[A->cursor];
+            if (r->step < step) continue; // solo si se saltaron pasos
+            if (out->first[r->lane] < 0) out->first[r->lane] = A->cursor;
+            out->count[r->lane] += 1;
+        }
+    } else {
+        for (int l = 0; l < NUM_LANES; ++l) out->count[l] = poisson_arrivals(A, step, l);
+    }
+    out->total = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        out->id_base[l] = *next_id;
+        *next_id += out->count[l];
+        out->total += out->count[l];
+    }
+}
+
+// ----------------------- Pool de slots -----------------------
+// Reserva cap[L] slots por carril, todos libres. Sin escribirlos (malloc): la primera escritura
+// es la de la llegada que ocupa cada slot.
+static inline void stream_alloc_pool(VehicleSoA* S, const int cap[NUM_LANES]) {
+    S->lane_begin[0] = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        S->lane_begin[l + 1] = S->lane_begin[l] + cap[l];
+        S->lane_end[l] = S->lane_begin[l];
+        S->lane_live[l] = 0;
+        S->lane_waiting[l] = 0;
+    }
+    const size_t N = (size_t)S->lane_begin[NUM_LANES];
+    S->n          = (int)N;
+    S->slot       = NULL;
+    S->id         = (int*)malloc(N * sizeof(int));
+    S->lane       = (lane_t*)malloc(N * sizeof(lane_t));
+    S->pos        = (real_t*)malloc(N * sizeof(real_t));
+    S->speed      = (real_t*)malloc(N * sizeof(real_t));
+    S->waiting    = (unsigned char*)malloc(N * sizeof(unsigned char));
+    S->finished   = (unsigned char*)malloc(N * sizeof(unsigned char));
+    S->total_wait = (real_t*)malloc(N * sizeof(real_t));
+    S->crossings  = (cross_t*)malloc(N * sizeof(cross_t));
+}
+
+// Pool inicial: capacity slots en total (el parámetro v de la línea de comandos).
+static inline void stream_init_pool(VehicleSoA* S, int capacity) {
+    int cap[NUM_LANES];
+    for (int l = 0; l < NUM_LANES; ++l) {
+        int c = capacity / NUM_LANES;
+        cap[l] = (c > STREAM_MIN_LANE_SLOTS) ? c : STREAM_MIN_LANE_SLOTS;
+    }
+    stream_alloc_pool(S, cap);
+}
+
+// Bytes por slot (todos los arreglos de VehicleSoA salvo slot).
+static inline size_t stream_slot_bytes(void) {
+    return sizeof(int) + sizeof(lane_t) + 3 * sizeof(real_t) + 2 * sizeof(unsigned char) + sizeof(cross_t);
+}
+
+// Agranda el pool para que quepan las llegadas de arr: duplica la capacidad de cada carril que
+// no alcanza y copia los rangos ocupados. Los contadores por carril no cambian.
+static inline void stream_grow_pool(VehicleSoA* S, const StepArrivals* arr) {
+    int cap[NUM_LANES];
+    for (int l = 0; l < NUM_LANES; ++l) {
+        int used = S->lane_end[l] - S->lane_begin[l];
+        cap[l] = S->lane_begin[l + 1] - S->lane_begin[l];
+        while (cap[l] < used + arr->count[l]) cap[l] *= 2;
+    }
+    VehicleSoA G;
+    stream_alloc_pool(&G, cap);
+    for (int l = 0; l < NUM_LANES; ++l) {
+        const size_t from = (size_t)S->lane_begin[l], to = (size_t)G.lane_begin[l];
+        const size_t used = (size_t)(S->lane_end[l] - S->lane_begin[l]);
+        memcpy(G.id + to,         S->id + from,         used * sizeof(int));
+        memcpy(G.lane + to,       S->lane + from,       used * sizeof(lane_t));
+        memcpy(G.pos + to,        S->pos + from,        used * sizeof(real_t));
+        memcpy(G.speed + to,      S->speed + from,      used * sizeof(real_t));
+        memcpy(G.waiting + to,    S->waiting + from,    used);
+        memcpy(G.finished + to,   S->finished + from,   used);
+        memcpy(G.total_wait + to, S->total_wait + from, used * sizeof(real_t));
+        memcpy(G.crossings + to,  S->crossings + from,  used * sizeof(cross_t));
+        G.lane_end[l] = G.lane_begin[l] + (int)used;
+        G.lane_live[l] = S->lane_live[l];
+        G.lane_waiting[l] = S->lane_waiting[l];
+    }
+    free_vehicles_soa(S);
+    *S = G;
+}
+
+// Compacta el carril l y suma la espera de los que cruzaron: sus slots quedan libres.
+static inline void stream_recycle_lane(VehicleSoA* S, int l, double* crossed_wait) {
+    const int old_end = S->lane_end[l];
+    compact_lane_soa(S, l);
+    for (int s = S->lane_end[l]; s < old_end; ++s) *crossed_wait += S->total_wait[s];
+}
+
+static inline bool stream_lane_full(const VehicleSoA* S, const StepArrivals* arr, int l) {
+    return S->lane_end[l] + arr->count[l] > S->lane_begin[l + 1];
+}
+
+// true si stream_reserve tiene algo que hacer antes de admitir arr.
+static inline bool stream_needs_reserve(const VehicleSoA* S, const StepArrivals* arr) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        if (stream_lane_full(S, arr, l) || lane_needs_compaction(S, l)) return true;
+    }
+    return false;
+}
+
+// Deja lugar para las llegadas de arr: recicla los carriles sin lugar o con muchos slots de
+// vehículos que ya cruzaron (la misma regla de 1/8 que la flota fija) y, si aun así falta,
+// agranda el pool. Devuelve true si cambió la capacidad (hay que rearmar los tramos).
+static inline bool stream_reserve(VehicleSoA* S, const StepArrivals* arr, StreamStats* st) {
+    bool grow = false;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        if (stream_lane_full(S, arr, l) || lane_needs_compaction(S, l)) {
+            stream_recycle_lane(S, l, &st->crossed_wait);
+        }
+        grow |= stream_lane_full(S, arr, l);
+    }
+    if (grow) {
+        stream_grow_pool(S, arr);
+        st->grows += 1;
+    }
+    return grow;
+}
+
+// Ocupa los slots de las llegadas al final del rango ocupado de cada carril (solo contadores;
+// el contenido lo escribe stream_spawn). first_slot[L]: slot de la primera llegada del carril.
+static inline void stream_admit(VehicleSoA* S, const StepArrivals* arr, int first_slot[NUM_LANES]) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        first_slot[l] = S->lane_end[l];
+        S->lane_end[l] += arr->count[l];
+        S->lane_live[l] += arr->count[l];
+    }
+}
+
+// Escribe las llegadas del carril l que caen en los slots [begin, end) (la j-ésima ocupa
+// first_slot + j). Rangos disjuntos se pueden escribir en paralelo.
+static inline void stream_spawn(VehicleSoA* S, const ArrivalSource* A, const StepArrivals* arr, int l,
+                                int first_slot, int begin, int end) {
+    int b = (begin > first_slot) ? begin : first_slot;
+    int e = (end < first_slot + arr->count[l]) ? end : first_slot + arr->count[l];
+    for (int s = b; s < e; ++s) {
+        int j = s - first_slot;
+        long long id = arr->id_base[l] + j;
+        S->id[s] = (int)(id & INT32_MAX); // solo identifica; el sorteo usa el id completo
+        S->lane[s] = l;
+        S->pos[s] = STREAM_SPAWN_DISTANCE;
+        S->speed[s] = A->list ? A->list[arr->first[l] + j].speed
+                              : rng_uniform(A->seed, RNG_ARRIVALS, (uint64_t)id, 1, 6.0, 14.0);
+        S->waiting[s] = 0;
+        S->finished[s] = VEH_EN_ROUTE;
+        S->total_wait[s] = 0.0;
+        S->crossings[s] = 0;
+    }
+}
+
+// Parte la capacidad de cada carril (ocupados y libres) en tramos de a lo sumo `block` slots:
+// los tramos no cambian al llegar o cruzar vehículos, solo al agrandar el pool. Quien mueve un
+// tramo lo recorta al rango ocupado. out: espacio para n / block + NUM_LANES tramos.
+static inline int stream_build_slices(const VehicleSoA* S, int block, LaneSlice* out) {
+    int k = 0;
+    for (int l = 0; l < NUM_LANES; ++l) {
+        for (int b = S->lane_begin[l]; b < S->lane_begin[l + 1]; b += block) {
+            int e = (b + block < S->lane_begin[l + 1]) ? b + block : S->lane_begin[l + 1];
+            out[k++] = (LaneSlice){ l, b, e };
+        }
+    }
+    return k;
+}
+
+static inline LaneSlice stream_clip_slice(const VehicleSoA* S, LaneSlice sl) {
+    if (sl.end > S->lane_end[sl.lane]) sl.end = S->lane_end[sl.lane];
+    if (sl.begin > sl.end) sl.begin = sl.end;
+    return sl;
+}
+
+static inline int stream_in_flight(const VehicleSoA* S) {
+    int n = 0;
+    for (int l = 0; l < NUM_LANES; ++l) n += S->lane_live[l];
+    return n;
+}
+
+// Al terminar: suma la espera de los que cruzaron y todavía ocupan slot.
+static inline void stream_finish_stats(const VehicleSoA* S, StreamStats* st) {
+    for (int l = 0; l < NUM_LANES; ++l) {
+        for (int s = S->lane_begin[l]; s < S->lane_end[l]; ++s) {
+            if (S->finished[s]) st->crossed_wait += S->total_wait[s];
+        }
+    }
+}
+
+// ----------------------- Impresión -----------------------
+// Estado por carril (decimals: decimales de los tiempos, como en cada versión).
+static inline void print_stream_state(int step, double sim_time, const VehicleSoA* S,
+                                      const StreamStats* st, const Intersection* X, int decimals) {
+    printf("Iteración %d (t=%.*fs): en ruta: %d, llegadas: %lld, cruzaron: %lld\n",
+           step, decimals, sim_time, stream_in_flight(S), st->spawned, st->crossed);
+    for (int l = 0; l < NUM_LANES; ++l) {
+        printf("Carril %d - En ruta: %d, Esperando: %d, Slots: %d/%d\n", l, S->lane_live[l],
+               S->lane_waiting[l], S->lane_end[l] - S->lane_begin[l], S->lane_begin[l + 1] - S->lane_begin[l]);
+    }
+    for (int i = 0; i < X->num_lights; ++i) {
+        printf("Semáforo %d - Estado: %s, Tiempo en estado: %.*fs\n",
+               i, state_to_str(X->lights[i].state), decimals, X->lights[i].time_in_state);
+    }
+    printf("\n");
+}
+
+static inline void print_stream_summary(const char* title, const SimConfig* cfg, const VehicleSoA* S,
+                                        const StreamStats* st, int steps, double sim_time, int decimals) {
+    printf("\n--- Resumen (%s, flujo continuo) ---\n", title);
+    if (cfg->arrivals_path) printf("Llegadas: archivo %s\n", cfg->arrivals_path);
+    else printf("Llegadas: Poisson, %.3f vehículos/s por carril\n", cfg->arrival_rate);
+    printf("Pasos ejecutados: %d, dt=%.1f s\n", steps, cfg->dt);
+    printf("Vehículos que llegaron: %lld, cruzaron: %lld, en ruta al final: %d\n",
+           st->spawned, st->crossed, stream_in_flight(S));
+    printf("Espera promedio de los que cruzaron: %.*f s\n", decimals + 2,
+           st->crossed > 0 ? st->crossed_wait / (double)st->crossed : 0.0);
+    printf("Flujo por carril (veh/h):");
+    for (int l = 0; l < NUM_LANES; ++l) {
+        printf(" %d: %.1f", l, sim_time > 0.0 ? (double)st->lane_crossed[l] * 3600.0 / sim_time : 0.0);
+    }
+    printf("\n");
+    printf("Máximo en ruta: %d, slots reservados: %d (%.1f KiB, ampliaciones del pool: %d)\n",
+           st->max_in_flight, S->n, (double)S->n * (double)stream_slot_bytes() / 1024.0, st->grows);
+    printf("Tiempo total SIMULADO: %.*f s\n", decimals, sim_time);
+}
+
+#endif // TRAFFIC_STREAM_H
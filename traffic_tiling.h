@@ -0,0 +1,80 @@
+// traffic_tiling.h
+// Bloqueo temporal del bucle de movimiento (--time-block K, traffic_omp): en lugar de recorrer
+// todos los vehículos una vez por paso, cada hilo avanza K pasos seguidos cada uno de sus tramos
+// (VEH_BLOCK vehículos, unas decenas de KB: quedan en la caché entre un paso y el siguiente) y
+// recién entonces pasa al tramo siguiente. Se puede porque los vehículos solo interactúan a
+// través de los semáforos, y los semáforos no dependen de los vehículos: el plan de los K pasos
+// (modo de cada carril y semáforos al terminar cada paso) se calcula antes, en cada hilo.
+// El recorrido de memoria pasa de uno por paso a uno por bloque y el kernel deja de estar
+// limitado por el ancho de banda.
+//
+// Es exacto: cada vehículo hace las mismas operaciones en el mismo orden que paso a paso, y el
+// modo por carril es el mismo (un carril en ROJO con la cola completa sigue así mientras no
+// cambie la luz). Los cruces y detenidos se cuentan por paso del bloque, así el cierre de cada
+// paso, el paso en que terminan todos y el estado final son los del motor paso a paso. Los pasos
+// que imprimen cierran un bloque; los checkpoints y el hash de --hash-log se hacen al final de
+// cada bloque (--verify-against saltea los pasos de la referencia del medio).
+
+#ifndef TRAFFIC_TILING_H
+#define TRAFFIC_TILING_H
+
+#include "traffic_core.h"
+
+#define TIME_BLOCK_MAX 64
+
+// Plan de un bloque (privado de cada hilo: todos calculan el mismo).
+typedef struct {
+    int          steps;                               // pasos del bloque (<= TIME_BLOCK_MAX)
+    LaneMode     mode[TIME_BLOCK_MAX][NUM_LANES];     // modo de cada carril en cada paso
+    TrafficLight lights[TIME_BLOCK_MAX][NUM_LANES];   // semáforos al terminar cada paso
+} TimeBlock;
+
+// Cruces y detenidos de cada paso del bloque en los tramos de un hilo.
+typedef struct {
+    _Alignas(64) int crossed[TIME_BLOCK_MAX][NUM_LANES];
+    int halted[TIME_BLOCK_MAX][NUM_LANES];
+} TimeBlockPartial;
+
+// Pasos del próximo bloque a partir del paso `step`: a lo sumo K, y el próximo paso con
+// snapshot (cada snap_every, 0 = ninguno) es el último del bloque.
+static inline int time_block_steps(int K, int step, int snap_every) {
+    if (snap_every <= 0) return K;
+    int to_snap = snap_every - (step % snap_every);
+    return (K < to_snap) ? K : to_snap;
+}
+
+// Avanza los semáforos de X `steps` pasos y anota el plan. El modo de cada paso es el que daría
+// lane_modes: un carril que empieza en ROJO con todos sus vivos detenidos sigue así hasta que cambia
+// la luz (nadie se mueve ni cruza mientras tanto).
+static inline void plan_time_block(Intersection* X, const VehicleSoA* S, double dt, int steps, TimeBlock* B) {
+    bool queued[NUM_LANES];
+    for (int l = 0; l < NUM_LANES; ++l) queued[l] = S->lane_waiting[l] == S->lane_live[l];
+    B->steps = steps;
+    for (int k = 0; k < steps; ++k) {
+        for (int l = 0; l < NUM_LANES; ++l) {
+            update_traffic_light(&X->lights[l], dt);
+            LightState st = X->lights[l].state;
+            bool go = (st == GREEN || st == YELLOW);
+            queued[l] = queued[l] && !go;
+            B->mode[k][l] = go ? LANE_GO : (queued[l] ? LANE_RED_QUEUED : LANE_RED);
+            B->lights[k][l] = X->lights[l];
+        }
+    }
+}
+
+static inline void time_block_clear(TimeBlockPartial* T, int steps) {
+    for (int k = 0; k < steps; ++k) {
+        for (int l = 0; l < NUM_LANES; ++l) T->crossed[k][l] = T->halted[k][l] = 0;
+    }
+}
+
+// Avanza un tramo todos los pasos del bloque antes de soltarlo.
+static inline void move_lane_slice_time_block(VehicleSoA* S, const LaneSlice* sl, const TimeBlock* B,
+                                              double stop_distance, double dt, TimeBlockPartial* T) {
+    const int l = sl->lane;
+    for (int k = 0; k < B->steps; ++k) {
+        move_lane_slice(S, sl, B->mode[k][l], stop_distance, dt, NULL, &T->crossed[k][l], &T->halted[k][l]);
+    }
+}
+
+#endif // TRAFFIC_TILING_H
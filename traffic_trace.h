@@ -0,0 +1,298 @@
+// traffic_trace.h
+// Formato binario de trayectorias (.trc), versión TRACE_VERSION. Orden de bytes del host
+// (little-endian en x86/ARM), todos los bloques alineados a 8 bytes para leerlos con mmap.
+//
+//   TraceHeader
+//   TraceLightConfig[num_lights]            tiempos y estado inicial de los semáforos
+//   uint8_t lane[N] (+ relleno a 8 bytes), double speed[N]   datos fijos por vehículo, por id
+//   registros, uno por paso (el paso 0 es la configuración inicial):
+//     TraceRecordHeader
+//     TraceLightState[num_lights]           estado de los semáforos tras el paso
+//     bloque de `stored_bytes` (comprimido con `codec` si no es TRACE_CODEC_NONE):
+//       keyframe: double pos[N], uint8_t state[N], uint8_t waiting[N]
+//       delta:    double pos[count], uint32_t id[count], uint8_t state[count], uint8_t waiting[count]
+//                 (pos primero: queda alineado a 8 bytes con cualquier count)
+//                 (solo los vehículos que cambiaron respecto del registro anterior)
+//   TraceIndexEntry[num_records]            índice para saltar a cualquier paso
+//
+// Cada keyframe_every registros hay un keyframe: un lector llega a cualquier paso desde el
+// keyframe anterior aplicando a lo sumo keyframe_every - 1 deltas.
+
+#ifndef TRAFFIC_TRACE_H
+#define TRAFFIC_TRACE_H
+
+#include <stdint.h>
+
+#include "traffic_snapshot.h"
+
+#ifdef TRAFFIC_TRACE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef TRAFFIC_TRACE_LZ4
+#include <lz4.h>
+#endif
+
+#define TRACE_MAGIC          "TRAFTRC"
+#define TRACE_VERSION        2 // 2: pos antes de id en los deltas (alineación)
+#ifndef TRACE_KEYFRAME_EVERY
+#define TRACE_KEYFRAME_EVERY 64
+#endif
+
+enum { TRACE_CODEC_NONE = 0, TRACE_CODEC_ZSTD = 1, TRACE_CODEC_LZ4 = 2 };
+enum { TRACE_KEYFRAME = 0, TRACE_DELTA = 1 };
+
+// Códec de los bloques al escribir: el primero con el que se compiló
+#if defined(TRAFFIC_TRACE_ZSTD)
+#define TRACE_DEFAULT_CODEC TRACE_CODEC_ZSTD
+#elif defined(TRAFFIC_TRACE_LZ4)
+#define TRACE_DEFAULT_CODEC TRACE_CODEC_LZ4
+#else
+#define TRACE_DEFAULT_CODEC TRACE_CODEC_NONE
+#endif
+
+typedef struct {
+    char     magic[8];        // TRACE_MAGIC (con el '\0')
+    uint32_t version;
+    uint32_t num_vehicles;
+    uint32_t num_lights;
+    uint32_t keyframe_every;
+    uint64_t seed;
+    double   dt;
+    uint32_t num_records;     // se completan al cerrar la traza
+    uint32_t reserved;
+    uint64_t index_offset;    // 0 si la traza quedó sin cerrar (el lector recorre los registros)
+} TraceHeader;
+
+typedef struct {
+    double   t_green;
+    double   t_yellow;
+    double   t_red;
+    uint32_t initial_state;
+    uint32_t reserved;
+} TraceLightConfig;
+
+typedef struct {
+    double   time_in_state;
+    uint32_t state;
+    uint32_t reserved;
+} TraceLightState;
+
+typedef struct {
+    uint32_t step;
+    uint32_t kind;            // TRACE_KEYFRAME / TRACE_DELTA
+    double   sim_time;
+    uint32_t count;           // vehículos en el bloque (N en un keyframe)
+    uint32_t codec;
+    uint64_t raw_bytes;       // tamaño del bloque sin comprimir
+    uint64_t stored_bytes;    // tamaño en el archivo (sin el relleno a 8 bytes)
+} TraceRecordHeader;
+
+typedef struct {
+    uint32_t step;
+    uint32_t kind;
+    uint64_t offset;          // posición del TraceRecordHeader
+} TraceIndexEntry;
+
+static inline size_t trace_align8(size_t n) { return (n + 7) & ~(size_t)7; }
+
+// Tamaño del bloque sin comprimir
+static inline size_t trace_block_bytes(int kind, size_t count) {
+    return (kind == TRACE_KEYFRAME) ? count * (sizeof(double) + 2)
+                                    : count * (sizeof(uint32_t) + sizeof(double) + 2);
+}
+
+// ----------------------- Compresión -----------------------
+static inline size_t trace_compress_bound(int codec, size_t raw) {
+#ifdef TRAFFIC_TRACE_ZSTD
+    if (codec == TRACE_CODEC_ZSTD) return ZSTD_compressBound(raw);
+#endif
+#ifdef TRAFFIC_TRACE_LZ4
+    if (codec == TRACE_CODEC_LZ4) return (size_t)LZ4_compressBound((int)raw);
+#endif
+    (void)codec;
+    return raw;
+}
+
+// Devuelve los bytes escritos en dst, o 0 si el códec falló (se guarda sin comprimir).
+static inline size_t trace_compress(int codec, void* dst, size_t cap, const void* src, size_t raw) {
+#ifdef TRAFFIC_TRACE_ZSTD
+    if (codec == TRACE_CODEC_ZSTD) {
+        size_t r = ZSTD_compress(dst, cap, src, raw, 1);
+        return ZSTD_isError(r) ? 0 : r;
+    }
+#endif
+#ifdef TRAFFIC_TRACE_LZ4
+    if (codec == TRACE_CODEC_LZ4) {
+        int r = LZ4_compress_default((const char*)src, (char*)dst, (int)raw, (int)cap);
+        return (r <= 0) ? 0 : (size_t)r;
+    }
+#endif
+    (void)codec; (void)dst; (void)cap; (void)src; (void)raw;
+    return 0;
+}
+
+// Descomprime un bloque; false si el códec no está compilado o el bloque está dañado.
+static inline bool trace_decompress(int codec, void* dst, size_t raw, const void* src, size_t stored) {
+    if (codec == TRACE_CODEC_NONE) {
+        if (stored != raw) return false;
+        memcpy(dst, src, raw);
+        return true;
+    }
+#ifdef TRAFFIC_TRACE_ZSTD
+    if (codec == TRACE_CODEC_ZSTD) return ZSTD_decompress(dst, raw, src, stored) == raw;
+#endif
+#ifdef TRAFFIC_TRACE_LZ4
+    if (codec == TRACE_CODEC_LZ4) return LZ4_decompress_safe((const char*)src, (char*)dst, (int)stored, (int)raw) == (int)raw;
+#endif
+    (void)dst; (void)src;
+    return false;
+}
+
+// ----------------------- Escritura -----------------------
+// Lo usa solo el hilo escritor de snapshots (trace_write_step), fuera del camino crítico.
+typedef struct {
+    FILE*            f;
+    TraceHeader      header;
+    int              codec;
+    uint64_t         offset;      // bytes escritos
+    int              n;
+    double*          prev_pos;    // estado del registro anterior, para los deltas
+    unsigned char*   prev_state;
+    unsigned char*   prev_waiting;
+    unsigned char*   block;       // bloque sin comprimir
+    unsigned char*   packed;      // bloque comprimido
+    TraceIndexEntry* index;
+    int              index_cap;
+} TraceWriter;
+
+static inline void trace_put(TraceWriter* W, const void* data, size_t bytes) {
+    fwrite(data, 1, bytes, W->f);
+    W->offset += bytes;
+}
+
+static inline void trace_pad(TraceWriter* W) {
+    static const unsigned char zeros[8] = {0};
+    size_t pad = trace_align8(W->offset) - W->offset;
+    if (pad > 0) trace_put(W, zeros, pad);
+}
+
+// Abre la traza y escribe el encabezado y los datos fijos (V en orden de slots, se escriben por id).
+// Devuelve false si no se pudo crear el archivo.
+static inline bool trace_open(TraceWriter* W, const char* path, const SimConfig* cfg,
+                              const Intersection* X, const VehicleSoA* S) {
+    *W = (TraceWriter){0};
+    W->f = fopen(path, "wb");
+    if (!W->f) return false;
+    W->n = S->n;
+    W->codec = TRACE_DEFAULT_CODEC;
+
+    TraceHeader* H = &W->header;
+    memcpy(H->magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+    H->version        = TRACE_VERSION;
+    H->num_vehicles   = (uint32_t)S->n;
+    H->num_lights     = (uint32_t)X->num_lights;
+    H->keyframe_every = TRACE_KEYFRAME_EVERY;
+    H->seed           = cfg->seed;
+    H->dt             = cfg->dt;
+    trace_put(W, H, sizeof(*H));
+
+    for (int i = 0; i < X->num_lights; ++i) {
+        TraceLightConfig L = { X->lights[i].t_green, X->lights[i].t_yellow, X->lights[i].t_red,
+                               (uint32_t)X->lights[i].state, 0 };
+        trace_put(W, &L, sizeof(L));
+    }
+    size_t raw_cap = trace_block_bytes(TRACE_DELTA, (size_t)S->n);
+    W->block = (unsigned char*)malloc(raw_cap);
+    W->packed = (unsigned char*)malloc(trace_compress_bound(W->codec, raw_cap));
+    for (int id = 0; id < S->n; ++id) W->block[id] = (unsigned char)S->lane[S->slot[id]];
+    trace_put(W, W->block, (size_t)S->n);
+    trace_pad(W);
+    double* speed = (double*)W->block;
+    for (int id = 0; id < S->n; ++id) speed[id] = S->speed[S->slot[id]];
+    trace_put(W, speed, (size_t)S->n * sizeof(double));
+
+    W->prev_pos     = (double*)malloc((size_t)S->n * sizeof(double));
+    W->prev_state   = (unsigned char*)malloc((size_t)S->n);
+    W->prev_waiting = (unsigned char*)malloc((size_t)S->n);
+    return true;
+}
+
+// Agrega el registro de un snapshot: keyframe cada keyframe_every registros, delta el resto.
+static inline void trace_write_step(TraceWriter* W, const Snapshot* snap) {
+    const int n = W->n;
+    const uint32_t r = W->header.num_records;
+    const int kind = (r % W->header.keyframe_every == 0) ? TRACE_KEYFRAME : TRACE_DELTA;
+
+    size_t count = 0;
+    if (kind == TRACE_KEYFRAME) {
+        count = (size_t)n;
+        memcpy(W->block, snap->pos, (size_t)n * sizeof(double));
+        memcpy(W->block + (size_t)n * sizeof(double), snap->state, (size_t)n);
+        memcpy(W->block + (size_t)n * (sizeof(double) + 1), snap->waiting, (size_t)n);
+    } else {
+        for (int id = 0; id < n; ++id) {
+            count += (snap->pos[id] != W->prev_pos[id]) | (snap->state[id] != W->prev_state[id]) |
+                     (snap->waiting[id] != W->prev_waiting[id]);
+        }
+        double*        pos     = (double*)W->block;
+        uint32_t*      ids     = (uint32_t*)(W->block + count * sizeof(double));
+        unsigned char* state   = W->block + count * (sizeof(double) + sizeof(uint32_t));
+        unsigned char* waiting = state + count;
+        size_t k = 0;
+        for (int id = 0; id < n; ++id) {
+            if (snap->pos[id] == W->prev_pos[id] && snap->state[id] == W->prev_state[id] &&
+                snap->waiting[id] == W->prev_waiting[id]) continue;
+            ids[k] = (uint32_t)id;
+            pos[k] = snap->pos[id];
+            state[k] = snap->state[id];
+            waiting[k] = snap->waiting[id];
+            ++k;
+        }
+    }
+    memcpy(W->prev_pos, snap->pos, (size_t)n * sizeof(double));
+    memcpy(W->prev_state, snap->state, (size_t)n);
+    memcpy(W->prev_waiting, snap->waiting, (size_t)n);
+
+    size_t raw = trace_block_bytes(kind, count);
+    const unsigned char* stored = W->block;
+    size_t stored_bytes = raw;
+    int codec = TRACE_CODEC_NONE;
+    if (W->codec != TRACE_CODEC_NONE) {
+        size_t c = trace_compress(W->codec, W->packed, trace_compress_bound(W->codec, raw), W->block, raw);
+        if (c > 0 && c < raw) { stored = W->packed; stored_bytes = c; codec = W->codec; }
+    }
+
+    if ((int)r == W->index_cap) {
+        W->index_cap = W->index_cap ? 2 * W->index_cap : 256;
+        W->index = (TraceIndexEntry*)realloc(W->index, (size_t)W->index_cap * sizeof(TraceIndexEntry));
+    }
+    W->index[r] = (TraceIndexEntry){ (uint32_t)snap->step, (uint32_t)kind, W->offset };
+
+    TraceRecordHeader R = { (uint32_t)snap->step, (uint32_t)kind, snap->sim_time, (uint32_t)count,
+                            (uint32_t)codec, raw, stored_bytes };
+    trace_put(W, &R, sizeof(R));
+    for (int i = 0; i < snap->num_lights; ++i) {
+        TraceLightState L = { snap->lights[i].time_in_state, (uint32_t)snap->lights[i].state, 0 };
+        trace_put(W, &L, sizeof(L));
+    }
+    trace_put(W, stored, stored_bytes);
+    trace_pad(W);
+    W->header.num_records = r + 1;
+}
+
+// Escribe el índice, completa el encabezado y cierra el archivo.
+static inline void trace_close(TraceWriter* W) {
+    W->header.index_offset = W->offset;
+    trace_put(W, W->index, (size_t)W->header.num_records * sizeof(TraceIndexEntry));
+    fseek(W->f, 0, SEEK_SET);
+    fwrite(&W->header, 1, sizeof(W->header), W->f);
+    fclose(W->f);
+    free(W->prev_pos);
+    free(W->prev_state);
+    free(W->prev_waiting);
+    free(W->block);
+    free(W->packed);
+    free(W->index);
+}
+
+#endif // TRAFFIC_TRACE_H
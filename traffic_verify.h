@@ -0,0 +1,240 @@
+// traffic_verify.h
+// Verificación determinista entre versiones: un hash del estado completo después de cada paso
+// (vehículos en orden de id, así no depende de la compactación, y semáforos), más las métricas
+// finales con todos sus bits. --hash-log lo escribe; --verify-against lo compara paso a paso
+// con el de otra corrida (por ejemplo traffic_seq contra traffic_omp con la misma semilla) e
+// informa la primera diferencia.
+// Entre el estado compacto (-DTRAFFIC_COMPACT) y el de double los hashes no pueden coincidir: si
+// la referencia es de la otra precisión se comparan solo las métricas finales, con tolerancia
+// relativa --verify-tolerance.
+// El avance rápido y --time-block no cambian la trayectoria, solo qué pasos se registran: no son
+// parte de la configuración. Una corrida así saltea los pasos de la referencia que ella no
+// ejecutó, y una corrida paso a paso contra una referencia así saltea los que faltan en ella.
+//
+// Formato (texto):
+//   # traffic-hash v2 seed=S vehicles=N dt=DT [follow=MIN_GAP] [actuated=VERDE,ESPERA] [compact=1]
+//   paso hash            un renglón por paso ejecutado (hash de 16 dígitos hexadecimales)
+//   end pasos cruzaron cruces avg_wait
+
+#ifndef TRAFFIC_VERIFY_H
+#define TRAFFIC_VERIFY_H
+
+#include <inttypes.h>
+
+#include "traffic_core.h"
+
+#define VERIFY_FORMAT "traffic-hash v2" // v2: sin ff= en el encabezado
+
+#ifdef TRAFFIC_COMPACT
+#define VERIFY_COMPACT true
+#else
+#define VERIFY_COMPACT false
+#endif
+
+typedef struct {
+    FILE* out;             // --hash-log, NULL = no
+    FILE* ref;             // --verify-against, NULL = no
+    const char* ref_path;
+    bool  started;         // ya se comparó algún paso
+    bool  mismatch;        // ya se informó una diferencia (solo se informa la primera)
+    bool  tolerance;       // referencia de la otra precisión: solo métricas finales, con tolerancia
+    bool  sparse;          // esta corrida no registra todos los pasos (avance rápido, --time-block)
+    bool  pending;         // renglón de la referencia ya leído y todavía no comparado (paso posterior)
+    int   pending_step;
+    uint64_t pending_hash;
+    double tol;            // tolerancia relativa
+} StateVerifier;
+
+static inline uint64_t hash_mix(uint64_t h, uint64_t v) {
+    return splitmix64(h ^ v);
+}
+
+static inline uint64_t double_bits(double x) {
+    uint64_t b;
+    memcpy(&b, &x, sizeof(b));
+    return b;
+}
+
+// Hash de los vehículos con id en [id_begin, id_end) (bloques independientes, para combinar).
+static inline uint64_t hash_vehicles(const VehicleSoA* S, int id_begin, int id_end) {
+    uint64_t h = 0x243F6A8885A308D3ull;
+    for (int id = id_begin; id < id_end; ++id) {
+        int i = S->slot[id];
+        h = hash_mix(h, double_bits((double)S->pos[i])); // float del estado compacto: exacto en double
+        h = hash_mix(h, double_bits((double)S->total_wait[i]));
+        // finished != 0 y no el valor: VEH_CROSSED_NOW / VEH_DONE dependen de cuándo se compacta
+        h = hash_mix(h, (uint64_t)S->waiting[i] | (uint64_t)(S->finished[i] != 0) << 1 |
+                        (uint64_t)S->crossings[i] << 2);
+    }
+    return h;
+}
+
+static inline uint64_t state_hash(const VehicleSoA* S, const Intersection* X) {
+    uint64_t h = hash_vehicles(S, 0, S->n);
+    for (int i = 0; i < X->num_lights; ++i) {
+        h = hash_mix(h, (uint64_t)X->lights[i].state);
+        h = hash_mix(h, double_bits(X->lights[i].time_in_state));
+    }
+    return h;
+}
+
+static inline void verify_header_line(char* buf, size_t len, const SimConfig* cfg, bool compact) {
+    int n = snprintf(buf, len, "# " VERIFY_FORMAT " seed=%u vehicles=%d dt=%.17g",
+                     cfg->seed, cfg->num_vehicles, cfg->dt);
+    if (cfg->car_following) n += snprintf(buf + n, len - n, " follow=%.17g", cfg->min_gap);
+    if (cfg->actuated) n += snprintf(buf + n, len - n, " actuated=%.17g,%.17g", cfg->max_green, cfg->max_wait);
+    if (compact) n += snprintf(buf + n, len - n, " compact=1");
+    snprintf(buf + n, len - n, "\n");
+}
+
+// Abre el log y/o la referencia. La referencia tiene que ser de la misma configuración.
+static inline void verify_open(StateVerifier* W, const SimConfig* cfg) {
+    *W = (StateVerifier){0};
+    char header[256], other[256];
+    verify_header_line(header, sizeof(header), cfg, VERIFY_COMPACT);
+    verify_header_line(other, sizeof(other), cfg, !VERIFY_COMPACT);
+    W->tol = cfg->verify_tolerance;
+    W->sparse = cfg->fast_forward; // --time-block lo marca traffic_omp
+    if (cfg->hash_log_path) {
+        W->out = fopen(cfg->hash_log_path, "w");
+        if (!W->out) {
+            fprintf(stderr, "No se pudo crear el log de hashes: %s\n", cfg->hash_log_path);
+            exit(1);
+        }
+        fputs(header, W->out);
+    }
+    if (cfg->verify_path) {
+        W->ref_path = cfg->verify_path;
+        W->ref = fopen(cfg->verify_path, "r");
+        char line[256];
+        if (!W->ref || !fgets(line, sizeof(line), W->ref)) {
+            fprintf(stderr, "No se pudo leer el log de referencia: %s\n", cfg->verify_path);
+            exit(1);
+        }
+        W->tolerance = strcmp(line, other) == 0;
+        if (W->tolerance) {
+            fprintf(stderr, "VERIFICACIÓN: la referencia es de la otra precisión del estado; se comparan las "
+                            "métricas finales con tolerancia relativa %g\n", W->tol);
+        } else if (strcmp(line, header) != 0) {
+            fprintf(stderr, "El log de referencia es de otra configuración:\n  referencia: %s  esta:       %s",
+                    line, header);
+            exit(1);
+        }
+    }
+}
+
+static inline bool verify_active(const StateVerifier* W) {
+    return W->out || W->ref;
+}
+
+static inline void verify_report(StateVerifier* W, const char* what) {
+    if (W->mismatch) return;
+    W->mismatch = true;
+    fprintf(stderr, "VERIFICACIÓN: %s (referencia: %s)\n", what, W->ref_path);
+}
+
+// Registra / compara el hash del estado después del paso `step`. Al reanudar, los pasos de la
+// referencia anteriores al punto de reanudación se saltan (con sparse, también entre dos pasos).
+// Si la referencia no registró este paso (ya va por uno posterior), no hay con qué comparar.
+static inline void verify_step(StateVerifier* W, int step, uint64_t hash) {
+    if (W->out) fprintf(W->out, "%d %016" PRIx64 "\n", step, hash);
+    if (!W->ref || W->mismatch || W->tolerance) return;
+    char line[256];
+    for (;;) {
+        int ref_step;
+        uint64_t ref_hash;
+        if (W->pending) {
+            ref_step = W->pending_step;
+            ref_hash = W->pending_hash;
+            W->pending = false;
+        } else if (!fgets(line, sizeof(line), W->ref) ||
+                   sscanf(line, "%d %" SCNx64, &ref_step, &ref_hash) != 2) {
+            char msg[128];
+            snprintf(msg, sizeof(msg), "la referencia termina antes del paso %d", step);
+            verify_report(W, msg);
+            return;
+        }
+        if (ref_step < step && (!W->started || W->sparse)) continue;
+        if (ref_step > step && W->started) { // referencia rala: se compara en su próximo paso
+            W->pending = true;
+            W->pending_step = ref_step;
+            W->pending_hash = ref_hash;
+            return;
+        }
+        W->started = true;
+        if (ref_step != step || ref_hash != hash) {
+            char msg[160];
+            if (ref_step != step) {
+                snprintf(msg, sizeof(msg), "primera diferencia en el paso %d (la referencia sigue en el paso %d)",
+                         step, ref_step); // otra secuencia de pasos (p. ej. avance rápido distinto)
+            } else {
+                snprintf(msg, sizeof(msg), "primera diferencia en el paso %d (esperado %016" PRIx64
+                         ", obtenido %016" PRIx64 ")", step, ref_hash, hash);
+            }
+            verify_report(W, msg);
+        }
+        return;
+    }
+}
+
+static inline double relative_diff(double a, double ref) {
+    double d = fabs(a - ref);
+    return (ref != 0.0) ? d / fabs(ref) : d;
+}
+
+// Métricas finales contra una referencia de la otra precisión: todos cruzaron en las dos, y pasos y
+// espera promedio dentro de la tolerancia relativa.
+static inline void verify_tolerance(StateVerifier* W, const char* ref_end, int steps, int crossed, double avg_wait) {
+    int ref_steps, ref_crossed, ref_crossings;
+    double ref_wait;
+    if (sscanf(ref_end, "end %d %d %d %lf", &ref_steps, &ref_crossed, &ref_crossings, &ref_wait) != 4) {
+        verify_report(W, "métricas finales ilegibles en la referencia");
+        return;
+    }
+    double d_wait = relative_diff(avg_wait, ref_wait);
+    double d_steps = relative_diff(steps, ref_steps);
+    char msg[256];
+    snprintf(msg, sizeof(msg), "espera promedio %.6f s (referencia %.6f, dif. %.3g), pasos %d (referencia %d, dif. %.3g)",
+             avg_wait, ref_wait, d_wait, steps, ref_steps, d_steps);
+    if (crossed != ref_crossed || d_wait > W->tol || d_steps > W->tol) {
+        verify_report(W, msg);
+    } else {
+        fprintf(stderr, "VERIFICACIÓN: dentro de la tolerancia %g: %s\n", W->tol, msg);
+    }
+}
+
+// Métricas finales (bits exactos de avg_wait) y cierre. Devuelve true si todo coincidió.
+static inline bool verify_finish(StateVerifier* W, int steps, int crossed, int crossings, double avg_wait) {
+    char end[160];
+    snprintf(end, sizeof(end), "end %d %d %d %.17g\n", steps, crossed, crossings, avg_wait);
+    if (W->out) {
+        fputs(end, W->out);
+        fclose(W->out);
+    }
+    if (W->ref) {
+        char line[256];
+        bool got_end = false;
+        if (W->pending && !W->tolerance) verify_report(W, "la referencia tiene más pasos");
+        while (!W->mismatch && fgets(line, sizeof(line), W->ref)) {
+            got_end = strncmp(line, "end ", 4) == 0;
+            if (got_end) break;
+            if (!W->tolerance) verify_report(W, "la referencia tiene más pasos");
+        }
+        if (!got_end) verify_report(W, "la referencia no tiene métricas finales");
+        if (!W->mismatch && W->tolerance) {
+            verify_tolerance(W, line, steps, crossed, avg_wait);
+        } else if (!W->mismatch && strcmp(line, end) != 0) {
+            char msg[400];
+            snprintf(msg, sizeof(msg), "métricas finales distintas: referencia \"%.*s\", esta \"%.*s\"",
+                     (int)strcspn(line, "\n"), line, (int)strcspn(end, "\n"), end);
+            verify_report(W, msg);
+        }
+        fclose(W->ref);
+        if (!W->mismatch && !W->tolerance) {
+            fprintf(stderr, "VERIFICACIÓN: %d pasos y métricas finales iguales a %s\n", steps, W->ref_path);
+        }
+    }
+    return !W->mismatch;
+}
+
+#endif // TRAFFIC_VERIFY_H